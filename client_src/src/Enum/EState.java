@@ -19,5 +19,6 @@ public enum EState {
     STATUS,
     MAXIMUM_GAMES_REACHED,
     PING,
+    ACK,
     ;
 }
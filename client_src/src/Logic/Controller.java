@@ -162,6 +162,11 @@ public class Controller {
     }
 
     public void handleStateChange(ResponseData response) {
+        // Every message from the server proves the connection; the server skips pings while it talks.
+        if (connectivityMonitor != null) {
+            connectivityMonitor.recievedPing();
+        }
+
         switch (response.getState()) {
             case CONNECT:
                 handleSuccessfulLogin();
@@ -216,6 +221,8 @@ public class Controller {
             case PING:
                 acknowledgePing();
                 break;
+            case ACK:
+                break;
             default:
                 System.out.println("Unknown state received: " + response.getState());
         }
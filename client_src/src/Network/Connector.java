@@ -13,6 +13,9 @@ public class Connector implements Runnable {
     // Indicates if the connection should continue being checked.
     private boolean check;
 
+    // Indicates if the server was probed with a ping after a quiet interval.
+    private boolean probed;
+
     // Timeout limit for reconnection attempts, in seconds.
     private static final int TIMEOUT = 60;
 
@@ -31,9 +34,16 @@ public class Connector implements Runnable {
     public void run() {
         while (true) {
             try {
-                // If no ping is received and connection monitoring is enabled, throw an exception to handle disconnection.
+                // The server only pings quiet connections, so a quiet interval is answered with a ping of our own;
+                // if that goes unanswered too, handle the disconnection.
                 if (!this.ping && this.check) {
-                    throw new Exception();
+                    if (this.probed) {
+                        throw new Exception();
+                    }
+                    this.probed = true;
+                    this.messageHandler.probeConnection();
+                } else {
+                    this.probed = false;
                 }
 
                 // Reset the ping flag and pause for 3 seconds before the next check.
@@ -86,7 +96,7 @@ public class Connector implements Runnable {
         }
     }
 
-    // Method to signal that a ping was received from the server.
+    // Method to signal that a message was received from the server.
     public void recievedPing() {
         this.ping = true;
     }
@@ -101,6 +101,11 @@ public class messageHandler {
         controller.updateStatus("Reconnecting...");
     }
 
+    // Pings the server after a quiet interval; it answers with ACK.
+    public void probeConnection() {
+        testConnection();
+    }
+
     // Tests the connection by sending a ping message.
     private boolean testConnection() {
         try {
@@ -227,7 +232,7 @@ public int resolveMessage(String msg) {
         data = new ResponseData(state, parts[1]);
     } else if (state.equals(EState.STATUS)) {
         data = new ResponseData(state, parts[1]);
-    } else if (state.equals(EState.PING)) {
+    } else if (state.equals(EState.PING) || state.equals(EState.ACK)) {
         data = new ResponseData(state, 0);
     } else {
         int result = 0;
@@ -0,0 +1,23 @@
+#ifndef Clock_hpp
+#define Clock_hpp
+
+#include <chrono>
+
+// Monotonic time of the game server. Normally the steady clock; the traffic replay switches it
+// to a virtual time that only moves when the driver advances it, so timers, clocks and rate
+// limits see the recorded timing no matter how fast the trace is fed.
+class Clock
+{
+public:
+    typedef std::chrono::steady_clock::time_point time_point;
+
+    static time_point now() { return is_virtual ? virtual_now : std::chrono::steady_clock::now(); };
+    static void use_virtual_time(time_point start) { is_virtual = true; virtual_now = start; };
+    static void advance_to(time_point time) { virtual_now = (time > virtual_now) ? time : virtual_now; };
+
+private:
+    static inline bool is_virtual = false;
+    static inline time_point virtual_now = {};
+};
+
+#endif /* Clock_hpp */
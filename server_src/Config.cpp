@@ -0,0 +1,249 @@
+#include "Config.hpp"
+#include "GameAdmin.hpp"
+#include "Telemetry.hpp"
+#include "LobbyDirectory.hpp"
+#include "UringBackend.hpp"
+#include <fstream>
+
+const char *Config::DEFAULT_FILE = "server.conf";
+int Config::RELOAD_POLL_MS = 250;
+
+std::atomic<const ServerConfig *> Config::current(nullptr);
+const ServerConfig *Config::retired = nullptr;
+ServerConfig Config::base;
+std::vector<std::string> Config::override_lines;
+std::string Config::file_path = Config::DEFAULT_FILE;
+bool Config::file_required = false;
+volatile sig_atomic_t Config::reload_requested = 0;
+
+// Every setting with its bounds; text settings list their allowed values instead, or none for free text.
+struct ConfigField
+{
+    const char *key;
+    int ServerConfig::*number;
+    std::string ServerConfig::*text;
+    int min;
+    int max;
+    const char *choices;
+    bool reloadable;
+};
+
+static const ConfigField FIELDS[] = {
+    {"io_backend", nullptr, &ServerConfig::io_backend, 0, 0, "uring,select", false},
+    {"shards", &ServerConfig::shards, nullptr, 0, 64, nullptr, false},
+    {"win_length", &ServerConfig::win_length, nullptr, 3, 11, nullptr, false},
+    {"stall_threshold_ms", &ServerConfig::stall_threshold_ms, nullptr, 1, 60000, nullptr, false},
+    {"receive_buffer_bytes", &ServerConfig::receive_buffer_bytes, nullptr, 64, 1048576, nullptr, false},
+    {"local_socket", nullptr, &ServerConfig::local_socket, 0, 0, nullptr, false},
+    {"local_socket_type", nullptr, &ServerConfig::local_socket_type, 0, 0, "stream,seqpacket", false},
+    {"websocket_port", &ServerConfig::websocket_port, nullptr, 0, 65535, nullptr, false},
+    {"max_games", &ServerConfig::max_games, nullptr, 1, 1000000, nullptr, true},
+    {"timeout", &ServerConfig::timeout, nullptr, 1, 3600, nullptr, true},
+    {"ping_interval", &ServerConfig::ping_interval, nullptr, 1, 60, nullptr, true},
+    {"max_ping_interval", &ServerConfig::max_ping_interval, nullptr, 1, 600, nullptr, true},
+    {"max_invalid_messages", &ServerConfig::max_invalid_messages, nullptr, 1, 1000, nullptr, true},
+    {"max_message_length", &ServerConfig::max_message_length, nullptr, 8, 65536, nullptr, true},
+    {"spare_boards", &ServerConfig::spare_boards, nullptr, 0, 1000000, nullptr, true},
+    {"max_admission_queue", &ServerConfig::max_admission_queue, nullptr, 0, 1000000, nullptr, true},
+    {"admission_batch_ms", &ServerConfig::admission_batch_ms, nullptr, 0, 10000, nullptr, true},
+    {"lobby_broadcast_ms", &ServerConfig::lobby_broadcast_ms, nullptr, 10, 60000, nullptr, true},
+    {"telemetry_interval_ms", &ServerConfig::telemetry_interval_ms, nullptr, 10, 60000, nullptr, true},
+    {"log_level", nullptr, &ServerConfig::log_level, 0, 0, "info,warning,error,off", true},
+};
+
+ServerConfig Config::defaults() {
+    return ServerConfig{"uring", 0, 5, 100, 1024, "", "seqpacket", 0, 10, 60, 1, 10, 5, 30, 256, 4096, 10, 250, 200, "info"};
+}
+
+bool Config::load(const ServerConfig &command_line, const std::vector<std::string> &overrides) {
+    base = command_line;
+    override_lines = overrides;
+
+    // The file itself may be chosen among the overrides.
+    for (const std::string &line : override_lines) {
+        if (line.compare(0, 7, "config=") == 0) {
+            file_path = line.substr(7);
+            file_required = true;
+        }
+    }
+
+    ServerConfig *config = new ServerConfig(base);
+    if (!build(*config, false)) {
+        delete config;
+        return false;
+    }
+    current.store(config, std::memory_order_release);
+    apply(*config);
+    return true;
+}
+
+bool Config::build(ServerConfig &config, bool reloading) {
+    std::ifstream file(file_path);
+    if (!file && file_required) {
+        Logger::log(__FILENAME__, __FUNCTION__, "Error: Unable to read configuration file " + file_path);
+        return false;
+    }
+
+    // "key = value" per line; blank lines and lines starting with '#' are skipped.
+    bool valid = true;
+    std::string line;
+    int number = 0;
+    while (std::getline(file, line)) {
+        number++;
+        size_t first = line.find_first_not_of(" \t\r");
+        if (first == std::string::npos || line[first] == '#') {
+            continue;
+        }
+        size_t separator = line.find('=');
+        if (separator == std::string::npos) {
+            Logger::log(__FILENAME__, __FUNCTION__, "Error: " + file_path + ":" + std::to_string(number) + ": Expected key = value");
+            valid = false;
+            continue;
+        }
+        std::string key = line.substr(first, separator - first);
+        std::string value = line.substr(separator + 1);
+        key.erase(key.find_last_not_of(" \t") + 1);
+        value.erase(0, value.find_first_not_of(" \t"));
+        value.erase(value.find_last_not_of(" \t\r") + 1);
+        valid = set_value(config, key, value, file_path + ":" + std::to_string(number), reloading) && valid;
+    }
+
+    for (const std::string &override_line : override_lines) {
+        size_t separator = override_line.find('=');
+        std::string key = override_line.substr(0, separator);
+        if (key != "config") {
+            valid = set_value(config, key, override_line.substr(separator + 1), "command line", reloading) && valid;
+        }
+    }
+
+    if (config.max_ping_interval < config.ping_interval) {
+        Logger::log(__FILENAME__, __FUNCTION__, "Error: max_ping_interval must not be below ping_interval");
+        valid = false;
+    }
+    return valid;
+}
+
+bool Config::set_value(ServerConfig &config, const std::string &key, const std::string &value, const std::string &origin, bool reloading) {
+    for (const ConfigField &field : FIELDS) {
+        if (key != field.key) {
+            continue;
+        }
+
+        // Startup settings keep their running value; the change waits for the next start.
+        if (reloading && !field.reloadable) {
+            const ServerConfig &running = get();
+            bool changed = field.number ? std::to_string(running.*field.number) != value : running.*field.text != value;
+            if (changed) {
+                Logger::log(__FILENAME__, __FUNCTION__, "Warning: " + key + " only changes with a restart (" + origin + ")");
+            }
+            return true;
+        }
+
+        if (field.text && !field.choices) {
+            config.*field.text = value;
+            return true;
+        }
+        if (field.text) {
+            std::string choices = std::string(",") + field.choices + ",";
+            if (value.empty() || value.find(',') != std::string::npos || choices.find("," + value + ",") == std::string::npos) {
+                Logger::log(__FILENAME__, __FUNCTION__, "Error: " + key + " must be one of " + field.choices + " (" + origin + ")");
+                return false;
+            }
+            config.*field.text = value;
+            return true;
+        }
+
+        try {
+            size_t parsed = 0;
+            int number = std::stoi(value, &parsed);
+            if (parsed == value.length() && number >= field.min && number <= field.max) {
+                config.*field.number = number;
+                return true;
+            }
+        } catch (const std::exception &e) {
+        }
+        Logger::log(__FILENAME__, __FUNCTION__, "Error: " + key + " must be a number in range <" + std::to_string(field.min) + "; " + std::to_string(field.max) + "> (" + origin + ")");
+        return false;
+    }
+
+    Logger::log(__FILENAME__, __FUNCTION__, "Error: Unknown setting " + key + " (" + origin + ")");
+    return false;
+}
+
+void Config::install_signal_handler() {
+    struct sigaction action = {};
+    action.sa_handler = request_reload;
+    sigemptyset(&action.sa_mask);
+    action.sa_flags = SA_RESTART;
+    sigaction(SIGHUP, &action, nullptr);
+}
+
+void Config::start() {
+    SessionAdmin::spawn(watch_reload());
+}
+
+void Config::request_reload(int signal) {
+    reload_requested = 1;
+}
+
+bool Config::take_reload_request() {
+    if (!reload_requested) {
+        return false;
+    }
+    reload_requested = 0;
+    return true;
+}
+
+SessionTask Config::watch_reload() {
+    // The signal handler only raises a flag; the reload itself runs on the event loop.
+    while (true) {
+        co_await SessionAdmin::sleep_for_milliseconds(RELOAD_POLL_MS);
+        if (take_reload_request()) {
+            reload();
+        }
+    }
+}
+
+bool Config::reload() {
+    Logger::log(__FILENAME__, __FUNCTION__, "Reloading configuration from " + file_path);
+
+    // A file with any error changes nothing.
+    ServerConfig *config = new ServerConfig(base);
+    if (!build(*config, true)) {
+        Logger::log(__FILENAME__, __FUNCTION__, "Error: Configuration not reloaded, keeping the running settings");
+        delete config;
+        return false;
+    }
+    const ServerConfig &running = get();
+    config->io_backend = running.io_backend;
+    config->shards = running.shards;
+    config->win_length = running.win_length;
+    config->stall_threshold_ms = running.stall_threshold_ms;
+    config->receive_buffer_bytes = running.receive_buffer_bytes;
+    config->local_socket = running.local_socket;
+    config->local_socket_type = running.local_socket_type;
+    config->websocket_port = running.websocket_port;
+
+    // The snapshot replaced at the previous reload has been out of use for a whole reload period.
+    delete retired;
+    retired = current.exchange(config, std::memory_order_acq_rel);
+    apply(*config);
+    int shard_games = (config->max_games + std::max(config->shards, 1) - 1) / std::max(config->shards, 1);
+    if (shard_games != GameAdmin::MAX_GAMES) {
+        GameAdmin::configure_max_games(shard_games);
+    }
+    Logger::log(__FILENAME__, __FUNCTION__, "Configuration reloaded");
+    return true;
+}
+
+void Config::apply(const ServerConfig &config) {
+    // Modules with their own tunables take them from the snapshot; everything else reads it directly.
+    GameAdmin::MAX_ADMISSION_QUEUE = config.max_admission_queue;
+    GameAdmin::ADMISSION_BATCH_MS = config.admission_batch_ms;
+    Game::MAX_SPARE_BOARDS = config.spare_boards;
+    Game::WIN_LENGTH = config.win_length;
+    UringBackend::BUFFER_SIZE = config.receive_buffer_bytes;
+    LobbyDirectory::BROADCAST_INTERVAL_MS = config.lobby_broadcast_ms;
+    Telemetry::PUBLISH_INTERVAL_MS = config.telemetry_interval_ms;
+    Logger::LEVEL = (config.log_level == "info") ? Logger::INFO : (config.log_level == "warning") ? Logger::WARNING : (config.log_level == "error") ? Logger::ERROR : Logger::OFF;
+}
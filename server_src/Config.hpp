@@ -0,0 +1,77 @@
+#ifndef Config_hpp
+#define Config_hpp
+
+#include <atomic>
+#include <csignal>
+#include <string>
+#include <vector>
+
+#include "Session.hpp"
+#include "Logger.hpp"
+
+// One complete, validated set of settings. A snapshot never changes once published.
+struct ServerConfig
+{
+    // Fixed at startup; a reload keeps the running values.
+    std::string io_backend;
+    int shards;
+    int win_length;
+    int stall_threshold_ms;
+    int receive_buffer_bytes;
+    std::string local_socket;
+    std::string local_socket_type;
+    int websocket_port;
+
+    // Reloadable.
+    int max_games;
+    int timeout;
+    int ping_interval;
+    int max_ping_interval;
+    int max_invalid_messages;
+    int max_message_length;
+    int spare_boards;
+    int max_admission_queue;
+    int admission_batch_ms;
+    int lobby_broadcast_ms;
+    int telemetry_interval_ms;
+    std::string log_level;
+};
+
+// Typed server configuration: built-in defaults, then the command line, then a "key = value"
+// file, then key=value overrides given after the positional arguments. Readers take the current
+// snapshot through one atomic pointer. SIGHUP re-reads the file; the new snapshot is swapped in
+// whole from the event loop and the one it replaced is freed at the following reload, once no
+// reader can still hold it.
+class Config
+{
+public:
+    static const char *DEFAULT_FILE;
+    static int RELOAD_POLL_MS;
+
+    static bool load(const ServerConfig &command_line, const std::vector<std::string> &overrides);
+    static const ServerConfig &get() { return *current.load(std::memory_order_acquire); };
+    static ServerConfig defaults();
+    static bool is_override(const std::string &argument) { return argument.find('=') != std::string::npos; };
+
+    static void install_signal_handler();
+    static void start();
+    static bool reload();
+    static bool take_reload_request();
+    static void apply(const ServerConfig &config);
+
+private:
+    static std::atomic<const ServerConfig *> current;
+    static const ServerConfig *retired;
+    static ServerConfig base;
+    static std::vector<std::string> override_lines;
+    static std::string file_path;
+    static bool file_required;
+    static volatile sig_atomic_t reload_requested;
+
+    static bool build(ServerConfig &config, bool reloading);
+    static bool set_value(ServerConfig &config, const std::string &key, const std::string &value, const std::string &origin, bool reloading);
+    static void request_reload(int signal);
+    static SessionTask watch_reload();
+};
+
+#endif /* Config_hpp */
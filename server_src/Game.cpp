@@ -1,8 +1,18 @@
 #include "Game.hpp"
+#include "Trace.hpp"
+#include <algorithm>
+
+size_t Game::live_count = 0;
+std::vector<int **> Game::spare_boards;
+size_t Game::MAX_SPARE_BOARDS = 256;
+int Game::WIN_LENGTH = 5;
 
 Game::Game(int game_id, Player *first_player, Player *second_player)
-    : game_id(game_id), player_one(first_player), player_two(second_player), previous_winner(nullptr)
+    : game_id(game_id), player_one(first_player), player_two(second_player), previous_winner(nullptr), first_turn(0), round(1), revision(0),
+      snapshot_valid(false), time_control{0, 0, 0}, clock_ms{0, 0}, clock_running(false)
 {
+    live_count++;
+
     // Initialize the game by associating players with game markers and ID.
     first_player->set_game_id(game_id);
     first_player->set_game_marker(1);
@@ -12,6 +22,7 @@ Game::Game(int game_id, Player *first_player, Player *second_player)
 
     // Create a game board and set the active turn to the first player.
     game_board = create_board();
+    marker_cells[0] = marker_cells[1] = 0;
     this->active_turn = first_player->get_game_marker();
 
     // Log the game initialization details.
@@ -20,6 +31,8 @@ Game::Game(int game_id, Player *first_player, Player *second_player)
 
 Game::~Game()
 {
+    live_count--;
+
     // Release the allocated memory for the game board and log the termination.
     release_board(game_board);
     Logger::log(__FILENAME__, __FUNCTION__, "Game terminated: ID " + std::to_string(game_id));
@@ -31,8 +44,34 @@ Player *Game::get_opponent(Player *player) const
     return (player == player_one) ? player_two : player_one;
 }
 
+void Game::reserve_boards(size_t count)
+{
+    // Allocate boards ahead of a batch of games so creating them takes no allocations.
+    while (spare_boards.size() < std::min(count, MAX_SPARE_BOARDS))
+    {
+        int **board = new int *[BOARD_SIZE];
+        for (int i = 0; i < BOARD_SIZE; ++i)
+        {
+            board[i] = new int[BOARD_SIZE]();
+        }
+        spare_boards.push_back(board);
+    }
+}
+
 int **Game::create_board() const
 {
+    // Reuse a board released by an earlier game when one is spare.
+    if (!spare_boards.empty())
+    {
+        int **board = spare_boards.back();
+        spare_boards.pop_back();
+        for (int i = 0; i < BOARD_SIZE; ++i)
+        {
+            std::fill(board[i], board[i] + BOARD_SIZE, 0);
+        }
+        return board;
+    }
+
     // Dynamically allocate memory for the game board.
     int **new_board = new int *[BOARD_SIZE];
     for (int i = 0; i < BOARD_SIZE; ++i)
@@ -44,6 +83,13 @@ int **Game::create_board() const
 
 void Game::release_board(int **board) const
 {
+    // Keep a limited number of boards for the next games.
+    if (spare_boards.size() < MAX_SPARE_BOARDS)
+    {
+        spare_boards.push_back(board);
+        return;
+    }
+
     // Deallocate memory for the game board to avoid memory leaks.
     for (int i = 0; i < BOARD_SIZE; ++i)
     {
@@ -62,10 +108,19 @@ void Game::reset_game_board()
             game_board[i][j] = 0;
         }
     }
+    marker_cells[0] = marker_cells[1] = 0;
+
+    // Forget the moves of the previous round; clients resync against the new one.
+    move_log.clear();
+    first_turn = 0;
+    round++;
+    snapshot_valid = false;
 }
 
 int Game::execute_turn(int row, int column, Player *player)
 {
+    TRACE_SCOPE(execute_turn);
+
     // Check if the selected cell is within the board limits.
     if (row < 0 || column < 0 || row >= BOARD_SIZE || column >= BOARD_SIZE)
     {
@@ -78,8 +133,7 @@ int Game::execute_turn(int row, int column, Player *player)
         // Ensure the selected cell is empty.
         if (game_board[row][column] == 0)
         {
-            game_board[row][column] = player->get_game_marker(); // Mark the cell.
-            active_turn = (active_turn == 1) ? 2 : 1; // Switch the turn.
+            make_move(row * BOARD_SIZE + column);
             return 0; // Successful move.
         }
         else
@@ -95,109 +149,207 @@ int Game::execute_turn(int row, int column, Player *player)
 
 int Game::evaluate_game_state() const
 {
-    const int WIN_CONDITION = 5; // Number of consecutive markers needed to win.
+    TRACE_SCOPE(evaluate_game_state);
 
-    // Check for horizontal win.
-    for (int i = 0; i < BOARD_SIZE; ++i)
+    // Only the last move can have completed a line; the game ends as soon as one is completed.
+    // The windows through its cell come from the precomputed table for the configured win length.
+    if (!move_log.empty())
     {
-        for (int j = 0; j <= BOARD_SIZE - WIN_CONDITION; ++j)
+        int cell = move_log.back();
+        int marker = game_board[cell / BOARD_SIZE][cell % BOARD_SIZE];
+        if (WinLines::for_length(WIN_LENGTH).completes_line(marker_cells[marker - 1], cell))
         {
-            if (game_board[i][j] != 0)
-            {
-                bool win = true;
-                for (int k = 1; k < WIN_CONDITION; ++k)
-                {
-                    if (game_board[i][j] != game_board[i][j + k])
-                    {
-                        win = false;
-                        break;
-                    }
-                }
-                if (win) return 1;
-            }
+            return 1;
         }
     }
 
-    // Check for vertical win.
-    for (int i = 0; i <= BOARD_SIZE - WIN_CONDITION; ++i)
+    // Check if the board is full.
+    if (move_log.size() < static_cast<size_t>(BOARD_SIZE * BOARD_SIZE))
     {
-        for (int j = 0; j < BOARD_SIZE; ++j)
-        {
-            if (game_board[i][j] != 0)
-            {
-                bool win = true;
-                for (int k = 1; k < WIN_CONDITION; ++k)
-                {
-                    if (game_board[i][j] != game_board[i + k][j])
-                    {
-                        win = false;
-                        break;
-                    }
-                }
-                if (win) return 1;
-            }
-        }
+        return 0; // Game still in progress.
     }
 
-    // Check for diagonal win (top-left to bottom-right).
-    for (int i = 0; i <= BOARD_SIZE - WIN_CONDITION; ++i)
+    return -1; // Game is a draw.
+}
+
+int Game::get_board_value(int row, int column) const
+{
+    // Return the value of the specified cell on the game board.
+    return game_board[row][column];
+}
+
+const std::string &Game::get_board_snapshot() const
+{
+    // Serialize the board once per move; reconnects in between reuse the cached string.
+    if (!snapshot_valid)
     {
-        for (int j = 0; j <= BOARD_SIZE - WIN_CONDITION; ++j)
+        board_snapshot.clear();
+        board_snapshot.reserve(BOARD_SIZE * BOARD_SIZE * 2);
+        for (int i = 0; i < BOARD_SIZE; ++i)
         {
-            if (game_board[i][j] != 0)
+            for (int j = 0; j < BOARD_SIZE; ++j)
             {
-                bool win = true;
-                for (int k = 1; k < WIN_CONDITION; ++k)
+                if (i > 0 || j > 0)
                 {
-                    if (game_board[i][j] != game_board[i + k][j + k])
-                    {
-                        win = false;
-                        break;
-                    }
+                    board_snapshot += ',';
                 }
-                if (win) return 1;
+                board_snapshot += static_cast<char>('0' + game_board[i][j]);
             }
         }
+        snapshot_valid = true;
     }
+    return board_snapshot;
+}
+
+void Game::make_move(int cell)
+{
+    // Mark the cell for the player on turn.
+    game_board[cell / BOARD_SIZE][cell % BOARD_SIZE] = active_turn;
+    marker_cells[active_turn - 1] |= CellMask(1) << cell;
 
-    // Check for diagonal win (bottom-left to top-right).
-    for (int i = WIN_CONDITION - 1; i < BOARD_SIZE; ++i)
+    // Remember who opened the round and record the move as a packed cell index.
+    if (move_log.empty())
     {
-        for (int j = 0; j <= BOARD_SIZE - WIN_CONDITION; ++j)
-        {
-            if (game_board[i][j] != 0)
-            {
-                bool win = true;
-                for (int k = 1; k < WIN_CONDITION; ++k)
-                {
-                    if (game_board[i][j] != game_board[i - k][j + k])
-                    {
-                        win = false;
-                        break;
-                    }
-                }
-                if (win) return 1;
-            }
-        }
+        first_turn = active_turn;
     }
+    move_log.push_back(static_cast<unsigned char>(cell));
+    snapshot_valid = false;
 
-    // Check if the board is full.
-    for (int i = 0; i < BOARD_SIZE; ++i)
+    active_turn = (active_turn == 1) ? 2 : 1; // Switch the turn.
+}
+
+bool Game::unmake_move()
+{
+    if (move_log.empty())
     {
-        for (int j = 0; j < BOARD_SIZE; ++j)
+        return false;
+    }
+
+    // The last mover owns the cell; clearing it hands the turn back to them.
+    int cell = move_log.back();
+    move_log.pop_back();
+    active_turn = game_board[cell / BOARD_SIZE][cell % BOARD_SIZE];
+    game_board[cell / BOARD_SIZE][cell % BOARD_SIZE] = 0;
+    marker_cells[active_turn - 1] &= ~(CellMask(1) << cell);
+
+    if (move_log.empty())
+    {
+        first_turn = 0;
+    }
+    // Move counts seen before the undo no longer describe the board.
+    revision++;
+    snapshot_valid = false;
+    return true;
+}
+
+bool Game::restore_round(const std::vector<unsigned char> &moves, int opening_turn, int current_turn)
+{
+    // Rebuild the board by replaying the round's moves from the player who opened it.
+    reset_game_board();
+    active_turn = opening_turn;
+    for (unsigned char move : moves)
+    {
+        Player *mover = (active_turn == player_one->get_game_marker()) ? player_one : player_two;
+        if (execute_turn(move / BOARD_SIZE, move % BOARD_SIZE, mover) != 0)
         {
-            if (game_board[i][j] == 0)
-            {
-                return 0; // Game still in progress.
-            }
+            return false;
         }
     }
 
-    return -1; // Game is a draw.
+    // Restore the saved turn as well; a round without moves has nothing to replay it from.
+    active_turn = current_turn;
+    return true;
 }
 
-int Game::get_board_value(int row, int column) const
+void Game::start_clock(const TimeControl &control)
 {
-    // Return the value of the specified cell on the game board.
-    return game_board[row][column];
+    // Both players start with a full bank; the clock of the player on turn runs from now.
+    time_control = control;
+    clock_ms[0] = clock_ms[1] = control.base_ms;
+    clock_running = control.is_enabled();
+    turn_started = Clock::now();
+}
+
+void Game::restore_clock(const TimeControl &control, int first_bank_ms, int second_bank_ms, bool running)
+{
+    // The move limit of the player on turn starts over; the banks carry the time already used.
+    time_control = control;
+    clock_ms[0] = first_bank_ms;
+    clock_ms[1] = second_bank_ms;
+    clock_running = running && control.is_enabled();
+    turn_started = Clock::now();
+}
+
+void Game::take_back_turn(int marker, std::chrono::steady_clock::time_point now)
+{
+    // Charge the player on turn for the time spent so far, revoke the increment the undone move
+    // earned and start the mover's fresh move limit. Called before the move is unmade.
+    if (!clock_running)
+    {
+        return;
+    }
+    if (time_control.base_ms > 0)
+    {
+        int elapsed = static_cast<int>(std::chrono::duration_cast<std::chrono::milliseconds>(now - turn_started).count());
+        clock_ms[active_turn - 1] -= elapsed;
+        clock_ms[marker - 1] -= time_control.increment_ms;
+    }
+    turn_started = now;
+}
+
+void Game::press_clock(int marker, std::chrono::steady_clock::time_point now)
+{
+    // Charge the mover for the turn, add the increment and start the opponent's turn.
+    if (!clock_running)
+    {
+        return;
+    }
+    if (time_control.base_ms > 0)
+    {
+        int elapsed = static_cast<int>(std::chrono::duration_cast<std::chrono::milliseconds>(now - turn_started).count());
+        clock_ms[marker - 1] += time_control.increment_ms - elapsed;
+    }
+    turn_started = now;
+}
+
+int Game::get_time_left(int marker, std::chrono::steady_clock::time_point now) const
+{
+    // Time the player can still spend: the bank, capped by the move limit while on turn.
+    if (!time_control.is_enabled())
+    {
+        return 0;
+    }
+    int left = time_control.base_ms > 0 ? clock_ms[marker - 1] : time_control.move_limit_ms;
+    if (!clock_running || marker != active_turn)
+    {
+        return left;
+    }
+
+    int elapsed = static_cast<int>(std::chrono::duration_cast<std::chrono::milliseconds>(now - turn_started).count());
+    left -= elapsed;
+    if (time_control.move_limit_ms > 0)
+    {
+        left = std::min(left, time_control.move_limit_ms - elapsed);
+    }
+    return std::max(0, left);
+}
+
+int Game::get_bank(int marker, std::chrono::steady_clock::time_point now) const
+{
+    // The Fischer bank alone, with the running turn already charged.
+    if (time_control.base_ms <= 0)
+    {
+        return 0;
+    }
+    int bank = clock_ms[marker - 1];
+    if (clock_running && marker == active_turn)
+    {
+        bank -= static_cast<int>(std::chrono::duration_cast<std::chrono::milliseconds>(now - turn_started).count());
+    }
+    return std::max(0, bank);
+}
+
+std::chrono::steady_clock::time_point Game::get_turn_deadline() const
+{
+    return turn_started + std::chrono::milliseconds(get_time_left(active_turn, turn_started));
 }
@@ -2,9 +2,23 @@
 #define Game_hpp
 
 #include <iostream>
+#include <vector>
+#include <chrono>
 #include "Player.hpp"
+#include "Clock.hpp"
+#include "LineMasks.hpp"
 #include "Logger.hpp"
 
+// Clock settings of a game in milliseconds; zero disables the respective limit.
+struct TimeControl
+{
+    int base_ms;
+    int increment_ms;
+    int move_limit_ms;
+
+    bool is_enabled() const { return base_ms > 0 || move_limit_ms > 0; };
+};
+
 class Game
 {
 private:
@@ -12,15 +26,36 @@ private:
     Player *player_two;
     int game_id;
     int **game_board;
+    CellMask marker_cells[2];
     Player *previous_winner;
+    std::vector<unsigned char> move_log;
+    int first_turn;
+    int round;
+    int revision;
+    mutable std::string board_snapshot;
+    mutable bool snapshot_valid;
+    TimeControl time_control;
+    int clock_ms[2];
+    bool clock_running;
+    std::chrono::steady_clock::time_point turn_started;
+    static size_t live_count;
+    static std::vector<int **> spare_boards;
     int **create_board() const;
     void release_board(int **board) const;
 
 public:
     static const int BOARD_SIZE = 11;
+    static const int MIN_WIN_LENGTH = 3;
+    static size_t MAX_SPARE_BOARDS;
+    static int WIN_LENGTH;
+
+    // Win windows of the board for every supported win length, shared with the offline tools.
+    typedef LineMasks<BOARD_SIZE, MIN_WIN_LENGTH> WinLines;
 
     Game(int game_id, Player *first_player, Player *second_player);
     ~Game();
+    static size_t get_live_count() { return live_count; };
+    static void reserve_boards(size_t count);
 
     Player *get_opponent(Player *player) const;
     Player *get_first_player() const { return player_one; };
@@ -31,8 +66,32 @@ public:
 
     void reset_game_board();
     int execute_turn(int row, int column, Player *player);
+
+    // Unchecked moves for the player on turn and their O(1) reversal, for takebacks and for search
+    // code that walks the game tree on the live board; move_log doubles as the undo stack.
+    void make_move(int cell);
+    bool unmake_move();
     int evaluate_game_state() const;
+    CellMask get_marker_cells(int marker) const { return marker_cells[marker - 1]; };
     int get_board_value(int row, int column) const;
+    const std::string &get_board_snapshot() const;
+    int get_round() const { return round; };
+    int get_revision() const { return revision; };
+    const std::vector<unsigned char> &get_move_log() const { return move_log; };
+    int get_first_turn() const { return first_turn; };
+    bool restore_round(const std::vector<unsigned char> &moves, int opening_turn, int current_turn);
+
+    void start_clock(const TimeControl &control);
+    void restore_clock(const TimeControl &control, int first_bank_ms, int second_bank_ms, bool running);
+    void stop_clock() { clock_running = false; };
+    void press_clock(int marker, std::chrono::steady_clock::time_point now);
+    void take_back_turn(int marker, std::chrono::steady_clock::time_point now);
+    bool is_clock_running() const { return clock_running; };
+    bool is_flag_fallen(std::chrono::steady_clock::time_point now) const { return clock_running && now >= get_turn_deadline(); };
+    const TimeControl &get_time_control() const { return time_control; };
+    int get_time_left(int marker, std::chrono::steady_clock::time_point now) const;
+    int get_bank(int marker, std::chrono::steady_clock::time_point now) const;
+    std::chrono::steady_clock::time_point get_turn_deadline() const;
 
     int active_turn;
 };
@@ -5,13 +5,17 @@
 std::map<string, Player*> GameAdmin::logged_players;
 std::map<int, Player*> GameAdmin::unlogged_players;
 stack<Player*> GameAdmin::players_queue;
+std::deque<Player*> GameAdmin::admission_queue;
+bool GameAdmin::admission_scheduled = false;
 std::map<int, Game*> GameAdmin::active_games;
 
 int GameAdmin::game_id_counter = 1;
 int GameAdmin::MAX_GAMES;
-
-int TIMEOUT = 60;
-int PING_INTERVAL = 1;
+TimeControl GameAdmin::TIME_CONTROL = {300000, 5000, 60000};
+size_t GameAdmin::MAX_ADMISSION_QUEUE = 4096;
+int GameAdmin::ADMISSION_BATCH_MS = 10;
+std::map<int, std::pair<uint64_t, std::chrono::steady_clock::time_point> > GameAdmin::clock_watchers;
+uint64_t GameAdmin::clock_watcher_counter = 0;
 
 void GameAdmin::add_new_unregistered_player(const char *ip_address, int socket_id) {
     // Log the connection attempt with the provided IP address and socket ID.
@@ -30,10 +34,11 @@ void GameAdmin::add_new_unregistered_player(const char *ip_address, int socket_i
     } else {
         // Log success if the player was successfully added.
         Logger::log(__FILENAME__, __FUNCTION__, "Player successfully added to unregistered list.");
+        Reaper::watch_connection(socket_id);
     }
 }
 
-void GameAdmin::authenticate_and_register_player(int client_socket, const std::string& player_name) {
+void GameAdmin::authenticate_and_register_player(int client_socket, const std::string& player_name, bool announce) {
     // Log the start of the authentication process for the player.
     Logger::log(__FILENAME__, __FUNCTION__, "Authenticating player: Name=" + player_name + ", Socket=" + std::to_string(client_socket));
 
@@ -55,13 +60,16 @@ void GameAdmin::authenticate_and_register_player(int client_socket, const std::s
 
     // Add the player to the logged players map.
     GameAdmin::logged_players.insert(make_pair(player_name, unregistered_player));
+    LobbyDirectory::player_joined(player_name);
 
-    // Start a ping monitoring thread for the player to handle connection status.
-    unregistered_player->set_ping_handler(thread(GameAdmin::monitor_player_ping, unregistered_player));
-    unregistered_player->thread_running = true;
+    // Start the player's heartbeat coroutine to handle connection status.
+    unregistered_player->heartbeat_running = true;
+    SessionAdmin::spawn(GameAdmin::monitor_player_ping(unregistered_player));
 
-    // Notify the client about the successful connection.
-    Responder::deliver_message_to_client(unregistered_player, "CONNECT");
+    // Notify the client about the successful connection; a migrated client connected long ago.
+    if (announce) {
+        Responder::deliver_message_to_client(unregistered_player, "CONNECT");
+    }
     Logger::log(__FILENAME__, __FUNCTION__, "Player registered and moved to logged players: Name=" + player_name + ", Socket=" + std::to_string(client_socket));
 }
 
@@ -103,8 +111,8 @@ void GameAdmin::initiate_game_search(Player* player) {
     // Log that the player has initiated a game search.
     Logger::log(__FILENAME__, __FUNCTION__, "Player searching for a game: " + player->get_name());
 
-    // Check if there is capacity for a new game.
-    if (active_games.size() < GameAdmin::MAX_GAMES) {
+    // Check if there is capacity for a new game; earlier searches held for capacity go first.
+    if (available_game_slots() > 0 && admission_queue.empty()) {
         // Try to find an opponent from the players queue.
         auto* opponent = search_for_opponent();
 
@@ -115,6 +123,16 @@ void GameAdmin::initiate_game_search(Player* player) {
             players_queue.push(player);
             Responder::update_player_state(player, "WAITING");
             player->set_state("WAITING");
+
+            // Behind a router, claim a player waiting on another shard, whose shard then moves them
+            // over here; with nobody to claim, offer this player to the other shards instead.
+            std::string claimed_name;
+            int claimed_shard;
+            if (ShardDirectory::claim_waiting(claimed_name, claimed_shard)) {
+                Logger::log(__FILENAME__, __FUNCTION__, "Claimed waiting player " + claimed_name + " from shard " + std::to_string(claimed_shard));
+            } else {
+                ShardDirectory::publish_waiting(player->get_name());
+            }
         } else {
             // If an opponent is found, start a new game.
             Logger::log(__FILENAME__, __FUNCTION__, "Opponent located. Opponent name: " + opponent->get_name());
@@ -124,9 +142,14 @@ void GameAdmin::initiate_game_search(Player* player) {
 
             player->set_state("IN_GAME");
             opponent->set_state("IN_GAME");
+            ShardDirectory::withdraw_waiting(player->get_name());
+            ShardDirectory::withdraw_waiting(opponent->get_name());
 
-            initialize_game(player, opponent);
+            initialize_game(player, opponent, TIME_CONTROL);
         }
+    } else if (admission_queue.size() < MAX_ADMISSION_QUEUE) {
+        // Hold the search until games end instead of having the client retry.
+        hold_for_admission(player);
     } else {
         // If the maximum game limit is reached, inform the player.
         Logger::log(__FILENAME__, __FUNCTION__, "Maximum game limit reached. Player: " + player->get_name());
@@ -134,6 +157,88 @@ void GameAdmin::initiate_game_search(Player* player) {
     }
 }
 
+void GameAdmin::hold_for_admission(Player* player) {
+    admission_queue.push_back(player);
+    Logger::log(__FILENAME__, __FUNCTION__, "Holding player for a free game slot: " + player->get_name() + ", Position=" + std::to_string(admission_queue.size()));
+
+    Responder::update_player_state(player, "WAITING");
+    player->set_state("WAITING");
+    Responder::update_player_status(player, "Maximum games reached, queued at position " + std::to_string(admission_queue.size()));
+
+    // A slot may be free already when the queue was not empty; admit with the next pass.
+    if (available_game_slots() > 0) {
+        schedule_admission();
+    }
+}
+
+void GameAdmin::withdraw_from_admission(Player* player) {
+    auto it = std::find(admission_queue.begin(), admission_queue.end(), player);
+    if (it != admission_queue.end()) {
+        admission_queue.erase(it);
+        Logger::log(__FILENAME__, __FUNCTION__, "Player " + player->get_name() + " removed from the admission queue.");
+    }
+}
+
+void GameAdmin::schedule_admission() {
+    // Games ending close together free their slots for one admission pass.
+    if (!admission_scheduled && !admission_queue.empty()) {
+        admission_scheduled = true;
+        SessionAdmin::spawn(run_admission());
+    }
+}
+
+SessionTask GameAdmin::run_admission() {
+    co_await SessionAdmin::sleep_for_milliseconds(ADMISSION_BATCH_MS);
+    admission_scheduled = false;
+    admit_waiting_players();
+}
+
+void GameAdmin::admit_waiting_players() {
+    int slots = available_game_slots();
+    if (slots == 0 || admission_queue.empty()) {
+        return;
+    }
+
+    // Pair in arrival order; a player already waiting for an opponent is paired first.
+    std::vector<std::pair<Player*, Player*> > pairings;
+    pairings.reserve(slots);
+    std::deque<Player*> disconnected;
+    Player* unpaired = nullptr;
+    while (!admission_queue.empty() && static_cast<int>(pairings.size()) < slots) {
+        Player* player = admission_queue.front();
+        admission_queue.pop_front();
+
+        // Disconnected players keep their place until they are back or timed out.
+        if (player->get_connection_status() == -1) {
+            disconnected.push_back(player);
+            continue;
+        }
+
+        if (!unpaired) {
+            unpaired = search_for_opponent();
+        }
+        if (unpaired) {
+            ShardDirectory::withdraw_waiting(unpaired->get_name());
+            pairings.emplace_back(unpaired, player);
+            unpaired = nullptr;
+        } else {
+            unpaired = player;
+        }
+    }
+    admission_queue.insert(admission_queue.begin(), disconnected.begin(), disconnected.end());
+
+    // An odd player out has a slot but no opponent yet; they wait like any other search.
+    if (unpaired) {
+        players_queue.push(unpaired);
+        ShardDirectory::publish_waiting(unpaired->get_name());
+    }
+
+    Logger::log(__FILENAME__, __FUNCTION__, "Admitting " + std::to_string(pairings.size()) + " games, " + std::to_string(admission_queue.size()) + " players still held");
+    if (!pairings.empty()) {
+        initialize_games(pairings, TIME_CONTROL);
+    }
+}
+
 Player* GameAdmin::search_for_opponent() {
     // Check the queue for an available opponent.
     if (!players_queue.empty()) {
@@ -152,7 +257,7 @@ Player* GameAdmin::search_for_opponent() {
     return nullptr; // Return null if the queue is empty.
 }
 
-void GameAdmin::initialize_game(Player* player_one, Player* player_two) {
+Game* GameAdmin::initialize_game(Player* player_one, Player* player_two, const TimeControl& time_control) {
     // Log the initialization of a new game.
     Logger::log(__FILENAME__, __FUNCTION__, "Setting up new game for players: " + player_one->get_name() + " and " + player_two->get_name());
 
@@ -161,11 +266,67 @@ void GameAdmin::initialize_game(Player* player_one, Player* player_two) {
     new_game->set_previous_winner(player_one);
 
     active_games[game_id_counter] = new_game;
+    Reaper::watch_game(game_id_counter);
+    LobbyDirectory::game_started(new_game);
     game_id_counter++;
 
-    // Notify players about the start of the game.
+    // Start the clock of the first player and notify players about the start of the game.
+    mark_synced(new_game, player_one);
+    mark_synced(new_game, player_two);
+    new_game->start_clock(time_control);
+    arm_game_clock(new_game);
     Responder::update_player_status(player_one, "Your turn");
     Responder::update_player_status(player_two, "Opponent's turn");
+    return new_game;
+}
+
+std::vector<int> GameAdmin::initialize_games(const std::vector<std::pair<Player*, Player*> >& pairings, const TimeControl& time_control) {
+    // Log the size of the batch.
+    Logger::log(__FILENAME__, __FUNCTION__, "Creating " + std::to_string(pairings.size()) + " games in one batch");
+
+    // Start every pairing the same way a matched search would, with the boards allocated up front
+    // and the notifications of the whole batch sent together.
+    std::vector<int> game_ids;
+    game_ids.reserve(pairings.size());
+    Game::reserve_boards(pairings.size());
+    Server::beginSendBatch();
+    for (const auto& pairing : pairings) {
+        Responder::update_player_state(pairing.first, "STARTING_GAME;" + pairing.second->get_name());
+        Responder::update_player_state(pairing.second, "STARTING_GAME;" + pairing.first->get_name());
+
+        pairing.first->set_state("IN_GAME");
+        pairing.second->set_state("IN_GAME");
+
+        game_ids.push_back(initialize_game(pairing.first, pairing.second, time_control)->get_game_id());
+    }
+    Server::flushSendBatch();
+    return game_ids;
+}
+
+int GameAdmin::available_game_slots() {
+    // Tournament games configured to bypass the limit do not occupy regular slots.
+    int limited_games = static_cast<int>(active_games.size()) - TournamentAdmin::bypassing_game_count();
+    return std::max(0, GameAdmin::MAX_GAMES - limited_games);
+}
+
+void GameAdmin::finish_tournament_game(Game* game, Player* winner) {
+    // Tournament games end right after the result; the tournament tells the players whether they are still in.
+    Logger::log(__FILENAME__, __FUNCTION__, "Closing tournament game: " + std::to_string(game->get_game_id()));
+
+    active_games.erase(game->get_game_id());
+    LobbyDirectory::game_ended(game->get_game_id());
+    int game_id = game->get_game_id();
+    Player* first = game->get_first_player();
+    Player* second = game->get_second_player();
+    delete game;
+
+    first->reset_game_stats();
+    second->reset_game_stats();
+
+    // Report the result; this may pair the next round or start queued games.
+    TournamentAdmin::report_result(game_id, winner);
+    TournamentAdmin::launch_pending_games();
+    schedule_admission();
 }
 void GameAdmin::resolve_player_turn(Player* player, int row, int column) {
     // Log the player's turn with row and column details.
@@ -173,6 +334,13 @@ void GameAdmin::resolve_player_turn(Player* player, int row, int column) {
 
     // Retrieve the active game associated with the player.
     Game* current_game = get_active_game(player->get_game_id());
+
+    // A move that arrives after the flag fell loses on time, even before the clock watcher fires.
+    auto now = Clock::now();
+    if (current_game->is_flag_fallen(now)) {
+        resolve_flag_fall(current_game);
+        return;
+    }
     int action_result = current_game->execute_turn(row, column, player);
 
     // Handle the result of the turn execution.
@@ -183,31 +351,26 @@ void GameAdmin::resolve_player_turn(Player* player, int row, int column) {
             Player* next_player = current_game->get_opponent(player);
             current_game->active_turn = next_player->get_game_marker();
 
+            // A takeback request only ever covers the move it was made after.
+            player->takeback_requested = false;
+            next_player->takeback_requested = false;
+            current_game->press_clock(player->get_game_marker(), now);
+
             // Update the game state and notify players.
             Responder::update_player_status(next_player, "Your turn");
             Responder::update_player_status(player, "Opponent's turn");
 
             Responder::confirm_player_move(player, row, column);
             Responder::notify_opponent_move(next_player, row, column);
+            mark_synced(current_game, player);
+            mark_synced(current_game, next_player);
 
-            // Evaluate the game state for a win or draw.
+            // Evaluate the game state for a win or draw; otherwise the opponent's clock runs.
             int game_status = current_game->evaluate_game_state();
-            if (game_status == -1) {
-                // Game ends in a tie.
-                Logger::log(__FILENAME__, __FUNCTION__, "Game ended in a tie.");
-                player->set_state("RESULT");
-                next_player->set_state("RESULT");
-                Responder::send_game_result(player, "TIE;" + std::to_string(player->get_score()) + ";" + std::to_string(next_player->get_score()));
-                Responder::send_game_result(next_player, "TIE;" + std::to_string(next_player->get_score()) + ";" + std::to_string(player->get_score()));
-            } else if (game_status == 1) {
-                // Player wins the game.
-                Logger::log(__FILENAME__, __FUNCTION__, "Player " + player->get_name() + " wins the game.");
-                player->add_score();
-                player->set_state("RESULT");
-                next_player->set_state("RESULT");
-                Responder::send_game_result(player, "WIN;" + std::to_string(player->get_score()) + ";" + std::to_string(next_player->get_score()));
-                Responder::send_game_result(next_player, "LOSE;" + std::to_string(next_player->get_score()) + ";" + std::to_string(player->get_score()));
-                current_game->set_previous_winner(player);
+            if (game_status != 0) {
+                finish_round(current_game, player, next_player, game_status);
+            } else {
+                arm_game_clock(current_game);
             }
             break;
         }
@@ -226,6 +389,128 @@ void GameAdmin::resolve_player_turn(Player* player, int row, int column) {
     }
 }
 
+void GameAdmin::finish_round(Game* game, Player* player, Player* opponent, int game_status) {
+    // The round is over; stop the clock first so the results carry the final times.
+    game->stop_clock();
+    player->takeback_requested = false;
+    opponent->takeback_requested = false;
+    if (game_status == -1) {
+        // Game ends in a tie.
+        Logger::log(__FILENAME__, __FUNCTION__, "Game ended in a tie.");
+        player->set_state("RESULT");
+        opponent->set_state("RESULT");
+        Responder::send_game_result(player, "TIE;" + std::to_string(player->get_score()) + ";" + std::to_string(opponent->get_score()));
+        Responder::send_game_result(opponent, "TIE;" + std::to_string(opponent->get_score()) + ";" + std::to_string(player->get_score()));
+        ReplayArchive::append_game(game, ReplayArchive::RESULT_TIE);
+        record_profile_result(player, opponent, true);
+    } else if (game_status == 1) {
+        // Player wins the game.
+        Logger::log(__FILENAME__, __FUNCTION__, "Player " + player->get_name() + " wins the game.");
+        player->add_score();
+        player->set_state("RESULT");
+        opponent->set_state("RESULT");
+        Responder::send_game_result(player, "WIN;" + std::to_string(player->get_score()) + ";" + std::to_string(opponent->get_score()));
+        Responder::send_game_result(opponent, "LOSE;" + std::to_string(opponent->get_score()) + ";" + std::to_string(player->get_score()));
+        game->set_previous_winner(player);
+        ReplayArchive::append_game(game, player == game->get_first_player() ? ReplayArchive::RESULT_PLAYER_ONE_WIN : ReplayArchive::RESULT_PLAYER_TWO_WIN);
+        record_profile_result(player, opponent, false);
+    }
+
+    // Finished tournament games are closed at once so the next round can be paired.
+    if (TournamentAdmin::is_tournament_game(game->get_game_id())) {
+        finish_tournament_game(game, game_status == 1 ? player : nullptr);
+    }
+}
+
+void GameAdmin::resolve_flag_fall(Game* game) {
+    // The player on turn ran out of time and loses the round to the opponent.
+    Player* flagged = (game->active_turn == game->get_first_player()->get_game_marker()) ? game->get_first_player() : game->get_second_player();
+    Player* opponent = game->get_opponent(flagged);
+    Logger::log(__FILENAME__, __FUNCTION__, "Player " + flagged->get_name() + " ran out of time in game " + std::to_string(game->get_game_id()));
+
+    Responder::update_player_status(flagged, "Your time ran out");
+    Responder::update_player_status(opponent, "Opponent ran out of time");
+    finish_round(game, opponent, flagged, 1);
+}
+
+void GameAdmin::arm_game_clock(Game* game) {
+    if (!game->is_clock_running()) {
+        return;
+    }
+
+    // A watcher already waiting for an earlier deadline re-arms itself when it wakes.
+    auto deadline = game->get_turn_deadline();
+    auto it = clock_watchers.find(game->get_game_id());
+    if (it != clock_watchers.end() && it->second.second <= deadline) {
+        return;
+    }
+    clock_watchers[game->get_game_id()] = std::make_pair(++clock_watcher_counter, deadline);
+    SessionAdmin::spawn(watch_game_clock(game->get_game_id(), clock_watcher_counter));
+}
+
+SessionTask GameAdmin::watch_game_clock(int game_id, uint64_t watcher) {
+    while (true) {
+        // Stop when a watcher with an earlier deadline took over.
+        auto it = clock_watchers.find(game_id);
+        if (it == clock_watchers.end() || it->second.first != watcher) {
+            co_return;
+        }
+        co_await SessionAdmin::sleep_until(it->second.second);
+
+        it = clock_watchers.find(game_id);
+        if (it == clock_watchers.end() || it->second.first != watcher) {
+            co_return;
+        }
+
+        // The game ended or its round is over; nothing to watch any more.
+        Game* game = get_active_game(game_id);
+        if (!game || !game->is_clock_running()) {
+            clock_watchers.erase(it);
+            co_return;
+        }
+        if (game->is_flag_fallen(Clock::now())) {
+            clock_watchers.erase(it);
+            resolve_flag_fall(game);
+            co_return;
+        }
+
+        // The player moved in time; wait for the deadline of the current turn.
+        it->second.second = game->get_turn_deadline();
+    }
+}
+
+void GameAdmin::resync_player(Player* player, Game* game, int seen_moves) {
+    // A delta is only valid within the round and revision the player last saw; anything else gets the full board.
+    int move_count = static_cast<int>(game->get_move_log().size());
+    if (seen_moves >= 0 && seen_moves <= move_count && player->get_synced_round() == game->get_round()
+        && player->get_synced_revision() == game->get_revision()) {
+        Responder::send_game_delta(player, game, seen_moves);
+    } else {
+        Responder::send_full_game_to_player(player, game);
+    }
+    player->set_synced(game->get_round(), game->get_revision(), move_count);
+}
+
+void GameAdmin::mark_synced(Game* game, Player* player) {
+    // Only a player whose connection is known to be up has surely received the latest move.
+    if (player->get_connection_status() >= 0 && player->get_socket() >= 0) {
+        player->set_synced(game->get_round(), game->get_revision(), static_cast<int>(game->get_move_log().size()));
+    }
+}
+
+void GameAdmin::record_profile_result(Player* first, Player* second, bool tie) {
+    // Persist the result and move both players to their new leaderboard positions.
+    ProfileStore::record_result(first->get_name(), second->get_name(), tie);
+
+    PlayerProfile profile;
+    if (ProfileStore::find_profile(first->get_name(), profile)) {
+        Leaderboard::update_player(first->get_name(), profile.rating);
+    }
+    if (ProfileStore::find_profile(second->get_name(), profile)) {
+        Leaderboard::update_player(second->get_name(), profile.rating);
+    }
+}
+
 Game* GameAdmin::get_active_game(int game_id) {
     // Retrieve the game instance from the active games map.
     auto it = active_games.find(game_id);
@@ -248,6 +533,10 @@ void GameAdmin::request_rematch(Player* player) {
 
         current_game->reset_game_board();
         current_game->active_turn = opponent->get_game_marker();
+        current_game->start_clock(current_game->get_time_control());
+        arm_game_clock(current_game);
+        mark_synced(current_game, player);
+        mark_synced(current_game, opponent);
 
         // Notify players about the rematch.
         Responder::update_player_state(player, "STARTING_GAME;" + opponent->get_name());
@@ -270,6 +559,50 @@ void GameAdmin::request_rematch(Player* player) {
     }
 }
 
+void GameAdmin::request_takeback(Player* player) {
+    Game* current_game = get_active_game(player->get_game_id());
+    Player* opponent = current_game->get_opponent(player);
+    Logger::log(__FILENAME__, __FUNCTION__, "Player " + player->get_name() + " requested a takeback.");
+
+    // A game already lost on time stays lost, even before the clock watcher fires.
+    auto now = Clock::now();
+    if (current_game->is_flag_fallen(now)) {
+        resolve_flag_fall(current_game);
+        return;
+    }
+
+    // Tournament results must stand, and a round without moves has nothing to take back.
+    if (TournamentAdmin::is_tournament_game(current_game->get_game_id()) || current_game->get_move_log().empty()) {
+        Responder::update_player_status(player, "Takeback not available");
+        return;
+    }
+
+    player->takeback_requested = true;
+    if (!opponent->takeback_requested) {
+        // Wait for the opponent to agree with a TAKEBACK of their own.
+        Responder::update_player_status(opponent, "Opponent requested a takeback");
+        return;
+    }
+
+    // Both players agreed: undo the last move; its player is on turn again without the move's increment.
+    int cell = current_game->get_move_log().back();
+    Player* mover = (player->get_game_marker() == current_game->active_turn) ? opponent : player;
+    current_game->take_back_turn(mover->get_game_marker(), now);
+    current_game->unmake_move();
+    player->takeback_requested = false;
+    opponent->takeback_requested = false;
+    Logger::log(__FILENAME__, __FUNCTION__, "Both players agreed to take back the move at cell " + std::to_string(cell) + " in game " + std::to_string(current_game->get_game_id()));
+
+    int row = cell / Game::BOARD_SIZE;
+    int column = cell % Game::BOARD_SIZE;
+    for (Player* participant : {player, opponent}) {
+        Responder::confirm_takeback(participant, row, column);
+        Responder::update_player_status(participant, participant->get_game_marker() == current_game->active_turn ? "Your turn" : "Opponent's turn");
+        mark_synced(current_game, participant);
+    }
+    arm_game_clock(current_game);
+}
+
 void GameAdmin::terminate_game(Player* player) {
     // Check if the player is associated with an active game.
     if (player->get_game_id() > 0) {
@@ -280,6 +613,7 @@ void GameAdmin::terminate_game(Player* player) {
 
         // Remove the game from the active games map.
         active_games.erase(game_instance->get_game_id());
+        LobbyDirectory::game_ended(game_instance->get_game_id());
 
         // Reset game stats for both players and notify them.
         player->reset_game_stats();
@@ -295,6 +629,10 @@ void GameAdmin::terminate_game(Player* player) {
         opponent->set_state("LOBBY");
 
         delete game_instance;
+
+        // The freed slot may let queued tournament games start.
+        TournamentAdmin::launch_pending_games();
+        schedule_admission();
     } else {
         // Log a message if the player is not in a game.
         Logger::log(__FILENAME__, __FUNCTION__, "Player " + player->get_name() + " is not in a game.");
@@ -336,7 +674,7 @@ void GameAdmin::notify_opponent(Player* player, const std::string& message) {
     }
 }
 
-void GameAdmin::restore_player_connection(Player* player, int new_socket) {
+void GameAdmin::restore_player_connection(Player* player, int new_socket, int seen_moves) {
     // Restore the player's connection and update their socket.
     player->set_connection_status(0);
     player->set_socket(new_socket);
@@ -351,8 +689,8 @@ void GameAdmin::restore_player_connection(Player* player, int new_socket) {
 
         player->set_state("IN_GAME");
 
-        // Send the full game state to the player.
-        Responder::send_full_game_to_player(player, associated_game);
+        // Send the moves the player missed, or the full game state.
+        resync_player(player, associated_game, seen_moves);
 
         // Notify the player and opponent of the current turn.
         if (associated_game->active_turn == player->get_game_marker()) {
@@ -371,11 +709,25 @@ void GameAdmin::restore_player_connection(Player* player, int new_socket) {
     }
 }
 
-void GameAdmin::resolve_player_login(int client_socket, const std::string& name) {
+bool GameAdmin::is_valid_name(const std::string& name) {
+    // Names are joined with ',' and ':' in the lobby, game and leaderboard lists, and clients split
+    // combined messages on '%'; none of them may appear in a name, nor may control characters.
+    if (name.empty() || name.length() >= 14) {
+        return false;
+    }
+    for (unsigned char character : name) {
+        if (character < 0x20 || character == 0x7f || character == ',' || character == ':' || character == '%') {
+            return false;
+        }
+    }
+    return true;
+}
+
+void GameAdmin::resolve_player_login(int client_socket, const std::string& name, int seen_moves) {
     // Log the player's login attempt with their name and socket ID.
     Logger::log(__FILENAME__, __FUNCTION__, "Processing login for socket: " + std::to_string(client_socket) + ", Player name: " + name);
 
-    if (!name.empty() && name.length() < 14) {
+    if (is_valid_name(name)) {
         // Check if the player name already exists among registered players.
         Player* existing_player = find_registered_player_by_name(name);
 
@@ -385,13 +737,18 @@ void GameAdmin::resolve_player_login(int client_socket, const std::string& name)
                 Logger::log(__FILENAME__, __FUNCTION__, "Name already in use: " + name + ", Connection status: " + std::to_string(existing_player->get_connection_status()));
                 Responder::send_to_socket(client_socket, "NAME_TAKEN");
             } else {
-                // Restore the connection for the existing player.
-                GameAdmin::restore_player_connection(existing_player, client_socket);
+                // Restore the connection for the existing player; the temporary player of this socket is no longer needed.
+                Player* temporary_player = find_unregistered_player_by_socket(client_socket);
+                unlogged_players.erase(client_socket);
+                Reaper::retire_player(temporary_player);
+                GameAdmin::restore_player_connection(existing_player, client_socket, seen_moves);
+                touch_profile(name);
                 Logger::log(__FILENAME__, __FUNCTION__, "Reconnection successful for player: " + existing_player->get_name());
             }
         } else {
             // Authenticate and register a new player if the name is not in use.
             GameAdmin::authenticate_and_register_player(client_socket, name);
+            touch_profile(name);
         }
     } else {
         // Log an error for invalid player names.
@@ -410,6 +767,81 @@ void GameAdmin::display_active_games() {
     }
 }
 
+void GameAdmin::send_replay(Player* player, uint64_t sequence) {
+    // Log the replay request.
+    Logger::log(__FILENAME__, __FUNCTION__, "Player " + player->get_name() + " requested replay " + std::to_string(sequence));
+
+    // Look the record up in the memory-mapped archive and stream it to the player.
+    ReplaySegment segment;
+    const ReplayRecord* record = nullptr;
+    if (ReplayArchive::find_record(sequence, segment, record)) {
+        Responder::send_replay(player, record);
+    } else {
+        Responder::update_player_state(player, "REPLAY_NOT_FOUND");
+    }
+}
+
+void GameAdmin::touch_profile(const std::string& name) {
+    // A profile created at this login enters the leaderboard with the initial rating.
+    if (ProfileStore::touch_profile(name)) {
+        Leaderboard::update_player(name, ProfileStore::INITIAL_RATING);
+    }
+}
+
+void GameAdmin::send_profile(Player* player) {
+    // Look the persistent profile up directly in the mapped store and hand it to the client.
+    PlayerProfile profile;
+    if (!ProfileStore::find_profile(player->get_name(), profile)) {
+        Responder::update_player_state(player, "PROFILE_NOT_FOUND");
+        return;
+    }
+    Logger::log(__FILENAME__, __FUNCTION__, "Known player: " + player->get_name() + ", Wins=" + std::to_string(profile.wins) + ", Losses=" + std::to_string(profile.losses) + ", Ties=" + std::to_string(profile.ties) + ", Rating=" + std::to_string(profile.rating));
+    Responder::update_player_state(player, "PROFILE;" + std::to_string(profile.wins) + ";" + std::to_string(profile.losses) + ";" + std::to_string(profile.ties) + ";" + std::to_string(profile.rating));
+}
+
+void GameAdmin::send_leaderboard(Player* player, int count) {
+    // Log the leaderboard request.
+    Logger::log(__FILENAME__, __FUNCTION__, "Player " + player->get_name() + " requested top " + std::to_string(count) + " players");
+
+    // Clamp the request to the cached list and answer with the player's own rank.
+    count = std::max(1, std::min(count, Leaderboard::CACHED_ENTRIES));
+    Responder::update_player_state(player, "LEADERBOARD;" + std::to_string(Leaderboard::get_rank(player->get_name())) + ";" + Leaderboard::get_top(count));
+}
+
+void GameAdmin::send_book_moves(Player* player, const std::string& moves) {
+    // Log the opening book request.
+    Logger::log(__FILENAME__, __FUNCTION__, "Player " + player->get_name() + " requested book moves after: " + moves);
+
+    // Replay the row,column pairs into a position; an illegal line finds no moves.
+    BookPosition position;
+    std::vector<std::string> cells = Responder::tokenize(moves, ",");
+    bool legal = cells.size() % 2 == 0;
+    for (size_t i = 0; legal && i + 1 < cells.size(); i += 2) {
+        try {
+            int row = std::stoi(cells[i]);
+            int column = std::stoi(cells[i + 1]);
+            legal = row >= 0 && column >= 0 && row < Game::BOARD_SIZE && column < Game::BOARD_SIZE && position.play(row * Game::BOARD_SIZE + column);
+        } catch (const std::exception& e) {
+            legal = false;
+        }
+    }
+
+    // Answer with the book moves, most played first.
+    std::vector<BookMove> book_moves;
+    if (legal) {
+        OpeningBook::probe(position, book_moves);
+    }
+    std::sort(book_moves.begin(), book_moves.end(), [](const BookMove& a, const BookMove& b) { return a.games > b.games; });
+    std::string answer = "BOOK;" + std::to_string(book_moves.size()) + ";";
+    for (size_t i = 0; i < book_moves.size(); ++i) {
+        answer += std::to_string(book_moves[i].row) + "," + std::to_string(book_moves[i].column) + "," + std::to_string(book_moves[i].games) + "," + std::to_string(book_moves[i].score);
+        if (i + 1 < book_moves.size()) {
+            answer += ",";
+        }
+    }
+    Responder::update_player_state(player, answer);
+}
+
 void GameAdmin::remove_player(Player* player) {
     // Log the start of the player removal process.
     Logger::log(__FILENAME__, __FUNCTION__, "Removing player: " + player->get_name() + ", Socket: " + std::to_string(player->get_socket()));
@@ -417,12 +849,17 @@ void GameAdmin::remove_player(Player* player) {
     // Mark the player as inactive and remove them from the logged players map.
     player->is_active = false;
     logged_players.erase(player->get_name());
+    LobbyDirectory::player_left(player->get_name());
+    LobbyDirectory::unsubscribe_all(player);
+    ShardDirectory::withdraw_waiting(player->get_name());
+    ShardDirectory::unplace(player->get_name(), ShardDirectory::get_local_shard());
 
     Logger::log(__FILENAME__, __FUNCTION__, "Player removed from logged players. Checking queue.");
 
-    // Remove the player from the queue if present.
+    // Remove the player from the queues if present.
     auto queue_size = static_cast<int>(players_queue.size());
     remove_player_from_queue(player, queue_size, 0);
+    withdraw_from_admission(player);
 
     // Notify the player about the exit.
     Responder::update_player_state(player, "EXIT");
@@ -432,20 +869,58 @@ void GameAdmin::remove_player(Player* player) {
         force_game_exit(player);
     }
 
-    // Log and manage the player's ping thread termination.
-    Logger::log(__FILENAME__, __FUNCTION__, "Player's game ID reset. Shutting down ping thread.");
-    while (player->thread_running) {
-        std::this_thread::sleep_for(std::chrono::seconds(2));
-    }
+    // Leave any tournament the player registered for.
+    TournamentAdmin::withdraw_player(player);
+
+    // The heartbeat sees the inactive player on its next tick and ends by itself.
+    Logger::log(__FILENAME__, __FUNCTION__, "Player's game ID reset. Heartbeat stops at its next tick.");
 
     // Close the player's socket connection if valid.
     if (player->get_socket() != -1) {
         Server::closeConnection(player->get_socket());
     }
 
+    // The reaper deletes the player once the heartbeat has ended.
+    Reaper::retire_player(player);
     Logger::log(__FILENAME__, __FUNCTION__, "Player removal complete: " + player->get_name());
 }
 
+void GameAdmin::release_migrated_player(Player* player) {
+    // The connection now belongs to another shard; drop the player here without telling the client.
+    Logger::log(__FILENAME__, __FUNCTION__, "Releasing migrated player: " + player->get_name());
+
+    auto queue_size = static_cast<int>(players_queue.size());
+    remove_player_from_queue(player, queue_size, 0);
+    withdraw_from_admission(player);
+    logged_players.erase(player->get_name());
+    LobbyDirectory::player_left(player->get_name());
+    LobbyDirectory::unsubscribe_all(player);
+    TournamentAdmin::withdraw_player(player);
+
+    // The heartbeat ends at its next tick, then the reaper deletes the player.
+    player->is_active = false;
+    player->set_socket(-1);
+    Reaper::retire_player(player);
+}
+
+void GameAdmin::adopt_migrated_player(int client_socket, const std::string& player_name) {
+    Logger::log(__FILENAME__, __FUNCTION__, "Adopting migrated player: Name=" + player_name + ", Socket=" + std::to_string(client_socket));
+
+    // A stale placement may bring a name this shard already knows; settle it like a login.
+    if (find_registered_player_by_name(player_name)) {
+        resolve_player_login(client_socket, player_name, 0);
+        return;
+    }
+
+    // The player keeps searching here, where an opponent claimed them.
+    authenticate_and_register_player(client_socket, player_name, false);
+    touch_profile(player_name);
+    Player* player = find_registered_player_by_name(player_name);
+    if (player) {
+        initiate_game_search(player);
+    }
+}
+
 void GameAdmin::remove_player_from_queue(Player* player, int total, int current) {
     // Base case: Stop recursion if the queue is empty or all elements are processed.
     if (players_queue.empty() || current == total) {
@@ -472,6 +947,7 @@ void GameAdmin::configure_max_games(int max_games) {
     // Update the maximum number of active games allowed.
     GameAdmin::MAX_GAMES = max_games;
     Logger::log(__FILENAME__, __FUNCTION__, "Maximum games updated to " + std::to_string(max_games));
+    schedule_admission();
 }
 
 void GameAdmin::force_game_exit(Player* player) {
@@ -484,22 +960,350 @@ void GameAdmin::force_game_exit(Player* player) {
 
         // Remove the game from the active games map.
         active_games.erase(game_instance->get_game_id());
+        LobbyDirectory::game_ended(game_instance->get_game_id());
+
+        // Archive the unfinished round so its moves are not lost.
+        if (!game_instance->get_move_log().empty() && game_instance->evaluate_game_state() == 0) {
+            ReplayArchive::append_game(game_instance, ReplayArchive::RESULT_ABANDONED);
+        }
 
         // Reset the opponent's stats and state.
         Player* opponent = game_instance->get_opponent(player);
         opponent->reset_game_stats();
-        opponent->set_state("LOBBY");
+        bool tournament_game = TournamentAdmin::is_tournament_game(game_instance->get_game_id());
 
-        // Notify the opponent about the game termination.
-        Responder::update_player_state(opponent, "LOBBY");
+        // Notify the opponent about the game termination; tournament players wait for the next round.
+        if (tournament_game) {
+            opponent->set_state("WAITING");
+            Responder::update_player_state(opponent, "WAITING");
+        } else {
+            opponent->set_state("LOBBY");
+            Responder::update_player_state(opponent, "LOBBY");
+        }
         Responder::update_player_status(opponent, "Opponent did not return.");
 
-        // Delete the game instance.
+        // Delete the game instance; a tournament game is forfeited to the opponent.
+        int game_id = game_instance->get_game_id();
         delete game_instance;
+        if (tournament_game) {
+            TournamentAdmin::report_result(game_id, opponent);
+        }
+        TournamentAdmin::launch_pending_games();
+        schedule_admission();
+    }
+}
+
+bool GameAdmin::reap_game(int game_id, int& strikes) {
+    // Games that ended the regular way are gone already.
+    Game* game = get_active_game(game_id);
+    if (!game) {
+        return false;
+    }
+
+    // A player still belongs to the game only while registered and pointing back at it.
+    auto attached = [game_id](Player* player) {
+        auto it = logged_players.find(player->get_name());
+        return player->is_active && it != logged_players.end() && it->second == player && player->get_game_id() == game_id;
+    };
+    Player* first = game->get_first_player();
+    Player* second = game->get_second_player();
+
+    if (attached(first) && attached(second)) {
+        // Give both players longer than the heartbeat timeout before closing a game nobody plays.
+        if (first->get_connection_status() < 0 && second->get_connection_status() < 0) {
+            if (++strikes < Reaper::MAX_STRIKES) {
+                return true;
+            }
+        } else {
+            strikes = 0;
+            return true;
+        }
+    }
+
+    close_orphaned_game(game);
+    return false;
+}
+
+void GameAdmin::close_orphaned_game(Game* game) {
+    // Log the game the reaper is closing.
+    int game_id = game->get_game_id();
+    Logger::log(__FILENAME__, __FUNCTION__, "Reaping orphaned game: " + std::to_string(game_id));
+
+    // Remove the game and archive the unfinished round.
+    active_games.erase(game_id);
+    LobbyDirectory::game_ended(game_id);
+    if (!game->get_move_log().empty() && game->evaluate_game_state() == 0) {
+        ReplayArchive::append_game(game, ReplayArchive::RESULT_ABANDONED);
+    }
+
+    // Release whichever players still point at the game; connected ones are told why.
+    bool tournament_game = TournamentAdmin::is_tournament_game(game_id);
+    Player* survivor = nullptr;
+    Player* players[] = {game->get_first_player(), game->get_second_player()};
+    for (Player* player : players) {
+        auto it = logged_players.find(player->get_name());
+        if (!player->is_active || it == logged_players.end() || it->second != player || player->get_game_id() != game_id) {
+            continue;
+        }
+
+        player->reset_game_stats();
+        std::string state = tournament_game ? "WAITING" : "LOBBY";
+        player->set_state(state);
+        if (player->get_connection_status() >= 0 && player->get_socket() >= 0) {
+            survivor = player;
+            Responder::update_player_state(player, state);
+            Responder::update_player_status(player, "Opponent did not return.");
+        }
     }
+
+    // Delete the game; a tournament game goes to the player who is still there.
+    delete game;
+    if (tournament_game) {
+        TournamentAdmin::report_result(game_id, survivor);
+    }
+    TournamentAdmin::launch_pending_games();
+    schedule_admission();
+}
+
+bool GameAdmin::reap_connection(int socket) {
+    Player* player = find_unregistered_player_by_socket(socket);
+    if (!player) {
+        return false;
+    }
+
+    // Keep watching while the connection is alive and still has to send its name.
+    if (player->get_state() == "NEW" && SessionAdmin::has_session(socket) && !find_registered_player_by_socket(socket)) {
+        return true;
+    }
+
+    Logger::log(__FILENAME__, __FUNCTION__, "Reaping stale unregistered player: Socket=" + std::to_string(socket));
+    unlogged_players.erase(socket);
+    Reaper::retire_player(player);
+    return false;
 }
 
-void GameAdmin::monitor_player_ping(Player* player)
+std::vector<int> GameAdmin::connected_sockets() {
+    // Every socket still owned by a player, registered or not.
+    std::set<int> sockets;
+    for (const auto& [name, player] : logged_players) {
+        if (player->get_socket() >= 0) {
+            sockets.insert(player->get_socket());
+        }
+    }
+    for (const auto& [socket, player] : unlogged_players) {
+        if (socket >= 0) {
+            sockets.insert(socket);
+        }
+    }
+    return std::vector<int>(sockets.begin(), sockets.end());
+}
+
+void GameAdmin::save_player(HandoffBuffer& buffer, Player* player) {
+    // Write out everything the successor needs to recreate the player.
+    buffer.put_string(player->get_name());
+    buffer.put_string(player->get_ip_address());
+    buffer.put_string(player->get_state());
+    buffer.put_int(player->get_socket());
+    buffer.put_int(player->get_game_id());
+    buffer.put_int(player->get_connection_status());
+    buffer.put_int(player->get_score());
+    buffer.put_int(player->get_game_marker());
+    buffer.put_int(player->get_invalid_msg_count());
+    buffer.put_int(player->rematch_requested ? 1 : 0);
+    buffer.put_int(player->takeback_requested ? 1 : 0);
+}
+
+Player* GameAdmin::restore_player(HandoffBuffer& buffer, const std::map<int, int>& sockets) {
+    std::string name, ip_address, state;
+    int32_t socket, game_id, connection_status, score, game_marker, invalid_count, rematch, takeback;
+    if (!buffer.get_string(name) || !buffer.get_string(ip_address) || !buffer.get_string(state) || !buffer.get_int(socket) ||
+        !buffer.get_int(game_id) || !buffer.get_int(connection_status) || !buffer.get_int(score) || !buffer.get_int(game_marker) ||
+        !buffer.get_int(invalid_count) || !buffer.get_int(rematch) || !buffer.get_int(takeback)) {
+        return nullptr;
+    }
+
+    // Translate the predecessor's socket number to the descriptor received for it.
+    auto mapped = sockets.find(socket);
+    Player* player = new Player(ip_address, mapped != sockets.end() ? mapped->second : -1);
+    player->set_name(name);
+    player->set_state(state);
+    player->set_game_id(game_id);
+    player->set_connection_status(connection_status);
+    player->set_score(score);
+    player->set_game_marker(game_marker);
+    player->set_invalid_msg_count(invalid_count);
+    player->rematch_requested = rematch != 0;
+    player->takeback_requested = takeback != 0;
+    player->ping = true;
+    return player;
+}
+
+void GameAdmin::save_state(std::string& state) {
+    HandoffBuffer buffer;
+    buffer.put_int(game_id_counter);
+
+    // Registered players, then connections that have not sent a name yet.
+    buffer.put_int(static_cast<int32_t>(logged_players.size()));
+    for (const auto& [name, player] : logged_players) {
+        save_player(buffer, player);
+    }
+    std::vector<Player*> unregistered;
+    for (const auto& [socket, player] : unlogged_players) {
+        if (socket >= 0 && !find_registered_player_by_socket(socket)) {
+            unregistered.push_back(player);
+        }
+    }
+    buffer.put_int(static_cast<int32_t>(unregistered.size()));
+    for (Player* player : unregistered) {
+        save_player(buffer, player);
+    }
+
+    // Games refer to their players by name; the board is rebuilt from the move log.
+    buffer.put_int(static_cast<int32_t>(active_games.size()));
+    for (const auto& [game_id, game] : active_games) {
+        buffer.put_int(game_id);
+        buffer.put_string(game->get_first_player()->get_name());
+        buffer.put_string(game->get_second_player()->get_name());
+        buffer.put_string(game->get_previous_winner() ? game->get_previous_winner()->get_name() : "");
+        buffer.put_int(game->active_turn);
+        buffer.put_int(game->get_first_turn());
+        buffer.put_string(std::string(game->get_move_log().begin(), game->get_move_log().end()));
+
+        // Clocks travel as banks with the running turn already charged.
+        auto now = Clock::now();
+        buffer.put_int(game->get_time_control().base_ms);
+        buffer.put_int(game->get_time_control().increment_ms);
+        buffer.put_int(game->get_time_control().move_limit_ms);
+        buffer.put_int(game->get_bank(1, now));
+        buffer.put_int(game->get_bank(2, now));
+        buffer.put_int(game->is_clock_running() ? 1 : 0);
+    }
+
+    // The matchmaking queue from top to bottom.
+    stack<Player*> queue = players_queue;
+    buffer.put_int(static_cast<int32_t>(queue.size()));
+    while (!queue.empty()) {
+        buffer.put_string(queue.top()->get_name());
+        queue.pop();
+    }
+
+    // The searches held for a free slot, in arrival order.
+    buffer.put_int(static_cast<int32_t>(admission_queue.size()));
+    for (Player* player : admission_queue) {
+        buffer.put_string(player->get_name());
+    }
+
+    state = buffer.get_data();
+}
+
+bool GameAdmin::restore_state(const std::string& state, const std::map<int, int>& sockets) {
+    HandoffBuffer buffer(state);
+    int32_t counter, count;
+    if (!buffer.get_int(counter) || !buffer.get_int(count)) {
+        return false;
+    }
+    game_id_counter = counter;
+
+    // Registered players get their heartbeat back right away.
+    for (int32_t i = 0; i < count; ++i) {
+        Player* player = restore_player(buffer, sockets);
+        if (!player) {
+            return false;
+        }
+        logged_players[player->get_name()] = player;
+        player->heartbeat_running = true;
+        SessionAdmin::spawn(monitor_player_ping(player));
+    }
+    if (!buffer.get_int(count)) {
+        return false;
+    }
+    for (int32_t i = 0; i < count; ++i) {
+        Player* player = restore_player(buffer, sockets);
+        if (!player) {
+            return false;
+        }
+        unlogged_players[player->get_socket()] = player;
+        Reaper::watch_connection(player->get_socket());
+    }
+
+    // Recreate the games and replay their current rounds.
+    if (!buffer.get_int(count)) {
+        return false;
+    }
+    for (int32_t i = 0; i < count; ++i) {
+        int32_t game_id, active_turn, first_turn, base_ms, increment_ms, move_limit_ms, first_bank, second_bank, clock_running;
+        std::string first_name, second_name, winner_name, moves;
+        if (!buffer.get_int(game_id) || !buffer.get_string(first_name) || !buffer.get_string(second_name) || !buffer.get_string(winner_name) ||
+            !buffer.get_int(active_turn) || !buffer.get_int(first_turn) || !buffer.get_string(moves) || !buffer.get_int(base_ms) ||
+            !buffer.get_int(increment_ms) || !buffer.get_int(move_limit_ms) || !buffer.get_int(first_bank) || !buffer.get_int(second_bank) ||
+            !buffer.get_int(clock_running)) {
+            return false;
+        }
+        Player* first = find_registered_player_by_name(first_name);
+        Player* second = find_registered_player_by_name(second_name);
+        if (!first || !second) {
+            return false;
+        }
+
+        Game* game = new Game(game_id, first, second);
+        active_games[game_id] = game;
+        Reaper::watch_game(game_id);
+        game->set_previous_winner(find_registered_player_by_name(winner_name));
+        if (!game->restore_round(std::vector<unsigned char>(moves.begin(), moves.end()), first_turn, active_turn)) {
+            Logger::log(__FILENAME__, __FUNCTION__, "Error: Unable to replay game " + std::to_string(game_id));
+            return false;
+        }
+        game->restore_clock(TimeControl{base_ms, increment_ms, move_limit_ms}, first_bank, second_bank, clock_running != 0);
+        arm_game_clock(game);
+    }
+
+    // Rebuild the queue bottom up.
+    if (!buffer.get_int(count)) {
+        return false;
+    }
+    std::vector<Player*> queued;
+    for (int32_t i = 0; i < count; ++i) {
+        std::string name;
+        if (!buffer.get_string(name)) {
+            return false;
+        }
+        if (Player* player = find_registered_player_by_name(name)) {
+            queued.push_back(player);
+        }
+    }
+    for (auto it = queued.rbegin(); it != queued.rend(); ++it) {
+        players_queue.push(*it);
+    }
+
+    if (!buffer.get_int(count)) {
+        return false;
+    }
+    for (int32_t i = 0; i < count; ++i) {
+        std::string name;
+        if (!buffer.get_string(name)) {
+            return false;
+        }
+        if (Player* player = find_registered_player_by_name(name)) {
+            admission_queue.push_back(player);
+            queued.push_back(player);
+        }
+    }
+    schedule_admission();
+
+    // Tournaments are not carried over; their waiting players go back to the lobby.
+    for (const auto& [name, player] : logged_players) {
+        if (player->get_state() == "WAITING" && player->get_game_id() == 0 && std::find(queued.begin(), queued.end(), player) == queued.end()) {
+            player->set_state("LOBBY");
+            Responder::update_player_state(player, "LOBBY");
+            Responder::update_player_status(player, "Tournament cancelled by a server restart");
+        }
+    }
+
+    Logger::log(__FILENAME__, __FUNCTION__, "Restored " + std::to_string(logged_players.size()) + " players and " + std::to_string(active_games.size()) + " games");
+    return buffer.is_consumed();
+}
+
+SessionTask GameAdmin::monitor_player_ping(Player* player)
 {
     int i = 0;
     while (true) {
@@ -508,18 +1312,23 @@ void GameAdmin::monitor_player_ping(Player* player)
             break;
         }
 
-        // Check if the player's socket is valid and active.
+        // Ping only players that have been quiet for a whole interval; any traffic proves the connection.
+        int interval = player->get_heartbeat_interval();
+        bool suppressed = false;
         if (player->get_socket() > 0) {
-            if (player->is_active) {
-                // Send a ping to the player.
-                Responder::ping_player(player);
+            if (Clock::now() - player->get_last_seen() < std::chrono::milliseconds(interval)) {
+                suppressed = true;
             } else {
-                break;
+                Responder::ping_player(player);
             }
         }
 
-        // Wait for the specified ping interval before the next check.
-        sleep(PING_INTERVAL);
+        // Wait for the player's ping interval before the next check.
+        co_await SessionAdmin::sleep_for_milliseconds(interval);
+
+        // Players in a game keep the base interval so their opponent learns about a drop quickly.
+        const ServerConfig &config = Config::get();
+        int max_interval = (player->get_game_id() != 0) ? config.ping_interval : config.max_ping_interval;
 
         if (player->ping) {
             // Handle a successful ping response.
@@ -535,7 +1344,7 @@ void GameAdmin::monitor_player_ping(Player* player)
 
                     player->set_state("IN_GAME");
 
-                    Responder::send_full_game_to_player(player, game);
+                    resync_player(player, game, player->get_synced_moves());
 
                     if (game->active_turn == player->get_game_marker()) {
                         Responder::update_player_status(player, "You are on Turn");
@@ -553,26 +1362,30 @@ void GameAdmin::monitor_player_ping(Player* player)
             i = 0;
             player->ping = false;
             player->set_connection_status(0);
+            player->adapt_heartbeat_interval(config.ping_interval * 1000, max_interval * 1000, true);
+        } else if (suppressed) {
+            // Quiet since the skipped ping; the next round pings.
+            continue;
         } else {
             // Handle cases where the player does not respond to pings.
             if (player->get_connection_status() >= 0) {
                 GameAdmin::handle_player_disconnect(player->get_socket());
             }
 
-            i += PING_INTERVAL;
-            if (i >= TIMEOUT) {
-                // Remove the player after timeout and close the ping thread.
-                player->thread_running = false;
+            player->adapt_heartbeat_interval(config.ping_interval * 1000, max_interval * 1000, false);
+            i += interval;
+            if (i >= config.timeout * 1000) {
+                // Remove the player after timeout and end the heartbeat.
+                player->heartbeat_running = false;
                 GameAdmin::remove_player(player);
-                Logger::log(__FILENAME__, __FUNCTION__, "Ping thread for player: " + player->get_name() + " has been closed");
-                pthread_exit(0);
+                Logger::log(__FILENAME__, __FUNCTION__, "Heartbeat for player: " + player->get_name() + " has been closed");
+                co_return;
             }
         }
     }
 
-    // Ensure the thread exits cleanly when the player manually exits the game.
-    player->thread_running = false;
-    Logger::log(__FILENAME__, __FUNCTION__, "Ping thread for player: " + player->get_name() + " has been closed");
-    pthread_exit(0);
+    // End the heartbeat cleanly when the player manually exits the game.
+    player->heartbeat_running = false;
+    Logger::log(__FILENAME__, __FUNCTION__, "Heartbeat for player: " + player->get_name() + " has been closed");
 }
 
@@ -5,8 +5,9 @@
 
 #include <stdio.h>
 #include <map>
+#include <set>
+#include <deque>
 #include <stack>
-#include <thread>
 #include <unistd.h>
 
 #include <algorithm>
@@ -17,6 +18,17 @@
 #include "Game.hpp"
 #include "Responder.hpp"
 #include "Server.hpp"
+#include "ReplayArchive.hpp"
+#include "ProfileStore.hpp"
+#include "Leaderboard.hpp"
+#include "Tournament.hpp"
+#include "Session.hpp"
+#include "HotRestart.hpp"
+#include "Reaper.hpp"
+#include "OpeningBook.hpp"
+#include "LobbyDirectory.hpp"
+#include "ShardDirectory.hpp"
+#include "Config.hpp"
 #include "Logger.hpp"
 
 using namespace std;
@@ -33,16 +45,25 @@ class GameAdmin
         static void resolve_player_turn(Player* player, int row, int column);
     
         
-        static void authenticate_and_register_player(int client_socket, const std::string& player_name);
+        static void authenticate_and_register_player(int client_socket, const std::string& player_name, bool announce = true);
+        static void release_migrated_player(Player* player);
+        static void adopt_migrated_player(int client_socket, const std::string& player_name);
 
         static Game* get_active_game(int game_id);
         static void request_rematch(Player* player);
+        static void request_takeback(Player* player);
         static void terminate_game(Player* player);
         static void handle_player_disconnect(int socket_id);
-        static void restore_player_connection(Player* player, int new_socket);
+        static void restore_player_connection(Player* player, int new_socket, int seen_moves);
         static void display_active_games();
+        static void send_replay(Player* player, uint64_t sequence);
+        static void touch_profile(const std::string& name);
+        static void send_profile(Player* player);
+        static void send_leaderboard(Player* player, int count);
+        static void send_book_moves(Player* player, const std::string& moves);
     
-        static void resolve_player_login(int client_socket, const std::string& name);
+        static bool is_valid_name(const std::string& name);
+        static void resolve_player_login(int client_socket, const std::string& name, int seen_moves);
     
         static void player_ping(Player* pl);
         
@@ -50,26 +71,62 @@ class GameAdmin
         static void force_game_exit(Player* player);
     
         static int MAX_GAMES;
+        static TimeControl TIME_CONTROL;
+        static size_t MAX_ADMISSION_QUEUE;
+        static int ADMISSION_BATCH_MS;
         static void configure_max_games(int max_games);
+        static int available_game_slots();
+        static std::vector<int> initialize_games(const std::vector<std::pair<Player*, Player*> >& pairings, const TimeControl& time_control);
+
+        static std::vector<int> connected_sockets();
+        static void save_state(std::string& state);
+        static bool restore_state(const std::string& state, const std::map<int, int>& sockets);
+
+        static bool reap_game(int game_id, int& strikes);
+        static bool reap_connection(int socket);
     
         static void remove_player_from_queue(Player* player, int total, int current);
         static void notify_opponent(Player* player, const std::string& message);
     
-        static void monitor_player_ping(Player* player);
+        static SessionTask monitor_player_ping(Player* player);
         static std::map<string, Player*> logged_players;
         static std::map<int, Player*> unlogged_players;
+        static const std::map<int, Game*>& get_active_games() { return active_games; };
+        static size_t get_queue_length() { return players_queue.size(); };
+        static size_t get_admission_length() { return admission_queue.size(); };
+        static void schedule_admission();
         
     private:
     
     
         static std::map<int, Game*> active_games;
         static stack<Player*> players_queue;
+        static std::deque<Player*> admission_queue;
+        static bool admission_scheduled;
     
-        static void initialize_game(Player* player_one, Player* player_two);
+        static std::map<int, std::pair<uint64_t, std::chrono::steady_clock::time_point> > clock_watchers;
+        static uint64_t clock_watcher_counter;
+
+        static Game* initialize_game(Player* player_one, Player* player_two, const TimeControl& time_control);
+        static void finish_round(Game* game, Player* player, Player* opponent, int game_status);
+        static void finish_tournament_game(Game* game, Player* winner);
+        static void resolve_flag_fall(Game* game);
+        static void arm_game_clock(Game* game);
+        static void resync_player(Player* player, Game* game, int seen_moves);
+        static void mark_synced(Game* game, Player* player);
+        static SessionTask watch_game_clock(int game_id, uint64_t watcher);
+        static void close_orphaned_game(Game* game);
         static Player* search_for_opponent();
+        static void hold_for_admission(Player* player);
+        static void withdraw_from_admission(Player* player);
+        static void admit_waiting_players();
+        static SessionTask run_admission();
     
         static int game_id_counter;
         static void resolve_result(int client_socket, const std::string& name);
+        static void record_profile_result(Player* first, Player* second, bool tie);
+        static void save_player(HandoffBuffer& buffer, Player* player);
+        static Player* restore_player(HandoffBuffer& buffer, const std::map<int, int>& sockets);
 };
 
 
@@ -0,0 +1,296 @@
+#include "HotRestart.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+static const char HANDOFF_MAGIC[] = "UPSHOT5";
+
+int HotRestart::handoff_fd = -1;
+int HotRestart::successor_fd = -1;
+int HotRestart::predecessor_fd = -1;
+
+void HandoffBuffer::put_int(int32_t value) {
+    data.append(reinterpret_cast<const char *>(&value), sizeof(value));
+}
+
+void HandoffBuffer::put_string(const std::string &value) {
+    put_int(static_cast<int32_t>(value.size()));
+    data.append(value);
+}
+
+bool HandoffBuffer::get_int(int32_t &value) {
+    if (data.size() - offset < sizeof(value)) {
+        return false;
+    }
+    memcpy(&value, data.data() + offset, sizeof(value));
+    offset += sizeof(value);
+    return true;
+}
+
+bool HandoffBuffer::get_string(std::string &value) {
+    int32_t length;
+    if (!get_int(length) || length < 0 || data.size() - offset < static_cast<size_t>(length)) {
+        return false;
+    }
+    value.assign(data, offset, length);
+    offset += length;
+    return true;
+}
+
+// Sends one handoff message, optionally carrying descriptors as SCM_RIGHTS.
+bool HotRestart::send_message(int channel, const std::string &payload, const int *fds, int fd_count) {
+    iovec part;
+    part.iov_base = const_cast<char *>(payload.data());
+    part.iov_len = payload.size();
+
+    msghdr message;
+    memset(&message, 0, sizeof(message));
+    message.msg_iov = &part;
+    message.msg_iovlen = 1;
+
+    std::vector<char> control(CMSG_SPACE(sizeof(int) * fd_count));
+    if (fd_count > 0) {
+        message.msg_control = control.data();
+        message.msg_controllen = control.size();
+        cmsghdr *header = CMSG_FIRSTHDR(&message);
+        header->cmsg_level = SOL_SOCKET;
+        header->cmsg_type = SCM_RIGHTS;
+        header->cmsg_len = CMSG_LEN(sizeof(int) * fd_count);
+        memcpy(CMSG_DATA(header), fds, sizeof(int) * fd_count);
+    }
+    return sendmsg(channel, &message, MSG_NOSIGNAL) == static_cast<ssize_t>(payload.size());
+}
+
+// Receives one handoff message and the descriptors that came with it.
+bool HotRestart::receive_message(int channel, std::string &payload, std::vector<int> &fds) {
+    payload.resize(CHUNK_SIZE);
+    iovec part;
+    part.iov_base = &payload[0];
+    part.iov_len = payload.size();
+
+    std::vector<char> control(CMSG_SPACE(sizeof(int) * MAX_FDS_PER_MESSAGE));
+    msghdr message;
+    memset(&message, 0, sizeof(message));
+    message.msg_iov = &part;
+    message.msg_iovlen = 1;
+    message.msg_control = control.data();
+    message.msg_controllen = control.size();
+
+    ssize_t received = recvmsg(channel, &message, 0);
+    if (received <= 0 || (message.msg_flags & (MSG_TRUNC | MSG_CTRUNC))) {
+        return false;
+    }
+    payload.resize(received);
+
+    fds.clear();
+    for (cmsghdr *header = CMSG_FIRSTHDR(&message); header; header = CMSG_NXTHDR(&message, header)) {
+        if (header->cmsg_level == SOL_SOCKET && header->cmsg_type == SCM_RIGHTS) {
+            size_t count = (header->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+            const int *received_fds = reinterpret_cast<const int *>(CMSG_DATA(header));
+            fds.insert(fds.end(), received_fds, received_fds + count);
+        }
+    }
+    return true;
+}
+
+std::string HotRestart::handoff_path(int port) {
+    return "ups-" + std::to_string(port) + ".handoff";
+}
+
+bool HotRestart::listen_for_successor(int port) {
+    std::string path = handoff_path(port);
+
+    sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strncpy(address.sun_path, path.c_str(), sizeof(address.sun_path) - 1);
+
+    // A takeover replaces the socket file left by the previous process.
+    int fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    unlink(path.c_str());
+    if (fd < 0 || bind(fd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) < 0 || listen(fd, 1) < 0) {
+        Logger::log(__FILENAME__, __FUNCTION__, "Error: Unable to listen for a successor on " + path + ": " + std::string(strerror(errno)));
+        if (fd >= 0) {
+            close(fd);
+        }
+        return false;
+    }
+
+    handoff_fd = fd;
+    SessionAdmin::spawn(watch_for_successor());
+    Logger::log(__FILENAME__, __FUNCTION__, "Hot restart available through " + path);
+    return true;
+}
+
+SessionTask HotRestart::watch_for_successor() {
+    // Poll the handoff socket from the event loop until a successor connects.
+    while (handoff_fd >= 0 && successor_fd < 0) {
+        co_await SessionAdmin::sleep_for_milliseconds(POLL_INTERVAL_MS);
+
+        int fd = accept4(handoff_fd, nullptr, nullptr, SOCK_CLOEXEC);
+        if (fd < 0) {
+            continue;
+        }
+
+        // Only a process of the same user may take the server over.
+        struct ucred credentials;
+        socklen_t length = sizeof(credentials);
+        if (getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &credentials, &length) < 0 || credentials.uid != getuid()) {
+            Logger::log(__FILENAME__, __FUNCTION__, "Error: Rejected takeover request from another user");
+            close(fd);
+            continue;
+        }
+
+        successor_fd = fd;
+        Logger::log(__FILENAME__, __FUNCTION__, "Successor process " + std::to_string(credentials.pid) + " requested a takeover");
+    }
+}
+
+void HotRestart::close_successor() {
+    // Shut the channel down first so a successor waiting for the go-ahead sees it end, then wait for the next one.
+    shutdown(successor_fd, SHUT_RDWR);
+    close(successor_fd);
+    successor_fd = -1;
+    SessionAdmin::spawn(watch_for_successor());
+}
+
+bool HotRestart::hand_over(int listen_fd, const std::vector<int> &sockets, const std::string &state) {
+    Logger::log(__FILENAME__, __FUNCTION__, "Handing over " + std::to_string(sockets.size()) + " connections and " + std::to_string(state.size()) + " bytes of state");
+
+    // Header: magic, number of client sockets and size of the state blob.
+    HandoffBuffer header;
+    header.put_string(HANDOFF_MAGIC);
+    header.put_int(static_cast<int32_t>(sockets.size()));
+    header.put_int(static_cast<int32_t>(state.size()));
+    bool sent = send_message(successor_fd, header.get_data(), nullptr, 0);
+
+    // Descriptors go in batches, each message naming the old numbers of the sockets it carries.
+    std::vector<int> fds(1, listen_fd);
+    fds.insert(fds.end(), sockets.begin(), sockets.end());
+    for (size_t first = 0; sent && first < fds.size(); first += MAX_FDS_PER_MESSAGE) {
+        int count = static_cast<int>(std::min(fds.size() - first, static_cast<size_t>(MAX_FDS_PER_MESSAGE)));
+        HandoffBuffer numbers;
+        for (int i = 0; i < count; ++i) {
+            numbers.put_int(fds[first + i]);
+        }
+        sent = send_message(successor_fd, numbers.get_data(), &fds[first], count);
+    }
+
+    // The state follows in chunks that fit a single datagram.
+    for (size_t offset = 0; sent && offset < state.size(); offset += CHUNK_SIZE) {
+        sent = send_message(successor_fd, state.substr(offset, CHUNK_SIZE), nullptr, 0);
+    }
+
+    // Wait until the successor has restored everything before giving up the sockets. Every game is
+    // frozen meanwhile, so a successor that takes longer is given up on and told so by the shut down
+    // channel. Only the go-ahead sent here lets it serve, so exactly one process ever does.
+    char answer = 0;
+    char go_ahead = 'A';
+    struct timeval timeout = {CONFIRM_TIMEOUT_MS / 1000, (CONFIRM_TIMEOUT_MS % 1000) * 1000};
+    setsockopt(successor_fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    if (!sent || recv(successor_fd, &answer, 1, 0) != 1 || answer != 'Y' || send(successor_fd, &go_ahead, 1, MSG_NOSIGNAL) != 1) {
+        Logger::log(__FILENAME__, __FUNCTION__, "Error: Takeover failed, continuing to serve");
+        close_successor();
+        return false;
+    }
+
+    Logger::log(__FILENAME__, __FUNCTION__, "Takeover confirmed by the successor");
+    close(successor_fd);
+    close(handoff_fd);
+    successor_fd = -1;
+    handoff_fd = -1;
+    return true;
+}
+
+bool HotRestart::take_over(int port, int &listen_fd, std::map<int, int> &sockets, std::string &state) {
+    auto started = std::chrono::steady_clock::now();
+    std::string path = handoff_path(port);
+
+    sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strncpy(address.sun_path, path.c_str(), sizeof(address.sun_path) - 1);
+
+    // Connect to the running server; it answers within one poll interval.
+    int fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+    if (fd < 0 || connect(fd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) < 0) {
+        Logger::log(__FILENAME__, __FUNCTION__, "Error: No running server to take over at " + path + ": " + std::string(strerror(errno)));
+        if (fd >= 0) {
+            close(fd);
+        }
+        return false;
+    }
+
+    // Read the header.
+    std::string payload;
+    std::vector<int> fds;
+    std::string magic;
+    int32_t socket_count = 0;
+    int32_t state_size = 0;
+    HandoffBuffer header;
+    if (receive_message(fd, payload, fds)) {
+        header = HandoffBuffer(payload);
+    }
+    if (!header.get_string(magic) || magic != HANDOFF_MAGIC || !header.get_int(socket_count) || !header.get_int(state_size)) {
+        Logger::log(__FILENAME__, __FUNCTION__, "Error: Unexpected handoff header");
+        close(fd);
+        return false;
+    }
+
+    // Collect the descriptors and map the predecessor's socket numbers to ours.
+    listen_fd = -1;
+    sockets.clear();
+    int32_t remaining = socket_count + 1;
+    while (remaining > 0) {
+        HandoffBuffer numbers;
+        if (receive_message(fd, payload, fds)) {
+            numbers = HandoffBuffer(payload);
+        }
+        if (fds.empty() || payload.size() != fds.size() * sizeof(int32_t)) {
+            Logger::log(__FILENAME__, __FUNCTION__, "Error: Incomplete descriptor batch");
+            close(fd);
+            return false;
+        }
+        for (int received_fd : fds) {
+            int32_t old_number;
+            numbers.get_int(old_number);
+            if (listen_fd < 0) {
+                listen_fd = received_fd;
+            } else {
+                sockets[old_number] = received_fd;
+            }
+        }
+        remaining -= static_cast<int32_t>(fds.size());
+    }
+
+    // Reassemble the state blob.
+    state.clear();
+    while (static_cast<int32_t>(state.size()) < state_size) {
+        if (!receive_message(fd, payload, fds)) {
+            Logger::log(__FILENAME__, __FUNCTION__, "Error: Incomplete state transfer");
+            close(fd);
+            return false;
+        }
+        state += payload;
+    }
+
+    predecessor_fd = fd;
+    auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - started).count();
+    Logger::log(__FILENAME__, __FUNCTION__, "Received " + std::to_string(sockets.size()) + " connections and " + std::to_string(state.size()) + " bytes of state in " + std::to_string(elapsed) + " us");
+    return true;
+}
+
+bool HotRestart::confirm_takeover(bool restored) {
+    // Tell the predecessor whether to exit or to keep serving. After a success, serve only on its
+    // go-ahead; a channel that ends instead means it stopped waiting and serves on itself.
+    char answer = restored ? 'Y' : 'N';
+    char go_ahead = 0;
+    bool confirmed = send(predecessor_fd, &answer, 1, MSG_NOSIGNAL) == 1 && restored && recv(predecessor_fd, &go_ahead, 1, 0) == 1 && go_ahead == 'A';
+    close(predecessor_fd);
+    predecessor_fd = -1;
+    return confirmed;
+}
@@ -0,0 +1,63 @@
+#ifndef HotRestart_hpp
+#define HotRestart_hpp
+
+#include <stdint.h>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "Session.hpp"
+#include "Logger.hpp"
+
+// Compact binary encoding of the state handed to a successor process.
+class HandoffBuffer
+{
+public:
+    HandoffBuffer() : offset(0) {};
+    explicit HandoffBuffer(const std::string &bytes) : data(bytes), offset(0) {};
+
+    void put_int(int32_t value);
+    void put_string(const std::string &value);
+    bool get_int(int32_t &value);
+    bool get_string(std::string &value);
+
+    const std::string &get_data() const { return data; };
+    bool is_consumed() const { return offset == data.size(); };
+
+private:
+    std::string data;
+    size_t offset;
+};
+
+// Zero-downtime restart. A running server listens on a Unix socket next to its port; a new
+// binary started in takeover mode connects there and receives the listening socket, every
+// client socket (SCM_RIGHTS) and the serialized players and games, then carries on serving.
+class HotRestart
+{
+public:
+    static const int POLL_INTERVAL_MS = 100;
+    static const int MAX_FDS_PER_MESSAGE = 250;
+    static const int CHUNK_SIZE = 65536;
+    static const int CONFIRM_TIMEOUT_MS = 500;
+
+    static std::string handoff_path(int port);
+    static bool listen_for_successor(int port);
+    static bool is_requested() { return successor_fd >= 0; };
+
+    static bool hand_over(int listen_fd, const std::vector<int> &sockets, const std::string &state);
+    static bool take_over(int port, int &listen_fd, std::map<int, int> &sockets, std::string &state);
+    static bool confirm_takeover(bool restored);
+
+    static bool send_message(int channel, const std::string &payload, const int *fds, int fd_count);
+    static bool receive_message(int channel, std::string &payload, std::vector<int> &fds);
+
+private:
+    static int handoff_fd;
+    static int successor_fd;
+    static int predecessor_fd;
+
+    static SessionTask watch_for_successor();
+    static void close_successor();
+};
+
+#endif /* HotRestart_hpp */
@@ -0,0 +1,110 @@
+#include "Leaderboard.hpp"
+#include <algorithm>
+#include <cstring>
+
+const int Leaderboard::MAX_RATING;
+const int Leaderboard::CACHED_ENTRIES;
+
+int Leaderboard::fenwick[Leaderboard::MAX_RATING + 1];
+std::map<int, std::set<std::string> > Leaderboard::buckets;
+std::unordered_map<std::string, int> Leaderboard::player_buckets;
+std::string Leaderboard::cached_top;
+std::vector<size_t> Leaderboard::cached_offsets;
+bool Leaderboard::cache_valid = false;
+
+int Leaderboard::to_bucket(int rating) {
+    // Clamp the rating into the range covered by the tree.
+    if (rating < 0) {
+        return 0;
+    }
+    return (rating >= MAX_RATING) ? MAX_RATING - 1 : rating;
+}
+
+void Leaderboard::fenwick_add(int bucket, int delta) {
+    // Buckets are stored in descending rating order, so prefix sums count better players.
+    for (int i = MAX_RATING - bucket; i <= MAX_RATING; i += i & -i) {
+        fenwick[i] += delta;
+    }
+}
+
+int Leaderboard::fenwick_count_from(int bucket) {
+    // Number of players whose rating bucket is at least the given one.
+    int count = 0;
+    for (int i = MAX_RATING - bucket; i > 0; i -= i & -i) {
+        count += fenwick[i];
+    }
+    return count;
+}
+
+void Leaderboard::load_from_profiles() {
+    // Seed the ranking with every stored profile.
+    ProfileStore::for_each_profile([](const PlayerProfile &profile) {
+        Leaderboard::update_player(std::string(profile.name, strnlen(profile.name, sizeof(profile.name))), profile.rating);
+    });
+    Logger::log(__FILENAME__, __FUNCTION__, "Leaderboard loaded with " + std::to_string(player_buckets.size()) + " players");
+}
+
+void Leaderboard::update_player(const std::string &name, int rating) {
+    int bucket = to_bucket(rating);
+
+    // Move the player out of the old bucket if the rating changed.
+    std::unordered_map<std::string, int>::iterator it = player_buckets.find(name);
+    if (it != player_buckets.end()) {
+        if (it->second == bucket) {
+            return;
+        }
+        fenwick_add(it->second, -1);
+        std::map<int, std::set<std::string> >::iterator old_bucket = buckets.find(it->second);
+        old_bucket->second.erase(name);
+        if (old_bucket->second.empty()) {
+            buckets.erase(old_bucket);
+        }
+        it->second = bucket;
+    } else {
+        player_buckets.insert(std::make_pair(name, bucket));
+    }
+
+    // Insert the player into the new bucket and drop the serialized top list.
+    fenwick_add(bucket, 1);
+    buckets[bucket].insert(name);
+    cache_valid = false;
+}
+
+int Leaderboard::get_rank(const std::string &name) {
+    // Rank is one plus the number of players in strictly better buckets; ties share a rank.
+    std::unordered_map<std::string, int>::const_iterator it = player_buckets.find(name);
+    if (it == player_buckets.end()) {
+        return 0;
+    }
+    return (it->second + 1 < MAX_RATING ? fenwick_count_from(it->second + 1) : 0) + 1;
+}
+
+void Leaderboard::rebuild_cache() {
+    // Serialize the best players once; later requests cut a prefix of this string.
+    cached_top.clear();
+    cached_offsets.clear();
+    for (std::map<int, std::set<std::string> >::const_reverse_iterator bucket = buckets.rbegin();
+         bucket != buckets.rend() && static_cast<int>(cached_offsets.size()) < CACHED_ENTRIES; ++bucket) {
+        for (std::set<std::string>::const_iterator name = bucket->second.begin();
+             name != bucket->second.end() && static_cast<int>(cached_offsets.size()) < CACHED_ENTRIES; ++name) {
+            if (!cached_offsets.empty()) {
+                cached_top += ",";
+            }
+            cached_top += *name + ":" + std::to_string(bucket->first);
+            cached_offsets.push_back(cached_top.size());
+        }
+    }
+    cache_valid = true;
+}
+
+std::string Leaderboard::get_top(int count) {
+    // Answer from the cache, rebuilding it only after a score change.
+    if (!cache_valid) {
+        rebuild_cache();
+    }
+    if (count <= 0 || cached_offsets.empty()) {
+        return "";
+    }
+    size_t entries = std::min(static_cast<size_t>(count), cached_offsets.size());
+    return cached_top.substr(0, cached_offsets[entries - 1]);
+}
@@ -0,0 +1,41 @@
+#ifndef Leaderboard_hpp
+#define Leaderboard_hpp
+
+#include <map>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "ProfileStore.hpp"
+#include "Logger.hpp"
+
+// Ranks players by rating. A Fenwick tree over rating buckets answers rank queries in O(log n),
+// and the ordered map of non-empty buckets yields the top N players in O(N).
+class Leaderboard
+{
+public:
+    static const int MAX_RATING = 4096;
+    static const int CACHED_ENTRIES = 100;
+
+    static void load_from_profiles();
+    static void update_player(const std::string &name, int rating);
+    static int get_rank(const std::string &name);
+    static std::string get_top(int count);
+    static size_t get_size() { return player_buckets.size(); };
+
+private:
+    static int fenwick[MAX_RATING + 1];
+    static std::map<int, std::set<std::string> > buckets;
+    static std::unordered_map<std::string, int> player_buckets;
+    static std::string cached_top;
+    static std::vector<size_t> cached_offsets;
+    static bool cache_valid;
+
+    static int to_bucket(int rating);
+    static void fenwick_add(int bucket, int delta);
+    static int fenwick_count_from(int bucket);
+    static void rebuild_cache();
+};
+
+#endif /* Leaderboard_hpp */
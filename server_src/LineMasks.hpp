@@ -0,0 +1,120 @@
+#ifndef LineMasks_hpp
+#define LineMasks_hpp
+
+#include <stdint.h>
+#include <array>
+#include <utility>
+
+// One bit per cell of the board, bit row * SIZE + column.
+typedef unsigned __int128 CellMask;
+
+// Every window of LENGTH consecutive cells on a SIZE x SIZE board as a mask, and for every cell
+// the windows passing through it. Cells lie in fewer than MAX_PER_CELL windows near the edges;
+// their lists are padded with a sentinel window no board can fill, so a check always runs the
+// same number of mask tests.
+template <int SIZE, int LENGTH>
+struct LineMaskTable
+{
+    static_assert(SIZE * SIZE <= 127, "The board must leave a free bit for the sentinel window");
+    static_assert(LENGTH >= 1 && LENGTH <= SIZE, "Windows must fit on the board");
+
+    static constexpr int CELLS = SIZE * SIZE;
+    static constexpr int SPAN = SIZE - LENGTH + 1;
+    static constexpr int WINDOWS = 2 * SIZE * SPAN + 2 * SPAN * SPAN;
+    static constexpr int SENTINEL = WINDOWS;
+    static constexpr int MAX_PER_CELL = 4 * LENGTH;
+
+    CellMask windows[WINDOWS + 1];
+    uint16_t cell_windows[CELLS][MAX_PER_CELL];
+};
+
+// Builds the table at compile time: horizontal, vertical, diagonal and anti-diagonal windows.
+template <int SIZE, int LENGTH>
+constexpr LineMaskTable<SIZE, LENGTH> build_line_masks()
+{
+    typedef LineMaskTable<SIZE, LENGTH> Table;
+    Table table = {};
+    int counts[Table::CELLS] = {};
+    const int directions[4][2] = {{0, 1}, {1, 0}, {1, 1}, {1, -1}};
+
+    int window = 0;
+    for (const auto &direction : directions)
+    {
+        for (int row = 0; row < SIZE; ++row)
+        {
+            for (int column = 0; column < SIZE; ++column)
+            {
+                int last_row = row + direction[0] * (LENGTH - 1);
+                int last_column = column + direction[1] * (LENGTH - 1);
+                if (last_row >= SIZE || last_column < 0 || last_column >= SIZE)
+                    continue;
+
+                CellMask mask = 0;
+                for (int k = 0; k < LENGTH; ++k)
+                    mask |= CellMask(1) << ((row + direction[0] * k) * SIZE + column + direction[1] * k);
+                for (int k = 0; k < LENGTH; ++k)
+                {
+                    int cell = (row + direction[0] * k) * SIZE + column + direction[1] * k;
+                    table.cell_windows[cell][counts[cell]++] = window;
+                }
+                table.windows[window++] = mask;
+            }
+        }
+    }
+
+    table.windows[Table::SENTINEL] = ~CellMask(0);
+    for (int cell = 0; cell < Table::CELLS; ++cell)
+    {
+        for (int k = counts[cell]; k < Table::MAX_PER_CELL; ++k)
+            table.cell_windows[cell][k] = Table::SENTINEL;
+    }
+    return table;
+}
+
+template <int SIZE, int LENGTH>
+inline constexpr LineMaskTable<SIZE, LENGTH> LINE_MASKS = build_line_masks<SIZE, LENGTH>();
+
+// Length-independent view of one table, for win lengths chosen at run time.
+struct LineMaskView
+{
+    const CellMask *windows;
+    const uint16_t *cell_windows;
+    int per_cell;
+
+    // True if the player's cells fill a window through the given cell; no early exit.
+    bool completes_line(CellMask cells, int cell) const
+    {
+        const uint16_t *list = cell_windows + cell * per_cell;
+        bool complete = false;
+        for (int k = 0; k < per_cell; ++k)
+            complete |= (cells & windows[list[k]]) == windows[list[k]];
+        return complete;
+    }
+};
+
+template <int SIZE, int LENGTH>
+constexpr LineMaskView line_mask_view()
+{
+    return LineMaskView{LINE_MASKS<SIZE, LENGTH>.windows, &LINE_MASKS<SIZE, LENGTH>.cell_windows[0][0], LineMaskTable<SIZE, LENGTH>::MAX_PER_CELL};
+}
+
+template <int SIZE, int MIN_LENGTH, int... OFFSETS>
+constexpr std::array<LineMaskView, sizeof...(OFFSETS)> line_mask_views(std::integer_sequence<int, OFFSETS...>)
+{
+    return {line_mask_view<SIZE, MIN_LENGTH + OFFSETS>()...};
+}
+
+// The tables of a SIZE x SIZE board for every win length from MIN_LENGTH to SIZE.
+template <int SIZE, int MIN_LENGTH>
+class LineMasks
+{
+public:
+    static bool supports(int length) { return length >= MIN_LENGTH && length <= SIZE; };
+    static const LineMaskView &for_length(int length) { return views[length - MIN_LENGTH]; };
+
+private:
+    static constexpr std::array<LineMaskView, SIZE - MIN_LENGTH + 1> views =
+        line_mask_views<SIZE, MIN_LENGTH>(std::make_integer_sequence<int, SIZE - MIN_LENGTH + 1>());
+};
+
+#endif /* LineMasks_hpp */
@@ -0,0 +1,135 @@
+#include "LobbyDirectory.hpp"
+#include "GameAdmin.hpp"
+
+int LobbyDirectory::BROADCAST_INTERVAL_MS = 250;
+size_t LobbyDirectory::MAX_DELTA_CHANGES = 256;
+
+uint64_t LobbyDirectory::version[LobbyDirectory::TOPIC_COUNT] = {};
+uint64_t LobbyDirectory::broadcast_version[LobbyDirectory::TOPIC_COUNT] = {};
+std::vector<LobbyDirectory::Change> LobbyDirectory::pending[LobbyDirectory::TOPIC_COUNT];
+std::map<Player *, uint64_t> LobbyDirectory::subscribers[LobbyDirectory::TOPIC_COUNT];
+bool LobbyDirectory::has_stale_subscribers = false;
+
+static const char *SNAPSHOT_TYPES[LobbyDirectory::TOPIC_COUNT] = {"LOBBY_LIST", "GAMES_LIST"};
+static const char *DELTA_TYPES[LobbyDirectory::TOPIC_COUNT] = {"LOBBY_DELTA", "GAMES_DELTA"};
+
+void LobbyDirectory::start() {
+    SessionAdmin::spawn(run());
+    Logger::log(__FILENAME__, __FUNCTION__, "Lobby directory started: Interval=" + std::to_string(BROADCAST_INTERVAL_MS) + " ms");
+}
+
+SessionTask LobbyDirectory::run() {
+    while (true) {
+        co_await SessionAdmin::sleep_for_milliseconds(BROADCAST_INTERVAL_MS);
+        broadcast();
+    }
+}
+
+void LobbyDirectory::subscribe(Player *player, Topic topic) {
+    // The snapshot is taken at the topic's current version; later deltas start from there.
+    Logger::log(__FILENAME__, __FUNCTION__, "Player " + player->get_name() + " subscribed to " + SNAPSHOT_TYPES[topic]);
+    subscribers[topic][player] = version[topic];
+    Server::sendToClient(player->get_socket(), encode_snapshot(topic));
+}
+
+void LobbyDirectory::unsubscribe(Player *player, Topic topic) {
+    subscribers[topic].erase(player);
+}
+
+void LobbyDirectory::unsubscribe_all(Player *player) {
+    for (int topic = 0; topic < TOPIC_COUNT; ++topic) {
+        subscribers[topic].erase(player);
+    }
+}
+
+void LobbyDirectory::game_started(Game *game) {
+    record(GAMES, "+" + std::to_string(game->get_game_id()) + ":" + game->get_first_player()->get_name() + ":" + game->get_second_player()->get_name());
+}
+
+void LobbyDirectory::record(Topic topic, const std::string &text) {
+    // The log only holds the changes of one tick; it is cleared after every broadcast.
+    pending[topic].push_back(Change{++version[topic], text});
+}
+
+std::string LobbyDirectory::encode_snapshot(Topic topic) {
+    std::string items;
+    size_t count = 0;
+    if (topic == PLAYERS) {
+        for (const auto &[name, player] : GameAdmin::logged_players) {
+            items += (count++ ? "," : "") + name;
+        }
+    } else {
+        for (const auto &[game_id, game] : GameAdmin::get_active_games()) {
+            items += (count++ ? "," : "") + std::to_string(game_id) + ":" + game->get_first_player()->get_name() + ":" + game->get_second_player()->get_name();
+        }
+    }
+    return std::string(SNAPSHOT_TYPES[topic]) + ";" + std::to_string(version[topic]) + ";" + std::to_string(count) + ";" + items + ";\n";
+}
+
+std::string LobbyDirectory::encode_delta(Topic topic, uint64_t since) {
+    // Empty when the topic has no changes after the given version.
+    std::string items;
+    for (const Change &change : pending[topic]) {
+        if (change.version > since) {
+            items += (items.empty() ? "" : ",") + change.text;
+        }
+    }
+    if (items.empty()) {
+        return items;
+    }
+    return std::string(DELTA_TYPES[topic]) + ";" + std::to_string(since) + ";" + std::to_string(version[topic]) + ";" + items + ";\n";
+}
+
+void LobbyDirectory::broadcast() {
+    bool stale = has_stale_subscribers;
+    has_stale_subscribers = false;
+    for (int index = 0; index < TOPIC_COUNT; ++index) {
+        Topic topic = static_cast<Topic>(index);
+        if (!pending[topic].empty() || stale) {
+            broadcast_topic(topic);
+        }
+        pending[topic].clear();
+        broadcast_version[topic] = version[topic];
+    }
+}
+
+void LobbyDirectory::broadcast_topic(Topic topic) {
+    if (subscribers[topic].empty()) {
+        return;
+    }
+
+    // Subscribers further behind than the log need a snapshot.
+    uint64_t covered_since = pending[topic].empty() ? version[topic] : pending[topic].front().version - 1;
+    bool flood = pending[topic].size() > MAX_DELTA_CHANGES;
+
+    // One encoding serves every subscriber that saw the previous broadcast.
+    std::string shared = flood ? encode_snapshot(topic) : encode_delta(topic, broadcast_version[topic]);
+    std::string snapshot;
+    for (auto &[player, seen] : subscribers[topic]) {
+        if (seen == version[topic]) {
+            continue;
+        }
+        if (player->get_socket() <= 0) {
+            // Disconnected subscribers catch up with a snapshot once they are back.
+            has_stale_subscribers = true;
+            continue;
+        }
+
+        // A subscriber only moves on with a message that takes it there, so its deltas stay contiguous.
+        std::string message;
+        if (flood || seen == broadcast_version[topic]) {
+            message = shared;
+        } else if (seen >= covered_since) {
+            message = encode_delta(topic, seen);
+        } else {
+            if (snapshot.empty()) {
+                snapshot = encode_snapshot(topic);
+            }
+            message = snapshot;
+        }
+        if (!message.empty()) {
+            Server::sendToClient(player->get_socket(), message);
+            seen = version[topic];
+        }
+    }
+}
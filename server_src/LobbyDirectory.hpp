@@ -0,0 +1,63 @@
+#ifndef LobbyDirectory_hpp
+#define LobbyDirectory_hpp
+
+#include <stdint.h>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "Player.hpp"
+#include "Game.hpp"
+#include "Session.hpp"
+#include "Logger.hpp"
+
+// Live directory of online players and running games for subscribed clients. A subscriber gets a
+// snapshot first (LOBBY_LIST / GAMES_LIST) and batched deltas after that (LOBBY_DELTA / GAMES_DELTA).
+// Every change is encoded once into a log versioned per topic, so a topic's deltas chain from one
+// version to the next; each broadcast tick joins the new changes into one message per topic and
+// hands that same message to every subscriber that is up to date.
+class LobbyDirectory
+{
+public:
+    enum Topic
+    {
+        PLAYERS = 0,
+        GAMES = 1,
+        TOPIC_COUNT = 2
+    };
+
+    static int BROADCAST_INTERVAL_MS;
+    static size_t MAX_DELTA_CHANGES;
+
+    static void start();
+    static void subscribe(Player *player, Topic topic);
+    static void unsubscribe(Player *player, Topic topic);
+    static void unsubscribe_all(Player *player);
+
+    static void player_joined(const std::string &name) { record(PLAYERS, "+" + name); };
+    static void player_left(const std::string &name) { record(PLAYERS, "-" + name); };
+    static void game_started(Game *game);
+    static void game_ended(int game_id) { record(GAMES, "-" + std::to_string(game_id)); };
+
+private:
+    struct Change
+    {
+        uint64_t version;
+        std::string text;
+    };
+
+    static uint64_t version[TOPIC_COUNT];
+    static uint64_t broadcast_version[TOPIC_COUNT];
+    static std::vector<Change> pending[TOPIC_COUNT];
+    static std::map<Player *, uint64_t> subscribers[TOPIC_COUNT];
+    static bool has_stale_subscribers;
+
+    static void record(Topic topic, const std::string &text);
+    static std::string encode_snapshot(Topic topic);
+    static std::string encode_delta(Topic topic, uint64_t since);
+    static void broadcast();
+    static void broadcast_topic(Topic topic);
+    static SessionTask run();
+};
+
+#endif /* LobbyDirectory_hpp */
@@ -1,7 +1,15 @@
 #include "Logger.hpp"
 
+Logger::Level Logger::LEVEL = Logger::INFO;
+
 // Logs messages with a timestamp, source file, and function name.
 void Logger::log(string file, string function, string text) {
+    // Skip messages below the configured level.
+    Level level = (text.compare(0, 6, "Error:") == 0) ? ERROR : (text.compare(0, 8, "Warning:") == 0) ? WARNING : INFO;
+    if (level < LEVEL) {
+        return;
+    }
+
     // Get the current time.
     auto now = time(nullptr);
     char buffer[80];
@@ -15,6 +15,11 @@ using namespace std;
 class Logger
 {
 public:
+    enum Level { INFO, WARNING, ERROR, OFF };
+
+    // Messages below this level are dropped; the level of a message is read from its "Error:" or "Warning:" prefix.
+    static Level LEVEL;
+
     static void log(string filename, string function_name, string text);
     
 };
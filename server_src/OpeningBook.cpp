@@ -0,0 +1,224 @@
+#include "OpeningBook.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static const char BOOK_MAGIC[8] = {'U', 'P', 'S', 'B', 'O', 'O', 'K', '\0'};
+static const int CELL_COUNT = Game::BOARD_SIZE * Game::BOARD_SIZE;
+
+const char *OpeningBook::mapping = nullptr;
+size_t OpeningBook::mapping_length = 0;
+const OpeningBookEntry *OpeningBook::entries = nullptr;
+uint64_t OpeningBook::entry_count = 0;
+
+// Cell permutations of the 8 board symmetries and their inverses, computed once.
+struct SymmetryTables
+{
+    int forward[BookPosition::SYMMETRY_COUNT][CELL_COUNT];
+    int backward[BookPosition::SYMMETRY_COUNT][CELL_COUNT];
+
+    SymmetryTables() {
+        const int last = Game::BOARD_SIZE - 1;
+        for (int row = 0; row < Game::BOARD_SIZE; ++row) {
+            for (int column = 0; column < Game::BOARD_SIZE; ++column) {
+                // Identity, the three rotations, then the four reflections.
+                int images[BookPosition::SYMMETRY_COUNT][2] = {
+                    {row, column}, {column, last - row}, {last - row, last - column}, {last - column, row},
+                    {row, last - column}, {column, row}, {last - row, column}, {last - column, last - row}};
+                int cell = row * Game::BOARD_SIZE + column;
+                for (int symmetry = 0; symmetry < BookPosition::SYMMETRY_COUNT; ++symmetry) {
+                    int image = images[symmetry][0] * Game::BOARD_SIZE + images[symmetry][1];
+                    forward[symmetry][cell] = image;
+                    backward[symmetry][image] = cell;
+                }
+            }
+        }
+    }
+};
+
+static const SymmetryTables &symmetry_tables() {
+    static const SymmetryTables tables;
+    return tables;
+}
+
+// Random keys per cell and role, derived from a fixed seed so every build hashes alike.
+struct ZobristTable
+{
+    uint64_t keys[CELL_COUNT][2];
+
+    ZobristTable() {
+        uint64_t state = OpeningBook::ZOBRIST_SEED;
+        for (int cell = 0; cell < CELL_COUNT; ++cell) {
+            for (int role = 0; role < 2; ++role) {
+                // splitmix64
+                state += 0x9e3779b97f4a7c15ULL;
+                uint64_t value = state;
+                value = (value ^ (value >> 30)) * 0xbf58476d1ce4e5b9ULL;
+                value = (value ^ (value >> 27)) * 0x94d049bb133111ebULL;
+                keys[cell][role] = value ^ (value >> 31);
+            }
+        }
+    }
+};
+
+uint64_t OpeningBook::zobrist(int cell, int role) {
+    static const ZobristTable table;
+    return table.keys[cell][role];
+}
+
+BookPosition::BookPosition() : move_count(0) {
+    std::fill(hashes, hashes + SYMMETRY_COUNT, 0);
+}
+
+bool BookPosition::play(int cell) {
+    // Reject cells outside the board and cells already taken.
+    if (cell < 0 || cell >= CELL_COUNT || occupied.test(cell)) {
+        return false;
+    }
+    occupied.set(cell);
+
+    // Update the hash of every orientation with the stone of the player to move.
+    int role = move_count % 2;
+    for (int symmetry = 0; symmetry < SYMMETRY_COUNT; ++symmetry) {
+        hashes[symmetry] ^= OpeningBook::zobrist(symmetry_tables().forward[symmetry][cell], role);
+    }
+    move_count++;
+    return true;
+}
+
+int BookPosition::get_symmetry() const {
+    // The canonical orientation is the one with the smallest hash.
+    int best = 0;
+    for (int symmetry = 1; symmetry < SYMMETRY_COUNT; ++symmetry) {
+        best = (hashes[symmetry] < hashes[best]) ? symmetry : best;
+    }
+    return best;
+}
+
+int BookPosition::canonical_move(int cell) const {
+    // A position that is symmetric itself has several canonical orientations; taking the smallest
+    // image over all of them merges equivalent moves into one book entry.
+    uint64_t key = get_key();
+    int best = transform(get_symmetry(), cell);
+    for (int symmetry = 0; symmetry < SYMMETRY_COUNT; ++symmetry) {
+        if (hashes[symmetry] == key) {
+            best = std::min(best, transform(symmetry, cell));
+        }
+    }
+    return best;
+}
+
+int BookPosition::transform(int symmetry, int cell) {
+    return symmetry_tables().forward[symmetry][cell];
+}
+
+int BookPosition::inverse(int symmetry, int cell) {
+    return symmetry_tables().backward[symmetry][cell];
+}
+
+bool OpeningBook::open(const std::string &path) {
+    close();
+
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        Logger::log(__FILENAME__, __FUNCTION__, "No opening book at " + path);
+        return false;
+    }
+    struct stat file_info;
+    if (fstat(fd, &file_info) < 0 || static_cast<size_t>(file_info.st_size) < sizeof(OpeningBookHeader)) {
+        ::close(fd);
+        Logger::log(__FILENAME__, __FUNCTION__, "Error: Opening book " + path + " is too short");
+        return false;
+    }
+
+    void *mapped = mmap(nullptr, file_info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd); // The mapping keeps its own reference to the file.
+    if (mapped == MAP_FAILED) {
+        Logger::log(__FILENAME__, __FUNCTION__, "Error: Unable to map opening book " + path);
+        return false;
+    }
+    mapping = static_cast<const char *>(mapped);
+    mapping_length = static_cast<size_t>(file_info.st_size);
+
+    // Only the header is checked; the entries are used in place.
+    const OpeningBookHeader *header = reinterpret_cast<const OpeningBookHeader *>(mapping);
+    if (memcmp(header->magic, BOOK_MAGIC, sizeof(BOOK_MAGIC)) != 0 || header->version != FORMAT_VERSION ||
+        header->board_size != Game::BOARD_SIZE || header->zobrist_seed != ZOBRIST_SEED ||
+        header->entry_count > (mapping_length - sizeof(OpeningBookHeader)) / sizeof(OpeningBookEntry)) {
+        Logger::log(__FILENAME__, __FUNCTION__, "Error: " + path + " is not a compatible opening book");
+        close();
+        return false;
+    }
+    entries = reinterpret_cast<const OpeningBookEntry *>(mapping + sizeof(OpeningBookHeader));
+    entry_count = header->entry_count;
+
+    Logger::log(__FILENAME__, __FUNCTION__, "Opening book mapped: " + path + ", Entries=" + std::to_string(entry_count));
+    return true;
+}
+
+void OpeningBook::close() {
+    if (mapping) {
+        munmap(const_cast<char *>(mapping), mapping_length);
+    }
+    mapping = nullptr;
+    mapping_length = 0;
+    entries = nullptr;
+    entry_count = 0;
+}
+
+size_t OpeningBook::probe(const BookPosition &position, std::vector<BookMove> &moves) {
+    moves.clear();
+    if (!entries || entry_count == 0) {
+        return 0;
+    }
+
+    // Lower bound without data-dependent branches: the comparison only selects the step.
+    uint64_t key = position.get_key();
+    const OpeningBookEntry *base = entries;
+    size_t length = entry_count;
+    while (length > 1) {
+        size_t half = length / 2;
+        base += (base[half].key < key) ? half : 0;
+        length -= half;
+    }
+    base += (base->key < key) ? 1 : 0;
+
+    // Turn the canonical moves back into the orientation of the probed board.
+    int symmetry = position.get_symmetry();
+    const OpeningBookEntry *end = entries + entry_count;
+    for (; base < end && base->key == key; ++base) {
+        int cell = BookPosition::inverse(symmetry, base->move);
+        moves.push_back(BookMove{cell / Game::BOARD_SIZE, cell % Game::BOARD_SIZE, base->games, base->score});
+    }
+    return moves.size();
+}
+
+bool OpeningBook::write(const std::string &path, std::vector<OpeningBookEntry> &book) {
+    // Sort by position, then by move, so probes find all moves of a position side by side.
+    std::sort(book.begin(), book.end(), [](const OpeningBookEntry &a, const OpeningBookEntry &b) {
+        return a.key != b.key ? a.key < b.key : a.move < b.move;
+    });
+
+    OpeningBookHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, BOOK_MAGIC, sizeof(BOOK_MAGIC));
+    header.version = FORMAT_VERSION;
+    header.board_size = Game::BOARD_SIZE;
+    header.zobrist_seed = ZOBRIST_SEED;
+    header.entry_count = book.size();
+
+    // Write next to the target and rename, so a running server never maps a half-written book.
+    std::string temporary = path + ".tmp";
+    FILE *file = fopen(temporary.c_str(), "wb");
+    if (!file) {
+        return false;
+    }
+    bool written = fwrite(&header, sizeof(header), 1, file) == 1 &&
+                   (book.empty() || fwrite(book.data(), sizeof(OpeningBookEntry), book.size(), file) == book.size());
+    written = (fclose(file) == 0) && written;
+    return written && rename(temporary.c_str(), path.c_str()) == 0;
+}
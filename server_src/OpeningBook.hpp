@@ -0,0 +1,93 @@
+#ifndef OpeningBook_hpp
+#define OpeningBook_hpp
+
+#include <stdint.h>
+#include <stddef.h>
+#include <bitset>
+#include <string>
+#include <vector>
+
+#include "Game.hpp"
+#include "Logger.hpp"
+
+// Header at the beginning of a book file; the sorted entries follow it directly.
+struct OpeningBookHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t board_size;
+    uint64_t zobrist_seed;
+    uint64_t entry_count;
+    uint8_t reserved[32];
+};
+
+// One book move of one canonical position. Entries are sorted by key and move, so all moves
+// of a position are adjacent. The move is stored in the canonical orientation of the position.
+struct OpeningBookEntry
+{
+    uint64_t key;
+    uint32_t games;
+    uint32_t score;
+    uint8_t move;
+    uint8_t reserved[7];
+};
+
+// A book move translated back to the orientation of the probed board.
+// The score counts two points per win and one per tie for the player to move.
+struct BookMove
+{
+    int row;
+    int column;
+    uint32_t games;
+    uint32_t score;
+};
+
+// Position hashed under all 8 symmetries of the board at once. Stones are told apart by who
+// placed them (the opener or the other player), so the marker a player happens to use does not matter.
+class BookPosition
+{
+private:
+    uint64_t hashes[8];
+    std::bitset<Game::BOARD_SIZE * Game::BOARD_SIZE> occupied;
+    int move_count;
+
+public:
+    static const int SYMMETRY_COUNT = 8;
+
+    BookPosition();
+
+    bool play(int cell);
+    int get_move_count() const { return move_count; };
+    int get_symmetry() const;
+    uint64_t get_key() const { return hashes[get_symmetry()]; };
+    int canonical_move(int cell) const;
+
+    static int transform(int symmetry, int cell);
+    static int inverse(int symmetry, int cell);
+};
+
+// Read-only opening book mapped from disk. Opening only validates the header, and a probe is a
+// branch-free binary search over the mapped entries.
+class OpeningBook
+{
+public:
+    static const uint32_t FORMAT_VERSION = 1;
+    static const uint64_t ZOBRIST_SEED = 0x5550534f50454e31ULL;
+
+    static bool open(const std::string &path);
+    static void close();
+    static bool is_open() { return entries != nullptr; };
+    static uint64_t size() { return entry_count; };
+
+    static size_t probe(const BookPosition &position, std::vector<BookMove> &moves);
+    static bool write(const std::string &path, std::vector<OpeningBookEntry> &book);
+    static uint64_t zobrist(int cell, int role);
+
+private:
+    static const char *mapping;
+    static size_t mapping_length;
+    static const OpeningBookEntry *entries;
+    static uint64_t entry_count;
+};
+
+#endif /* OpeningBook_hpp */
@@ -1,16 +1,22 @@
 #include "Player.hpp"
+#include <algorithm>
+
+size_t Player::live_count = 0;
 
 // Constructor for Player initializes all member variables and logs the creation of a new player.
 Player::Player(const std::string &ip, int socket)
     : ip_address(ip), socket(socket), game_id(0), connection_status(0), player_score(0), game_marker(0),
-      invalid_msg_count(0), is_active(true), rematch_requested(false), thread_running(false), player_name("Unknown"),
-      state("NEW") {
+      invalid_msg_count(0), synced_round(0), synced_revision(0), synced_moves(0), player_name("Unknown"), state("NEW"),
+      last_seen(Clock::now()), ping_outstanding(false), busy(false), rtt_us(-1), heartbeat_interval_ms(1000), is_active(true),
+      heartbeat_running(false), rematch_requested(false), takeback_requested(false) {
+    live_count++;
     // Log the creation of the player with IP address and socket ID.
     Logger::log(__FILENAME__, __FUNCTION__, "Player created: IP=" + ip + ", Socket=" + std::to_string(socket));
 }
 
 // Destructor for Player logs the deletion of the player instance.
 Player::~Player() {
+    live_count--;
     // Log the deletion of the player using their socket ID.
     Logger::log(__FILENAME__, __FUNCTION__, "Player deleted: Socket=" + std::to_string(socket));
 }
@@ -33,3 +39,23 @@ void Player::reset_game_stats() {
     // Log the reset of game stats for the player.
     Logger::log(__FILENAME__, __FUNCTION__, "Game stats reset for player: " + get_name());
 }
+
+// Takes a round trip sample from the answer to the last server ping and smooths it like TCP does.
+// The answer proves the connection but leaves the quiet time alone, so the next ping is not skipped.
+void Player::record_ack(Clock::time_point now) {
+    ping = true;
+    if (!ping_outstanding) {
+        return;
+    }
+    ping_outstanding = false;
+    int sample = static_cast<int>(std::chrono::duration_cast<std::chrono::microseconds>(now - ping_sent).count());
+    rtt_us = (rtt_us < 0) ? sample : (7 * rtt_us + sample) / 8;
+}
+
+// Doubles the heartbeat interval after every quiet, answered interval up to the maximum; real
+// traffic or a missed answer go back to the base interval.
+void Player::adapt_heartbeat_interval(int base_ms, int max_ms, bool answered) {
+    heartbeat_interval_ms = (answered && !busy) ? std::min(2 * heartbeat_interval_ms, max_ms) : base_ms;
+    heartbeat_interval_ms = std::max(heartbeat_interval_ms, base_ms);
+    busy = false;
+}
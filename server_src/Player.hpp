@@ -2,7 +2,7 @@
 #define Player_hpp
 
 #include <iostream>
-#include <thread>
+#include "Clock.hpp"
 #include "Logger.hpp"
 
 class Player
@@ -15,27 +15,37 @@ private:
     int player_score;
     int game_marker;
     int invalid_msg_count;
-    std::thread ping_handler;
+    int synced_round;
+    int synced_revision;
+    int synced_moves;
     std::string player_name;
     std::string state;
     std::string message_in;
     std::string message_out;
+    Clock::time_point last_seen;
+    Clock::time_point ping_sent;
+    bool ping_outstanding;
+    bool busy;
+    int rtt_us;
+    int heartbeat_interval_ms;
+    static size_t live_count;
 
 public:
     Player(const std::string &ip, int socket);
     ~Player();
+    static size_t get_live_count() { return live_count; };
     bool ping;
     bool is_active;
-    bool thread_running;
+    bool heartbeat_running;
     bool rematch_requested;
+    bool takeback_requested;
     void set_name(const std::string &new_name);
     const std::string &get_name() const { return player_name; };
+    const std::string &get_ip_address() const { return ip_address; };
     const std::string &get_state() const { return state; };
     void set_state(const std::string &new_state) { state = new_state; };
     int get_game_marker() const { return game_marker; };
     void set_game_marker(int marker) { game_marker = marker; };
-    const std::thread &get_ping_handler() const { return ping_handler; };
-    void set_ping_handler(std::thread &&handler) { ping_handler = std::move(handler); };
     int get_connection_status() const { return connection_status; };
     void set_connection_status(int status) { connection_status = status; };
     int get_game_id() const { return game_id; };
@@ -54,6 +64,21 @@ public:
     void set_invalid_msg_count(int count) { invalid_msg_count = count; };
     void add_invalid_msg_count() { invalid_msg_count++; };
     void reset_game_stats();
+
+    int get_synced_round() const { return synced_round; };
+    int get_synced_revision() const { return synced_revision; };
+    int get_synced_moves() const { return synced_moves; };
+    void set_synced(int round, int revision, int moves) { synced_round = round; synced_revision = revision; synced_moves = moves; };
+
+    // Heartbeat bookkeeping: any inbound traffic proves the connection is alive, but only
+    // real messages keep the heartbeat interval short.
+    void mark_seen(Clock::time_point now, bool heartbeat) { ping = true; last_seen = now; busy = busy || !heartbeat; };
+    Clock::time_point get_last_seen() const { return last_seen; };
+    void mark_ping_sent(Clock::time_point now) { ping_sent = now; ping_outstanding = true; };
+    void record_ack(Clock::time_point now);
+    int get_rtt() const { return rtt_us; };
+    int get_heartbeat_interval() const { return heartbeat_interval_ms; };
+    void adapt_heartbeat_interval(int base_ms, int max_ms, bool answered);
 };
 
 #endif /* Player_hpp */
@@ -0,0 +1,289 @@
+#include "ProfileStore.hpp"
+#include <cerrno>
+#include <cmath>
+#include <cstring>
+#include <ctime>
+#include <thread>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static const char PROFILE_MAGIC[8] = {'U', 'P', 'S', 'P', 'R', 'O', 'F', '\0'};
+
+std::string ProfileStore::store_path;
+ProfileStoreHeader *ProfileStore::header = nullptr;
+PlayerProfile *ProfileStore::slots = nullptr;
+size_t ProfileStore::mapping_length = 0;
+std::mutex ProfileStore::update_mutex;
+std::mutex ProfileStore::mapping_mutex;
+
+bool ProfileStore::open(const std::string &path, uint64_t initial_capacity) {
+    std::lock_guard<std::mutex> lock(update_mutex);
+    store_path = path;
+
+    // Round the capacity up to a power of two so probing can mask instead of divide.
+    uint64_t capacity = 1;
+    while (capacity < initial_capacity) {
+        capacity <<= 1;
+    }
+
+    struct stat file_info;
+    bool exists = stat(path.c_str(), &file_info) == 0 && file_info.st_size > 0;
+    if (!map_store(path, capacity, !exists)) {
+        return false;
+    }
+
+    Logger::log(__FILENAME__, __FUNCTION__, "Profile store opened: " + path + ", Profiles=" + std::to_string(header->count) + ", Capacity=" + std::to_string(header->capacity));
+    return true;
+}
+
+void ProfileStore::close() {
+    std::lock_guard<std::mutex> update_lock(update_mutex);
+    std::lock_guard<std::mutex> mapping_lock(mapping_mutex);
+
+    // Write everything back and drop the mapping.
+    if (header) {
+        msync(header, mapping_length, MS_SYNC);
+        munmap(header, mapping_length);
+    }
+    header = nullptr;
+    slots = nullptr;
+    mapping_length = 0;
+}
+
+bool ProfileStore::map_store(const std::string &path, uint64_t capacity, bool create) {
+    int fd = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+    if (fd < 0) {
+        Logger::log(__FILENAME__, __FUNCTION__, "Error: Unable to open profile store " + path);
+        return false;
+    }
+
+    // A new store is sized up front; the file stays sparse until slots are written.
+    if (create) {
+        ProfileStoreHeader fresh;
+        memset(&fresh, 0, sizeof(fresh));
+        memcpy(fresh.magic, PROFILE_MAGIC, sizeof(PROFILE_MAGIC));
+        fresh.version = FORMAT_VERSION;
+        fresh.capacity = capacity;
+
+        if (ftruncate(fd, sizeof(ProfileStoreHeader) + capacity * sizeof(PlayerProfile)) < 0 ||
+            pwrite(fd, &fresh, sizeof(fresh), 0) != sizeof(fresh)) {
+            Logger::log(__FILENAME__, __FUNCTION__, "Error: Unable to initialize profile store " + path);
+            ::close(fd);
+            return false;
+        }
+    }
+
+    // Validate the header before mapping the whole table.
+    ProfileStoreHeader stored;
+    struct stat file_info;
+    if (pread(fd, &stored, sizeof(stored), 0) != sizeof(stored) || memcmp(stored.magic, PROFILE_MAGIC, sizeof(PROFILE_MAGIC)) != 0 ||
+        stored.version != FORMAT_VERSION || fstat(fd, &file_info) < 0 ||
+        static_cast<uint64_t>(file_info.st_size) < sizeof(ProfileStoreHeader) + stored.capacity * sizeof(PlayerProfile)) {
+        Logger::log(__FILENAME__, __FUNCTION__, "Error: Profile store " + path + " is damaged or has an unsupported version");
+        ::close(fd);
+        return false;
+    }
+
+    size_t length = sizeof(ProfileStoreHeader) + stored.capacity * sizeof(PlayerProfile);
+    void *mapping = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (mapping == MAP_FAILED) {
+        Logger::log(__FILENAME__, __FUNCTION__, "Error: Unable to map profile store " + path);
+        return false;
+    }
+
+    // Swap in the new mapping; the flusher never sees a half-replaced table.
+    std::lock_guard<std::mutex> mapping_lock(mapping_mutex);
+    if (header) {
+        munmap(header, mapping_length);
+    }
+    header = static_cast<ProfileStoreHeader *>(mapping);
+    slots = reinterpret_cast<PlayerProfile *>(header + 1);
+    mapping_length = length;
+    return true;
+}
+
+uint64_t ProfileStore::hash_name(const std::string &name) {
+    // FNV-1a over the player name.
+    uint64_t hash = 1469598103934665603ULL;
+    for (size_t i = 0; i < name.size(); ++i) {
+        hash ^= static_cast<unsigned char>(name[i]);
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+PlayerProfile *ProfileStore::locate(const std::string &name, bool insert) {
+    if (!header || name.empty() || name.size() >= sizeof(slots[0].name)) {
+        return nullptr;
+    }
+
+    PlayerProfile *slot = probe(name);
+    if (slot->used || !insert) {
+        return slot->used ? slot : nullptr;
+    }
+
+    // Only a new name counts against the load factor, kept under 70 % so probe sequences stay short.
+    // Growing rehashes the table, so the empty slot is looked up again.
+    if ((header->count + 1) * 10 > header->capacity * 7) {
+        if (!grow()) {
+            return nullptr;
+        }
+        slot = probe(name);
+    }
+
+    // Claim the empty slot for a new profile.
+    memset(slot, 0, sizeof(PlayerProfile));
+    memcpy(slot->name, name.data(), name.size());
+    slot->rating = INITIAL_RATING;
+    slot->used = 1;
+    header->count++;
+    return slot;
+}
+
+PlayerProfile *ProfileStore::probe(const std::string &name) {
+    // Linear probing from the home slot until the name or an empty slot is found.
+    uint64_t mask = header->capacity - 1;
+    for (uint64_t position = hash_name(name) & mask;; position = (position + 1) & mask) {
+        PlayerProfile *slot = &slots[position];
+        if (!slot->used || strncmp(slot->name, name.c_str(), sizeof(slot->name)) == 0) {
+            return slot;
+        }
+    }
+}
+
+bool ProfileStore::grow() {
+    // Build a table twice the size next to the current one.
+    std::string grown_path = store_path + ".grow";
+    unlink(grown_path.c_str());
+
+    ProfileStoreHeader *old_header = header;
+    PlayerProfile *old_slots = slots;
+    size_t old_length = mapping_length;
+    uint64_t old_capacity = header->capacity;
+
+    // Detach the old mapping so map_store keeps it alive while entries are rehashed.
+    {
+        std::lock_guard<std::mutex> mapping_lock(mapping_mutex);
+        header = nullptr;
+    }
+    if (!map_store(grown_path, old_capacity * 2, true)) {
+        std::lock_guard<std::mutex> mapping_lock(mapping_mutex);
+        header = old_header;
+        return false;
+    }
+
+    // Reinsert every used slot into the new table.
+    uint64_t mask = header->capacity - 1;
+    for (uint64_t i = 0; i < old_capacity; ++i) {
+        if (!old_slots[i].used) {
+            continue;
+        }
+        uint64_t position = hash_name(std::string(old_slots[i].name, strnlen(old_slots[i].name, sizeof(old_slots[i].name)))) & mask;
+        while (slots[position].used) {
+            position = (position + 1) & mask;
+        }
+        slots[position] = old_slots[i];
+        header->count++;
+    }
+
+    // Persist the new table, then atomically replace the old file.
+    msync(header, mapping_length, MS_SYNC);
+    rename(grown_path.c_str(), store_path.c_str());
+    munmap(old_header, old_length);
+
+    Logger::log(__FILENAME__, __FUNCTION__, "Profile store grown to capacity " + std::to_string(header->capacity));
+    return true;
+}
+
+bool ProfileStore::find_profile(const std::string &name, PlayerProfile &profile) {
+    std::lock_guard<std::mutex> lock(update_mutex);
+
+    // Copy the slot straight out of the mapping.
+    PlayerProfile *slot = locate(name, false);
+    if (!slot) {
+        return false;
+    }
+    profile = *slot;
+    return true;
+}
+
+bool ProfileStore::touch_profile(const std::string &name) {
+    std::lock_guard<std::mutex> lock(update_mutex);
+
+    // Create the profile on first login and remember when the player was last seen; report a new profile.
+    bool created = !locate(name, false);
+    PlayerProfile *slot = locate(name, true);
+    if (!slot) {
+        return false;
+    }
+    slot->last_seen = static_cast<int64_t>(time(nullptr));
+    return created;
+}
+
+void ProfileStore::record_result(const std::string &first_name, const std::string &second_name, bool tie) {
+    std::lock_guard<std::mutex> lock(update_mutex);
+
+    // Insert both players first; a table growth would move an already located slot.
+    if (!locate(first_name, true) || !locate(second_name, true)) {
+        return;
+    }
+    PlayerProfile *first = locate(first_name, false);
+    PlayerProfile *second = locate(second_name, false);
+
+    // Update the counters in place; the first player is the winner unless it was a tie.
+    if (tie) {
+        first->ties++;
+        second->ties++;
+    } else {
+        first->wins++;
+        second->losses++;
+    }
+
+    // Adjust both ratings with the Elo formula.
+    double expected = 1.0 / (1.0 + pow(10.0, (second->rating - first->rating) / 400.0));
+    double score = tie ? 0.5 : 1.0;
+    int change = static_cast<int>(lround(RATING_FACTOR * (score - expected)));
+    first->rating += change;
+    second->rating -= change;
+
+    int64_t now = static_cast<int64_t>(time(nullptr));
+    first->last_seen = now;
+    second->last_seen = now;
+}
+
+uint64_t ProfileStore::get_count() {
+    std::lock_guard<std::mutex> lock(update_mutex);
+    return header ? header->count : 0;
+}
+
+void ProfileStore::for_each_profile(const std::function<void(const PlayerProfile &)> &visit) {
+    std::lock_guard<std::mutex> lock(update_mutex);
+
+    // Walk the table in place and hand every stored profile to the visitor.
+    for (uint64_t i = 0; header && i < header->capacity; ++i) {
+        if (slots[i].used) {
+            visit(slots[i]);
+        }
+    }
+}
+
+void ProfileStore::flush() {
+    // Only the mapping lock is held, so game threads keep updating profiles meanwhile.
+    std::lock_guard<std::mutex> mapping_lock(mapping_mutex);
+    if (header) {
+        msync(header, mapping_length, MS_SYNC);
+    }
+}
+
+void ProfileStore::start_flusher(int interval_seconds) {
+    // Write dirty pages back periodically on a background thread, away from the game loop.
+    std::thread([interval_seconds]() {
+        while (true) {
+            std::this_thread::sleep_for(std::chrono::seconds(interval_seconds));
+            ProfileStore::flush();
+        }
+    }).detach();
+}
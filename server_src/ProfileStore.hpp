@@ -0,0 +1,72 @@
+#ifndef ProfileStore_hpp
+#define ProfileStore_hpp
+
+#include <stdint.h>
+#include <stddef.h>
+#include <functional>
+#include <mutex>
+#include <string>
+
+#include "Logger.hpp"
+
+// One slot of the open-addressing table. Slots live directly in the mapped file,
+// so a lookup returns the stored profile without any deserialization.
+struct PlayerProfile
+{
+    char name[16];
+    uint32_t wins;
+    uint32_t losses;
+    uint32_t ties;
+    int32_t rating;
+    int64_t last_seen;
+    uint32_t used;
+    uint8_t reserved[20];
+};
+
+struct ProfileStoreHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t reserved_ext;
+    uint64_t capacity;
+    uint64_t count;
+    uint8_t reserved[32];
+};
+
+class ProfileStore
+{
+public:
+    static const uint32_t FORMAT_VERSION = 1;
+    static const int INITIAL_RATING = 1200;
+    static const int RATING_FACTOR = 32;
+
+    static bool open(const std::string &path, uint64_t initial_capacity = 4096);
+    static void close();
+    static bool is_open() { return header != nullptr; };
+
+    static bool find_profile(const std::string &name, PlayerProfile &profile);
+    static bool touch_profile(const std::string &name);
+    static void record_result(const std::string &first_name, const std::string &second_name, bool tie);
+
+    static uint64_t get_count();
+    static void for_each_profile(const std::function<void(const PlayerProfile &)> &visit);
+
+    static void start_flusher(int interval_seconds);
+    static void flush();
+
+private:
+    static std::string store_path;
+    static ProfileStoreHeader *header;
+    static PlayerProfile *slots;
+    static size_t mapping_length;
+    static std::mutex update_mutex;
+    static std::mutex mapping_mutex;
+
+    static bool map_store(const std::string &path, uint64_t capacity, bool create);
+    static PlayerProfile *locate(const std::string &name, bool insert);
+    static PlayerProfile *probe(const std::string &name);
+    static bool grow();
+    static uint64_t hash_name(const std::string &name);
+};
+
+#endif /* ProfileStore_hpp */
@@ -0,0 +1,156 @@
+#include "RateLimiter.hpp"
+#include <algorithm>
+
+double RateLimiter::FRAME_RATE = 10.0;
+double RateLimiter::FRAME_BURST = 20.0;
+double RateLimiter::ADDRESS_FRAME_RATE = 50.0;
+double RateLimiter::ADDRESS_FRAME_BURST = 100.0;
+double RateLimiter::ACCEPT_RATE = 100.0;
+double RateLimiter::ACCEPT_BURST = 200.0;
+double RateLimiter::ADDRESS_ACCEPT_RATE = 5.0;
+double RateLimiter::ADDRESS_ACCEPT_BURST = 20.0;
+int RateLimiter::MAX_DROPPED_FRAMES = 50;
+const char *RateLimiter::LOCAL_ADDRESS = "local";
+
+std::vector<RateLimiter::Connection> RateLimiter::connections;
+std::unordered_map<std::string, RateLimiter::Address> RateLimiter::addresses;
+TokenBucket RateLimiter::accept_bucket = {RateLimiter::ACCEPT_BURST, Clock::now()};
+uint64_t RateLimiter::dropped_frames = 0;
+uint64_t RateLimiter::dropped_bytes = 0;
+uint64_t RateLimiter::rejected_connections = 0;
+
+bool TokenBucket::take(double rate, double burst, double cost, std::chrono::steady_clock::time_point now) {
+    // Refill for the time since the last update, then pay if the bucket holds enough.
+    std::chrono::duration<double> elapsed = now - updated;
+    tokens = std::min(burst, tokens + elapsed.count() * rate);
+    updated = now;
+    if (tokens < cost) {
+        return false;
+    }
+    tokens -= cost;
+    return true;
+}
+
+RateLimiter::Address &RateLimiter::find_address(const std::string &ip_address, std::chrono::steady_clock::time_point now) {
+    // New addresses start with full buckets.
+    auto it = addresses.find(ip_address);
+    if (it == addresses.end()) {
+        Address fresh = {{ADDRESS_FRAME_BURST, now}, {ADDRESS_ACCEPT_BURST, now}, 0};
+        it = addresses.emplace(ip_address, fresh).first;
+    }
+    return it->second;
+}
+
+bool RateLimiter::admit_connection(const std::string &ip_address) {
+    auto now = Clock::now();
+
+    // Both the global and the per-address accept budget must allow the connection.
+    bool address_limited = ip_address != LOCAL_ADDRESS;
+    if (!accept_bucket.take(ACCEPT_RATE, ACCEPT_BURST, 1.0, now) ||
+        (address_limited && !find_address(ip_address, now).accepts.take(ADDRESS_ACCEPT_RATE, ADDRESS_ACCEPT_BURST, 1.0, now))) {
+        // Counted only; the sweeper reports the totals instead of logging every rejection.
+        rejected_connections++;
+        return false;
+    }
+    return true;
+}
+
+void RateLimiter::register_connection(int socket, const std::string &ip_address) {
+    if (socket < 0) {
+        return;
+    }
+    if (socket >= static_cast<int>(connections.size())) {
+        connections.resize(socket + 1);
+    }
+
+    // Every connection starts with a full bucket of its own.
+    auto now = Clock::now();
+    bool address_limited = ip_address != LOCAL_ADDRESS;
+    if (address_limited) {
+        find_address(ip_address, now).connections++;
+    }
+    connections[socket] = {true, ip_address, address_limited, {FRAME_BURST, now}, 0};
+}
+
+void RateLimiter::release_connection(int socket) {
+    if (socket < 0 || socket >= static_cast<int>(connections.size()) || !connections[socket].active) {
+        return;
+    }
+
+    // The address entry stays until the sweeper finds it idle.
+    auto it = addresses.find(connections[socket].ip_address);
+    if (it != addresses.end()) {
+        it->second.connections--;
+    }
+    connections[socket].active = false;
+}
+
+RateLimiter::Verdict RateLimiter::admit_frame(int socket, std::string_view data) {
+    if (socket < 0 || socket >= static_cast<int>(connections.size()) || !connections[socket].active) {
+        return ADMIT;
+    }
+
+    // Each '|'-terminated message in the read costs one token; nothing is parsed yet. A read never
+    // costs more than a full bucket, so one that coalesces many messages still passes after a wait.
+    double frames = std::max<double>(1.0, static_cast<double>(std::count(data.begin(), data.end(), '|')));
+    double cost = std::min(frames, FRAME_BURST);
+    auto now = Clock::now();
+    Connection &connection = connections[socket];
+    bool own_limit = !connection.frames.take(FRAME_RATE, FRAME_BURST, cost, now);
+    if (!own_limit && (!connection.address_limited || find_address(connection.ip_address, now).frames.take(ADDRESS_FRAME_RATE, ADDRESS_FRAME_BURST, std::min(frames, ADDRESS_FRAME_BURST), now))) {
+        // Drops are forgiven only once the client has let its bucket fill up again.
+        if (connection.frames.tokens + cost >= FRAME_BURST) {
+            connection.dropped = 0;
+        }
+        return ADMIT;
+    }
+
+    // Over the limit: drop the read. A read the address refused is refunded to the connection, and
+    // only clients that keep overrunning their own bucket are given up on.
+    dropped_frames++;
+    dropped_bytes += data.size();
+    if (!own_limit) {
+        connection.frames.tokens += cost;
+        return DROP;
+    }
+    connection.dropped++;
+    if (connection.dropped >= MAX_DROPPED_FRAMES) {
+        Logger::log(__FILENAME__, __FUNCTION__, "Disconnecting flooding client: Socket=" + std::to_string(socket) + ", IP=" + connection.ip_address);
+        return DISCONNECT;
+    }
+    return DROP;
+}
+
+void RateLimiter::start_sweeper(int interval_seconds) {
+    SessionAdmin::spawn(sweep(interval_seconds));
+}
+
+SessionTask RateLimiter::sweep(int interval_seconds) {
+    uint64_t reported_frames = 0;
+    uint64_t reported_connections = 0;
+
+    while (true) {
+        co_await SessionAdmin::sleep_for(interval_seconds);
+
+        // Forget addresses without connections once both their buckets have refilled.
+        auto now = Clock::now();
+        for (auto it = addresses.begin(); it != addresses.end();) {
+            Address &address = it->second;
+            address.frames.take(ADDRESS_FRAME_RATE, ADDRESS_FRAME_BURST, 0.0, now);
+            address.accepts.take(ADDRESS_ACCEPT_RATE, ADDRESS_ACCEPT_BURST, 0.0, now);
+            if (address.connections <= 0 && address.frames.tokens >= ADDRESS_FRAME_BURST && address.accepts.tokens >= ADDRESS_ACCEPT_BURST) {
+                it = addresses.erase(it);
+            } else {
+                ++it;
+            }
+        }
+
+        // Report the drop counters whenever they moved.
+        if (dropped_frames != reported_frames || rejected_connections != reported_connections) {
+            Logger::log(__FILENAME__, __FUNCTION__, "Rate limiting: Dropped frames=" + std::to_string(dropped_frames) + ", Dropped bytes=" + std::to_string(dropped_bytes) +
+                                                    ", Rejected connections=" + std::to_string(rejected_connections) + ", Tracked addresses=" + std::to_string(addresses.size()));
+            reported_frames = dropped_frames;
+            reported_connections = rejected_connections;
+        }
+    }
+}
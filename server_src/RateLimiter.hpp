@@ -0,0 +1,85 @@
+#ifndef RateLimiter_hpp
+#define RateLimiter_hpp
+
+#include <stdint.h>
+#include <chrono>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "Session.hpp"
+#include "Logger.hpp"
+
+// Classic token bucket: refills at a fixed rate up to its burst size.
+struct TokenBucket
+{
+    double tokens;
+    std::chrono::steady_clock::time_point updated;
+
+    bool take(double rate, double burst, double cost, std::chrono::steady_clock::time_point now);
+};
+
+// Throttles traffic before it reaches the parser. Every connection and every remote address
+// has a frame bucket, accepts are limited globally and per address, and drops are counted.
+// Clients on the local socket all share LOCAL_ADDRESS, so only their own buckets apply to them.
+class RateLimiter
+{
+public:
+    enum Verdict
+    {
+        ADMIT,
+        DROP,
+        DISCONNECT
+    };
+
+    static double FRAME_RATE;
+    static double FRAME_BURST;
+    static double ADDRESS_FRAME_RATE;
+    static double ADDRESS_FRAME_BURST;
+    static double ACCEPT_RATE;
+    static double ACCEPT_BURST;
+    static double ADDRESS_ACCEPT_RATE;
+    static double ADDRESS_ACCEPT_BURST;
+    static int MAX_DROPPED_FRAMES;
+    static const char *LOCAL_ADDRESS;
+
+    static bool admit_connection(const std::string &ip_address);
+    static void register_connection(int socket, const std::string &ip_address);
+    static void release_connection(int socket);
+    static Verdict admit_frame(int socket, std::string_view data);
+    static void start_sweeper(int interval_seconds);
+
+    static uint64_t get_dropped_frames() { return dropped_frames; };
+    static uint64_t get_dropped_bytes() { return dropped_bytes; };
+    static uint64_t get_rejected_connections() { return rejected_connections; };
+
+private:
+    struct Connection
+    {
+        bool active;
+        std::string ip_address;
+        bool address_limited;
+        TokenBucket frames;
+        int dropped;
+    };
+
+    struct Address
+    {
+        TokenBucket frames;
+        TokenBucket accepts;
+        int connections;
+    };
+
+    static std::vector<Connection> connections;
+    static std::unordered_map<std::string, Address> addresses;
+    static TokenBucket accept_bucket;
+    static uint64_t dropped_frames;
+    static uint64_t dropped_bytes;
+    static uint64_t rejected_connections;
+
+    static Address &find_address(const std::string &ip_address, std::chrono::steady_clock::time_point now);
+    static SessionTask sweep(int interval_seconds);
+};
+
+#endif /* RateLimiter_hpp */
@@ -0,0 +1,102 @@
+#include "Reaper.hpp"
+#include "GameAdmin.hpp"
+
+int Reaper::TICK_SECONDS = 1;
+int Reaper::CHECK_DELAY = 30;
+int Reaper::BUDGET = 64;
+int Reaper::MAX_STRIKES = 3;
+int Reaper::REPORT_INTERVAL = 60;
+
+std::vector<Reaper::Entry> Reaper::wheel[Reaper::SLOT_COUNT];
+unsigned Reaper::current_slot = 0;
+uint64_t Reaper::ticks = 0;
+std::set<Player *> Reaper::retiring;
+
+void Reaper::start() {
+    SessionAdmin::spawn(run());
+    Logger::log(__FILENAME__, __FUNCTION__, "Reaper started: Slots=" + std::to_string(SLOT_COUNT) + ", Budget=" + std::to_string(BUDGET) + " per tick");
+}
+
+SessionTask Reaper::run() {
+    while (true) {
+        co_await SessionAdmin::sleep_for(TICK_SECONDS);
+        tick();
+    }
+}
+
+void Reaper::schedule(const Entry &entry, int delay) {
+    // Delays beyond one turn of the wheel are clamped; inspections simply come a little early.
+    delay = std::max(1, std::min(delay, SLOT_COUNT - 1));
+    wheel[(current_slot + delay) % SLOT_COUNT].push_back(entry);
+}
+
+void Reaper::watch_game(int game_id) {
+    schedule(Entry{GAME, game_id, nullptr, 0}, CHECK_DELAY);
+}
+
+void Reaper::watch_connection(int socket) {
+    schedule(Entry{CONNECTION, socket, nullptr, 0}, CHECK_DELAY);
+}
+
+void Reaper::retire_player(Player *player) {
+    // A player is handed over once; it is deleted when nothing refers to it any more.
+    if (!player || !retiring.insert(player).second) {
+        return;
+    }
+    schedule(Entry{RETIRED_PLAYER, 0, player, 0}, 1);
+}
+
+void Reaper::tick() {
+    current_slot = (current_slot + 1) % SLOT_COUNT;
+    ticks++;
+
+    // Inspect up to the budget; whatever is left waits for the next tick.
+    std::vector<Entry> due;
+    due.swap(wheel[current_slot]);
+    size_t limit = std::min(due.size(), static_cast<size_t>(BUDGET));
+    for (size_t i = 0; i < limit; ++i) {
+        if (inspect(due[i])) {
+            schedule(due[i], due[i].kind == RETIRED_PLAYER ? 1 : CHECK_DELAY);
+        }
+    }
+    std::vector<Entry> &next = wheel[(current_slot + 1) % SLOT_COUNT];
+    next.insert(next.end(), due.begin() + limit, due.end());
+
+    if (ticks % REPORT_INTERVAL == 0) {
+        report_live_objects();
+    }
+}
+
+bool Reaper::inspect(Entry &entry) {
+    // Returns whether the entry has to be looked at again later.
+    switch (entry.kind) {
+        case GAME:
+            return GameAdmin::reap_game(entry.id, entry.strikes);
+        case CONNECTION:
+            return GameAdmin::reap_connection(entry.id);
+        case RETIRED_PLAYER: {
+            // Wait for the heartbeat to end and for any game still pointing at the player.
+            Player *player = entry.player;
+            Game *game = player->get_game_id() > 0 ? GameAdmin::get_active_game(player->get_game_id()) : nullptr;
+            if (player->heartbeat_running || (game && (game->get_first_player() == player || game->get_second_player() == player))) {
+                return true;
+            }
+            retiring.erase(player);
+            delete player;
+            return false;
+        }
+    }
+    return false;
+}
+
+void Reaper::report_live_objects() {
+    size_t pending = 0;
+    for (int i = 0; i < SLOT_COUNT; ++i) {
+        pending += wheel[i].size();
+    }
+
+    Logger::log(__FILENAME__, __FUNCTION__, "Live objects: Players=" + std::to_string(Player::get_live_count()) + " (Registered=" + std::to_string(GameAdmin::logged_players.size()) +
+                                            ", Unregistered=" + std::to_string(GameAdmin::unlogged_players.size()) + ", Retiring=" + std::to_string(retiring.size()) +
+                                            "), Games=" + std::to_string(Game::get_live_count()) + ", Sessions=" + std::to_string(SessionAdmin::get_session_count()) +
+                                            ", Frames=" + std::to_string(FramePool::get_live_frames()) + ", Watched=" + std::to_string(pending));
+}
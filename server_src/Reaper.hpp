@@ -0,0 +1,59 @@
+#ifndef Reaper_hpp
+#define Reaper_hpp
+
+#include <stdint.h>
+#include <set>
+#include <vector>
+
+#include "Player.hpp"
+#include "Session.hpp"
+#include "Logger.hpp"
+
+// Reclaims games and players nobody will ever close. Watched objects sit in a hashed timer
+// wheel; every tick inspects at most BUDGET entries of the current slot and pushes the rest
+// to the next one, so a large backlog never stalls the event loop.
+class Reaper
+{
+public:
+    static const int SLOT_COUNT = 64;
+
+    static int TICK_SECONDS;
+    static int CHECK_DELAY;
+    static int BUDGET;
+    static int MAX_STRIKES;
+    static int REPORT_INTERVAL;
+
+    static void start();
+    static void watch_game(int game_id);
+    static void watch_connection(int socket);
+    static void retire_player(Player *player);
+    static void report_live_objects();
+
+private:
+    enum Kind
+    {
+        GAME,
+        CONNECTION,
+        RETIRED_PLAYER
+    };
+
+    struct Entry
+    {
+        Kind kind;
+        int id;
+        Player *player;
+        int strikes;
+    };
+
+    static std::vector<Entry> wheel[SLOT_COUNT];
+    static unsigned current_slot;
+    static uint64_t ticks;
+    static std::set<Player *> retiring;
+
+    static void schedule(const Entry &entry, int delay);
+    static void tick();
+    static bool inspect(Entry &entry);
+    static SessionTask run();
+};
+
+#endif /* Reaper_hpp */
@@ -0,0 +1,307 @@
+#include "ReplayArchive.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+#include <mutex>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static const char REPLAY_MAGIC[8] = {'U', 'P', 'S', 'R', 'P', 'L', 'Y', '\0'};
+static std::mutex archive_mutex;
+
+uint64_t ReplayArchive::SEGMENT_LIMIT = 64ULL * 1024 * 1024;
+
+std::string ReplayArchive::archive_directory;
+int ReplayArchive::segment_fd = -1;
+int ReplayArchive::index_fd = -1;
+ReplaySegmentHeader ReplayArchive::current_header;
+std::vector<uint32_t> ReplayArchive::segment_numbers;
+std::vector<uint64_t> ReplayArchive::segment_first_sequences;
+
+// Maps a whole file read-only, returning nullptr for missing or empty files.
+static const char *map_file(const std::string &path, size_t &length) {
+    length = 0;
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return nullptr;
+    }
+
+    struct stat file_info;
+    if (fstat(fd, &file_info) < 0 || file_info.st_size == 0) {
+        ::close(fd);
+        return nullptr;
+    }
+
+    void *mapping = mmap(nullptr, file_info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd); // The mapping keeps its own reference to the file.
+    if (mapping == MAP_FAILED) {
+        return nullptr;
+    }
+
+    length = static_cast<size_t>(file_info.st_size);
+    return static_cast<const char *>(mapping);
+}
+
+ReplaySegment::ReplaySegment()
+    : data(nullptr), data_length(0), offsets(nullptr), offsets_length(0), record_count(0) {
+}
+
+ReplaySegment::~ReplaySegment() {
+    close();
+}
+
+bool ReplaySegment::open(const std::string &segment_path, const std::string &index_path) {
+    close();
+
+    // Map the segment and check that it really is a replay segment.
+    data = map_file(segment_path, data_length);
+    if (!data || data_length < sizeof(ReplaySegmentHeader) || memcmp(get_header()->magic, REPLAY_MAGIC, sizeof(REPLAY_MAGIC)) != 0) {
+        close();
+        return false;
+    }
+
+    // Map the index; only records covered by both the header and the index are visible.
+    const char *index_data = map_file(index_path, offsets_length);
+    offsets = reinterpret_cast<const uint64_t *>(index_data);
+    record_count = std::min<uint64_t>(get_header()->record_count, offsets_length / sizeof(uint64_t));
+    return true;
+}
+
+void ReplaySegment::close() {
+    // Release both mappings.
+    if (data) {
+        munmap(const_cast<char *>(data), data_length);
+    }
+    if (offsets) {
+        munmap(const_cast<uint64_t *>(offsets), offsets_length);
+    }
+    data = nullptr;
+    offsets = nullptr;
+    data_length = 0;
+    offsets_length = 0;
+    record_count = 0;
+}
+
+void ReplaySegment::advise_sequential() const {
+    // Let the kernel read ahead aggressively when the whole segment is scanned.
+    if (data) {
+        madvise(const_cast<char *>(data), data_length, MADV_SEQUENTIAL);
+    }
+}
+
+const ReplayRecord *ReplaySegment::record(uint64_t position) const {
+    // Resolve the record through the index and make sure it lies inside the mapping.
+    if (position >= record_count) {
+        return nullptr;
+    }
+
+    uint64_t offset = offsets[position];
+    if (offset + sizeof(ReplayRecord) > data_length) {
+        return nullptr;
+    }
+
+    const ReplayRecord *found = reinterpret_cast<const ReplayRecord *>(data + offset);
+    if (offset + found->record_size > data_length) {
+        return nullptr;
+    }
+    return found;
+}
+
+std::string ReplayArchive::segment_path(const std::string &directory, uint32_t segment_number) {
+    char name[32];
+    snprintf(name, sizeof(name), "/replay-%06u.seg", segment_number);
+    return directory + name;
+}
+
+std::string ReplayArchive::index_path(const std::string &directory, uint32_t segment_number) {
+    char name[32];
+    snprintf(name, sizeof(name), "/replay-%06u.idx", segment_number);
+    return directory + name;
+}
+
+std::vector<uint32_t> ReplayArchive::list_segments(const std::string &directory) {
+    // Collect the numbers of all segment files of the archive in ascending order; pruning may leave gaps.
+    std::vector<uint32_t> segments;
+    DIR *dir = opendir(directory.c_str());
+    if (!dir) {
+        return segments;
+    }
+
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != nullptr) {
+        unsigned int segment_number;
+        char suffix[4] = {0};
+        if (sscanf(entry->d_name, "replay-%6u.%3s", &segment_number, suffix) == 2 && strcmp(suffix, "seg") == 0) {
+            segments.push_back(segment_number);
+        }
+    }
+    closedir(dir);
+
+    std::sort(segments.begin(), segments.end());
+    return segments;
+}
+
+bool ReplayArchive::open(const std::string &directory) {
+    std::lock_guard<std::mutex> lock(archive_mutex);
+
+    // Create the archive directory if it does not exist yet.
+    if (mkdir(directory.c_str(), 0755) < 0 && errno != EEXIST) {
+        Logger::log(__FILENAME__, __FUNCTION__, "Error: Unable to create replay directory " + directory);
+        return false;
+    }
+    archive_directory = directory;
+    segment_numbers.clear();
+    segment_first_sequences.clear();
+
+    // Read the first sequence of every existing segment so lookups can find the right file.
+    std::vector<uint32_t> segments = list_segments(directory);
+    for (uint32_t number : segments) {
+        ReplaySegmentHeader header;
+        int fd = ::open(segment_path(directory, number).c_str(), O_RDONLY);
+        if (fd < 0 || pread(fd, &header, sizeof(header), 0) != sizeof(header) || memcmp(header.magic, REPLAY_MAGIC, sizeof(REPLAY_MAGIC)) != 0) {
+            if (fd >= 0) {
+                ::close(fd);
+            }
+            Logger::log(__FILENAME__, __FUNCTION__, "Error: Replay segment " + std::to_string(number) + " is missing or damaged");
+            return false;
+        }
+        ::close(fd);
+        segment_numbers.push_back(number);
+        segment_first_sequences.push_back(header.first_sequence);
+    }
+
+    // Continue appending to the last segment, or start the archive with the first one.
+    bool opened = segments.empty() ? open_segment(0, 1) : open_segment(segments.back(), segment_first_sequences.back());
+    if (opened) {
+        Logger::log(__FILENAME__, __FUNCTION__, "Replay archive opened: " + directory + ", Segments=" + std::to_string(segment_first_sequences.size()) + ", Next sequence=" + std::to_string(current_header.first_sequence + current_header.record_count));
+    }
+    return opened;
+}
+
+void ReplayArchive::close() {
+    std::lock_guard<std::mutex> lock(archive_mutex);
+    close_segment();
+}
+
+bool ReplayArchive::open_segment(uint32_t segment_number, uint64_t first_sequence) {
+    // Open (or create) the segment file and its index.
+    segment_fd = ::open(segment_path(archive_directory, segment_number).c_str(), O_RDWR | O_CREAT, 0644);
+    index_fd = ::open(index_path(archive_directory, segment_number).c_str(), O_RDWR | O_CREAT, 0644);
+    if (segment_fd < 0 || index_fd < 0) {
+        Logger::log(__FILENAME__, __FUNCTION__, "Error: Unable to open replay segment " + std::to_string(segment_number));
+        close_segment();
+        return false;
+    }
+
+    if (pread(segment_fd, &current_header, sizeof(current_header), 0) != sizeof(current_header)) {
+        // A fresh segment starts with an empty header.
+        memset(&current_header, 0, sizeof(current_header));
+        memcpy(current_header.magic, REPLAY_MAGIC, sizeof(REPLAY_MAGIC));
+        current_header.version = FORMAT_VERSION;
+        current_header.segment_number = segment_number;
+        current_header.first_sequence = first_sequence;
+        current_header.data_end = sizeof(ReplaySegmentHeader);
+
+        if (pwrite(segment_fd, &current_header, sizeof(current_header), 0) != sizeof(current_header)) {
+            Logger::log(__FILENAME__, __FUNCTION__, "Error: Unable to write replay segment header");
+            close_segment();
+            return false;
+        }
+        if (segment_numbers.empty() || segment_numbers.back() < segment_number) {
+            segment_numbers.push_back(segment_number);
+            segment_first_sequences.push_back(first_sequence);
+        }
+    } else if (memcmp(current_header.magic, REPLAY_MAGIC, sizeof(REPLAY_MAGIC)) != 0 || current_header.version != FORMAT_VERSION) {
+        Logger::log(__FILENAME__, __FUNCTION__, "Error: Unsupported replay segment " + std::to_string(segment_number));
+        close_segment();
+        return false;
+    }
+    return true;
+}
+
+void ReplayArchive::close_segment() {
+    // Close the files of the segment that is currently appended to.
+    if (segment_fd >= 0) {
+        ::close(segment_fd);
+    }
+    if (index_fd >= 0) {
+        ::close(index_fd);
+    }
+    segment_fd = -1;
+    index_fd = -1;
+}
+
+void ReplayArchive::append_game(const Game *game, int result) {
+    std::lock_guard<std::mutex> lock(archive_mutex);
+    if (segment_fd < 0) {
+        return;
+    }
+
+    // Build the record followed by its packed move list, padded to 8 bytes.
+    const std::vector<unsigned char> &moves = game->get_move_log();
+    size_t record_size = (sizeof(ReplayRecord) + moves.size() + 7) & ~static_cast<size_t>(7);
+    std::vector<char> buffer(record_size, 0);
+
+    ReplayRecord *record = reinterpret_cast<ReplayRecord *>(buffer.data());
+    record->record_size = static_cast<uint32_t>(record_size);
+    record->game_id = static_cast<uint32_t>(game->get_game_id());
+    record->finished_at = static_cast<int64_t>(time(nullptr));
+    record->board_size = Game::BOARD_SIZE;
+    record->result = static_cast<uint8_t>(result);
+    record->first_turn = static_cast<uint8_t>(game->get_first_turn());
+    record->move_count = static_cast<uint16_t>(moves.size());
+    strncpy(record->player_one, game->get_first_player()->get_name().c_str(), sizeof(record->player_one) - 1);
+    strncpy(record->player_two, game->get_second_player()->get_name().c_str(), sizeof(record->player_two) - 1);
+    std::copy(moves.begin(), moves.end(), buffer.begin() + sizeof(ReplayRecord));
+
+    // Roll over to a new segment once the current one would grow past the limit.
+    if (current_header.record_count > 0 && current_header.data_end + record_size > SEGMENT_LIMIT) {
+        uint32_t next_segment = current_header.segment_number + 1;
+        uint64_t next_sequence = current_header.first_sequence + current_header.record_count;
+        close_segment();
+        if (!open_segment(next_segment, next_sequence)) {
+            return;
+        }
+        Logger::log(__FILENAME__, __FUNCTION__, "Replay archive rolled over to segment " + std::to_string(next_segment));
+    }
+    record->sequence = current_header.first_sequence + current_header.record_count;
+
+    // Write the record and its index entry first, then publish them through the header.
+    uint64_t offset = current_header.data_end;
+    if (pwrite(segment_fd, buffer.data(), record_size, offset) != static_cast<ssize_t>(record_size) ||
+        pwrite(index_fd, &offset, sizeof(offset), current_header.record_count * sizeof(uint64_t)) != sizeof(offset)) {
+        Logger::log(__FILENAME__, __FUNCTION__, "Error: Unable to append game " + std::to_string(game->get_game_id()) + " to the replay archive");
+        return;
+    }
+
+    current_header.record_count++;
+    current_header.data_end += record_size;
+    pwrite(segment_fd, &current_header, sizeof(current_header), 0);
+
+    Logger::log(__FILENAME__, __FUNCTION__, "Game " + std::to_string(game->get_game_id()) + " archived as replay " + std::to_string(record->sequence));
+}
+
+bool ReplayArchive::find_record(uint64_t sequence, ReplaySegment &segment, const ReplayRecord *&record) {
+    uint32_t segment_number;
+    {
+        std::lock_guard<std::mutex> lock(archive_mutex);
+
+        // Find the last segment whose first sequence is not greater than the requested one.
+        std::vector<uint64_t>::const_iterator it = std::upper_bound(segment_first_sequences.begin(), segment_first_sequences.end(), sequence);
+        if (it == segment_first_sequences.begin()) {
+            return false;
+        }
+        segment_number = segment_numbers[it - segment_first_sequences.begin() - 1];
+    }
+
+    // Map the segment and resolve the record through its index.
+    if (!segment.open(segment_path(archive_directory, segment_number), index_path(archive_directory, segment_number))) {
+        return false;
+    }
+    record = segment.record(sequence - segment.get_header()->first_sequence);
+    return record != nullptr;
+}
@@ -0,0 +1,103 @@
+#ifndef ReplayArchive_hpp
+#define ReplayArchive_hpp
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+#include <vector>
+
+#include "Game.hpp"
+#include "Logger.hpp"
+
+// Header stored at the beginning of every replay segment file.
+// The record count and data end are updated only after a record and its index entry are written,
+// so a reader never sees a partially written record.
+struct ReplaySegmentHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t segment_number;
+    uint64_t first_sequence;
+    uint64_t record_count;
+    uint64_t data_end;
+    uint8_t reserved[24];
+};
+
+// Fixed layout of one finished game. The packed move list (one byte per move, row * size + column)
+// follows the record directly and the whole record is padded to 8 bytes.
+struct ReplayRecord
+{
+    uint32_t record_size;
+    uint32_t game_id;
+    uint64_t sequence;
+    int64_t finished_at;
+    uint8_t board_size;
+    uint8_t result;
+    uint8_t first_turn;
+    uint8_t reserved;
+    uint16_t move_count;
+    uint16_t reserved_ext;
+    char player_one[16];
+    char player_two[16];
+
+    const uint8_t *moves() const { return reinterpret_cast<const uint8_t *>(this + 1); };
+};
+
+// Read-only memory-mapped view of one segment and its index file.
+class ReplaySegment
+{
+private:
+    const char *data;
+    size_t data_length;
+    const uint64_t *offsets;
+    size_t offsets_length;
+    uint64_t record_count;
+
+public:
+    ReplaySegment();
+    ~ReplaySegment();
+
+    bool open(const std::string &segment_path, const std::string &index_path);
+    void close();
+    void advise_sequential() const;
+
+    const ReplaySegmentHeader *get_header() const { return reinterpret_cast<const ReplaySegmentHeader *>(data); };
+    uint64_t size() const { return record_count; };
+    const ReplayRecord *record(uint64_t position) const;
+};
+
+class ReplayArchive
+{
+public:
+    static const int RESULT_PLAYER_ONE_WIN = 1;
+    static const int RESULT_PLAYER_TWO_WIN = 2;
+    static const int RESULT_TIE = 3;
+    static const int RESULT_ABANDONED = 4;
+
+    static const uint32_t FORMAT_VERSION = 1;
+    static uint64_t SEGMENT_LIMIT;
+
+    static bool open(const std::string &directory);
+    static void close();
+    static bool is_open() { return segment_fd >= 0; };
+
+    static void append_game(const Game *game, int result);
+    static bool find_record(uint64_t sequence, ReplaySegment &segment, const ReplayRecord *&record);
+
+    static std::vector<uint32_t> list_segments(const std::string &directory);
+    static std::string segment_path(const std::string &directory, uint32_t segment_number);
+    static std::string index_path(const std::string &directory, uint32_t segment_number);
+
+private:
+    static std::string archive_directory;
+    static int segment_fd;
+    static int index_fd;
+    static ReplaySegmentHeader current_header;
+    static std::vector<uint32_t> segment_numbers;
+    static std::vector<uint64_t> segment_first_sequences;
+
+    static bool open_segment(uint32_t segment_number, uint64_t first_sequence);
+    static void close_segment();
+};
+
+#endif /* ReplayArchive_hpp */
@@ -1,7 +1,7 @@
 
 #include "Responder.hpp"
-
-int MAX_MESSAGE_LENGTH = 30;
+#include "Trace.hpp"
+#include "Telemetry.hpp"
 
 // Sends a formatted message to the client associated with the given player.
 void Responder::deliver_message_to_client(Player* player, const std::string& message) {
@@ -13,7 +13,7 @@ void Responder::deliver_message_to_client(Player* player, const std::string& mes
 
     // Append a newline to the message and send it to the player's socket.
     std::string formatted_message = message + "\n";
-    send(player->get_socket(), formatted_message.data(), formatted_message.length(), 0);
+    Server::sendToClient(player->get_socket(), formatted_message);
 }
 
 // Sends confirmation to the player about their move.
@@ -40,13 +40,29 @@ void Responder::notify_opponent_move(Player* player, int row, int column) {
     deliver_message_to_client(player, opponent_move_message);
 }
 
+// Tells the player that the move at the given cell was taken back.
+void Responder::confirm_takeback(Player* player, int row, int column) {
+    // Log the takeback notification.
+    Logger::log(__FILENAME__, __FUNCTION__, "Notifying player: " + player->get_name() + " of the takeback.");
+
+    // Format the takeback message.
+    std::string takeback_message = "TAKEBACK;" + std::to_string(row) + ";" + std::to_string(column) + ";";
+
+    // Deliver the takeback message to the player.
+    deliver_message_to_client(player, takeback_message);
+}
+
 // Updates the player's status with a given message.
 void Responder::update_player_status(Player* player, const std::string& status_message) {
     // Log the status update.
     Logger::log(__FILENAME__, __FUNCTION__, "Updating status for player: " + player->get_name());
 
-    // Format the status update message.
+    // Format the status update message; players on a running clock also get both clocks.
     std::string status_update = "STATUS;" + status_message + ";";
+    Game* game = GameAdmin::get_active_game(player->get_game_id());
+    if (game && game->is_clock_running()) {
+        status_update += format_clocks(player, game);
+    }
 
     // Deliver the status update message to the player.
     deliver_message_to_client(player, status_update);
@@ -78,13 +94,20 @@ void Responder::send_to_socket(int socket_id, const std::string& message) {
 
     // Append a delimiter to the message and send it to the socket.
     std::string formatted_message = message + ";\n";
-    send(socket_id, formatted_message.data(), formatted_message.length(), 0);
+    Server::sendToClient(socket_id, formatted_message);
 
 
     // Log the attempt to send a message to the given socket ID.
     Logger::log(__FILENAME__, __FUNCTION__, "Sending message: " + formatted_message + " to socket ID: " + std::to_string(socket_id));
 }
 
+// Formats the player's and the opponent's remaining time in milliseconds.
+std::string Responder::format_clocks(Player* player, Game* game) {
+    auto now = Clock::now();
+    Player* opponent = game->get_opponent(player);
+    return std::to_string(game->get_time_left(player->get_game_marker(), now)) + ";" + std::to_string(game->get_time_left(opponent->get_game_marker(), now)) + ";";
+}
+
 // Sends the full game state to the given player for reconnection purposes.
 void Responder::send_full_game_to_player(Player* player, Game* game) {
     // Log the attempt to send the game state to the player.
@@ -94,21 +117,14 @@ void Responder::send_full_game_to_player(Player* player, Game* game) {
     Player* opponent = game->get_opponent(player);
     std::string game_state = "RECONNECT;" + opponent->get_name() + ";";
 
-    // Append the game board state to the message.
-    for (int i = 0; i < game->BOARD_SIZE; ++i) {
-        for (int j = 0; j < game->BOARD_SIZE; ++j) {
-            game_state += std::to_string(game->get_board_value(i, j));
-            if (j + 1 < game->BOARD_SIZE) {
-                game_state += ",";
-            }
-        }
-        if (i + 1 < game->BOARD_SIZE) {
-            game_state += ",";
-        }
-    }
+    // Append the cached board snapshot to the message.
+    game_state += game->get_board_snapshot();
 
-    // Append the player's game marker to the message.
+    // Append the player's game marker and, under a time control, both clocks to the message.
     game_state += ";" + std::to_string(player->get_game_marker()) + ";";
+    if (game->get_time_control().is_enabled()) {
+        game_state += format_clocks(player, game);
+    }
 
     // Log the final formatted game state for debugging purposes.
     Logger::log(__FILENAME__, __FUNCTION__, "Full game state: " + game_state);
@@ -117,15 +133,91 @@ void Responder::send_full_game_to_player(Player* player, Game* game) {
     deliver_message_to_client(player, game_state);
 }
 
+// Sends only the moves of the current round the player has not seen yet.
+void Responder::send_game_delta(Player* player, Game* game, int seen_moves) {
+    // Log the resync with the number of missing moves.
+    const std::vector<unsigned char>& moves = game->get_move_log();
+    Logger::log(__FILENAME__, __FUNCTION__, "Resyncing player: " + player->get_name() + ", Missing moves: " + std::to_string(moves.size() - seen_moves));
+
+    // Prepare the header with the opponent, the player's marker, the round opener and the first missing index.
+    Player* opponent = game->get_opponent(player);
+    std::string delta = "RESYNC;" + opponent->get_name() + ";" + std::to_string(player->get_game_marker()) + ";" + std::to_string(game->get_first_turn()) + ";" +
+                        std::to_string(seen_moves) + ";";
+
+    // Append the missing moves as row,column pairs, the player on turn and the clocks.
+    for (size_t i = seen_moves; i < moves.size(); ++i) {
+        delta += std::to_string(moves[i] / Game::BOARD_SIZE) + "," + std::to_string(moves[i] % Game::BOARD_SIZE);
+        if (i + 1 < moves.size()) {
+            delta += ",";
+        }
+    }
+    delta += ";" + std::to_string(game->active_turn) + ";";
+    if (game->get_time_control().is_enabled()) {
+        delta += format_clocks(player, game);
+    }
+
+    // Deliver the delta to the player.
+    deliver_message_to_client(player, delta);
+}
+
+// Sends an archived game to the player as a flat list of moves.
+void Responder::send_replay(Player* player, const ReplayRecord* record) {
+    // Log the replay delivery.
+    Logger::log(__FILENAME__, __FUNCTION__, "Sending replay " + std::to_string(record->sequence) + " to player: " + player->get_name());
+
+    // Prepare the header with players, result and the marker that moved first.
+    std::string replay = "REPLAY;" + std::to_string(record->sequence) + ";" + record->player_one + ";" + record->player_two + ";" +
+                         std::to_string(record->result) + ";" + std::to_string(record->first_turn) + ";";
+
+    // Unpack the moves straight from the mapped record as row,column pairs.
+    const uint8_t* moves = record->moves();
+    for (int i = 0; i < record->move_count; ++i) {
+        replay += std::to_string(moves[i] / record->board_size) + "," + std::to_string(moves[i] % record->board_size);
+        if (i + 1 < record->move_count) {
+            replay += ",";
+        }
+    }
+    replay += ";";
+
+    // Deliver the replay to the player.
+    deliver_message_to_client(player, replay);
+}
+
 // Sends a ping message to the player to check Connector.
 void Responder::ping_player(Player* player) {
     // Log the ping attempt.
     Logger::log(__FILENAME__, __FUNCTION__, "Pinging player: " + player->get_name());
 
     // Send a PING message to the player.
+    TRACE_POINT1(ping, player->get_socket());
+    player->mark_ping_sent(Clock::now());
     deliver_message_to_client(player, "PING;");
 }
 
+// Answers a client's PING; heartbeats go straight to the socket without the delivery log.
+void Responder::answer_ping(Player* player) {
+    Server::sendToClient(player->get_socket(), "ACK;\n");
+}
+
+// Handles a frame that holds nothing but a heartbeat, which is how clients send them, without
+// running the parser. Returns false for every other frame.
+bool Responder::process_heartbeat(Player* player, const std::string& message, Clock::time_point now) {
+    if (message == "PING;|" || message == "PING;") {
+        TRACE_POINT1(ping__received, player->get_socket());
+        Telemetry::count_message(Telemetry::PING);
+        player->mark_seen(now, true);
+        answer_ping(player);
+        return true;
+    }
+    if (message == "ACK;|" || message == "ACK;") {
+        TRACE_POINT1(ack, player->get_socket());
+        Telemetry::count_message(Telemetry::ACK);
+        player->record_ack(now);
+        return true;
+    }
+    return false;
+}
+
 // Splits a string into tokens based on a specified delimiter.
 std::vector<std::string> Responder::tokenize(const std::string& input, const std::string& delimiter) {
     std::vector<std::string> tokens;
@@ -152,7 +244,9 @@ void Responder::process_message(Player* player, const std::string& message) {
     player->set_message_in(message);
 
     // Tokenize the message into parts using ';' as a delimiter.
+    TRACE_POINT2(parse__start, player->get_socket(), message.length());
     std::vector<std::string> message_parts = tokenize(message, ";");
+    TRACE_POINT2(parse__done, player->get_socket(), message_parts.size());
 
     if (message_parts.empty()) {
         // Handle invalid messages by incrementing the invalid message count.
@@ -179,12 +273,23 @@ void Responder::process_message(Player* player, const std::string& message) {
 
     // Extract the message type (first part of the message).
     Logger::log(__FILENAME__, __FUNCTION__, "Processing message: " + message_type + " from player: " + player->get_name());
+    TRACE_SCOPE(dispatch);
+    TelemetryTimer telemetry_timer(message_type);
 
     // Perform actions based on the message type.
     if (message_type == "NAME") {
         player->set_invalid_msg_count(0);
         if (message_parts.size() > 1 && !message_parts[1].empty()) {
-            GameAdmin::resolve_player_login(player->get_socket(), message_parts[1]);
+            // Reconnecting clients may add the number of moves they have seen; -1 asks for the full board.
+            int seen_moves = -1;
+            if (message_parts.size() > 2 && !message_parts[2].empty()) {
+                try {
+                    seen_moves = std::stoi(message_parts[2]);
+                } catch (const std::exception& e) {
+                    Logger::log(__FILENAME__, __FUNCTION__, "Invalid move index from socket: " + std::to_string(player->get_socket()) + ". Error: " + e.what());
+                }
+            }
+            GameAdmin::resolve_player_login(player->get_socket(), message_parts[1], seen_moves);
         }
     } else if (message_type == "WAITING_FOR_GAME") {
         player->set_invalid_msg_count(0);
@@ -213,6 +318,13 @@ void Responder::process_message(Player* player, const std::string& message) {
         } else {
             Logger::log(__FILENAME__, __FUNCTION__, "Invalid operation: Player " + player->get_name() + " is not in RESULT state.");
         }
+    } else if (message_type == "TAKEBACK") {
+        player->set_invalid_msg_count(0);
+        if (player->get_state() == "IN_GAME") {
+            GameAdmin::request_takeback(player);
+        } else {
+            Logger::log(__FILENAME__, __FUNCTION__, "Invalid operation: Player " + player->get_name() + " is not in IN_GAME state.");
+        }
     } else if (message_type == "GAME_OVER") {
         player->set_invalid_msg_count(0);
         if (player->get_state() == "RESULT") {
@@ -227,8 +339,65 @@ void Responder::process_message(Player* player, const std::string& message) {
         } else {
             Logger::log(__FILENAME__, __FUNCTION__, "Invalid operation: Player " + player->get_name() + " cannot exit from state " + player->get_state());
         }
+    } else if (message_type == "REPLAY") {
+        player->set_invalid_msg_count(0);
+        if (player->get_state() == "LOBBY" && message_parts.size() > 1) {
+            try {
+                GameAdmin::send_replay(player, std::stoull(message_parts[1]));
+            } catch (const std::exception& e) {
+                Logger::log(__FILENAME__, __FUNCTION__, "Invalid replay request from player: " + player->get_name() + ". Error: " + e.what());
+            }
+        } else {
+            Logger::log(__FILENAME__, __FUNCTION__, "Invalid operation: Player " + player->get_name() + " is not in LOBBY state.");
+        }
+    } else if (message_type == "LEADERBOARD") {
+        player->set_invalid_msg_count(0);
+        if (player->get_state() == "LOBBY") {
+            try {
+                GameAdmin::send_leaderboard(player, message_parts.size() > 1 ? std::stoi(message_parts[1]) : 10);
+            } catch (const std::exception& e) {
+                Logger::log(__FILENAME__, __FUNCTION__, "Invalid leaderboard request from player: " + player->get_name() + ". Error: " + e.what());
+            }
+        } else {
+            Logger::log(__FILENAME__, __FUNCTION__, "Invalid operation: Player " + player->get_name() + " is not in LOBBY state.");
+        }
+    } else if (message_type == "PROFILE") {
+        player->set_invalid_msg_count(0);
+        if (player->get_state() == "LOBBY") {
+            GameAdmin::send_profile(player);
+        } else {
+            Logger::log(__FILENAME__, __FUNCTION__, "Invalid operation: Player " + player->get_name() + " is not in LOBBY state.");
+        }
+    } else if (message_type == "BOOK") {
+        player->set_invalid_msg_count(0);
+        if (player->get_state() == "LOBBY") {
+            GameAdmin::send_book_moves(player, message_parts.size() > 1 ? message_parts[1] : "");
+        } else {
+            Logger::log(__FILENAME__, __FUNCTION__, "Invalid operation: Player " + player->get_name() + " is not in LOBBY state.");
+        }
+    } else if (message_type == "TOURNAMENT") {
+        player->set_invalid_msg_count(0);
+        if (player->get_state() == "LOBBY" && message_parts.size() > 1) {
+            TournamentAdmin::register_player(player, message_parts[1]);
+        } else {
+            Logger::log(__FILENAME__, __FUNCTION__, "Invalid operation: Player " + player->get_name() + " is not in LOBBY state.");
+        }
+    } else if (message_type == "LOBBY_LIST" || message_type == "GAMES_LIST") {
+        player->set_invalid_msg_count(0);
+        LobbyDirectory::Topic topic = (message_type == "LOBBY_LIST") ? LobbyDirectory::PLAYERS : LobbyDirectory::GAMES;
+        if (player->get_state() == "NEW") {
+            Logger::log(__FILENAME__, __FUNCTION__, "Invalid operation: Player " + player->get_name() + " is not logged in.");
+        } else if (message_parts.size() > 1 && message_parts[1] == "STOP") {
+            LobbyDirectory::unsubscribe(player, topic);
+        } else {
+            LobbyDirectory::subscribe(player, topic);
+        }
+    } else if (message_type == "PING") {
+        TRACE_POINT1(ping__received, player->get_socket());
+        answer_ping(player);
     } else if (message_type == "ACK") {
-        player->ping = true;
+        TRACE_POINT1(ack, player->get_socket());
+        player->record_ack(Clock::now());
     } else {
         player->add_invalid_msg_count();
         Logger::log(__FILENAME__, __FUNCTION__, "Unknown message type received from player: " + player->get_name() + ". Type: " + message_type);
@@ -237,6 +406,12 @@ void Responder::process_message(Player* player, const std::string& message) {
 
 // Processes raw input from a player by splitting it into individual messages.
 void Responder::process_input(Player* player, const std::string& message) {
+    auto now = Clock::now();
+    if (process_heartbeat(player, message, now)) {
+        return;
+    }
+    player->mark_seen(now, false);
+
     // Split the raw input using '|' as a delimiter.
     std::vector<std::string> message_parts = tokenize(message, "|");
     std::vector<std::string> processed_parts;
@@ -247,7 +422,7 @@ void Responder::process_input(Player* player, const std::string& message) {
             processed_parts.push_back(part);
 
             // Ensure the message length is within acceptable limits.
-            if (message.length() < MAX_MESSAGE_LENGTH) {
+            if (message.length() < static_cast<size_t>(Config::get().max_message_length)) {
                 process_message(player, part);
             } else {
                 player->add_invalid_msg_count();
@@ -5,74 +5,330 @@
 #include <cstring>
 #include <iostream>
 
-int MAX_INVALID_MESSAGES = 5;
-
 // File descriptor sets for managing active and ready sockets.
 fd_set Server::active_sockets, Server::ready_sockets;
 struct sockaddr_in Server::peer_address, Server::client_address, Server::server_address;
+bool Server::offline = false;
+int Server::router_channel = -1;
+int Server::send_batch_depth = 0;
+std::map<int, std::string> Server::batched_sends;
+uint64_t Server::discarded_bytes = 0;
 
 // Constructor initializes the server with given IP, port, and max games allowed.
-Server::Server(const std::string &ip, int port, int max_games)
-    : server_ip(ip), server_port(port), max_allowed_games(max_games), server_socket_fd(-1), client_socket_fd(-1) {
-    Logger::log(__FILENAME__, __FUNCTION__, "Server initialized: IP=" + ip + ", Port=" + std::to_string(port) + ", Max Games=" + std::to_string(max_games));
+Server::Server(const std::string &ip, int port, int max_games, const std::string &backend)
+    : server_ip(ip), server_port(port), max_allowed_games(max_games), server_socket_fd(-1), local_socket_fd(-1), websocket_socket_fd(-1), client_socket_fd(-1), io_backend(backend) {
+    Logger::log(__FILENAME__, __FUNCTION__, "Server initialized: IP=" + ip + ", Port=" + std::to_string(port) + ", Max Games=" + std::to_string(max_games) + ", Backend=" + backend);
 }
 
 // Sets up the server, including socket creation, binding, and listening.
 int Server::initialize() {
     Logger::log(__FILENAME__, __FUNCTION__, "Setting up server: IP=" + server_ip + ", Port=" + std::to_string(server_port) + ", Max Games=" + std::to_string(max_allowed_games));
 
-    // Create a socket for the server.
-    server_socket_fd = socket(AF_INET, SOCK_STREAM, 0);
+    server_socket_fd = openListener(server_ip, server_port, max_allowed_games);
     if (server_socket_fd < 0) {
+        return -1;
+    }
+
+    // Configure the GameAdmin with the maximum number of games.
+    GameAdmin::configure_max_games(max_allowed_games);
+    openLocalEndpoint();
+    openWebSocketEndpoint();
+    HotRestart::listen_for_successor(server_port);
+    Logger::log(__FILENAME__, __FUNCTION__, "Server is ready to accept connections");
+    return 0;
+}
+
+// Creates the listening socket, bound to the given address; shared with the shard router.
+int Server::openListener(const std::string &ip, int port, int backlog) {
+    // Create a socket for the server.
+    int listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (listen_fd < 0) {
         Logger::log(__FILENAME__, __FUNCTION__, "Error: Unable to create socket");
         return -1;
     }
 
     // Set socket options to allow address reuse.
     int reuse_option = 1;
-    if (setsockopt(server_socket_fd, SOL_SOCKET, SO_REUSEADDR, &reuse_option, sizeof(reuse_option)) < 0) {
+    if (setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &reuse_option, sizeof(reuse_option)) < 0) {
         Logger::log(__FILENAME__, __FUNCTION__, "Error: Failed to set socket options");
     }
 
     // Configure the server address structure.
     server_address.sin_family = AF_INET;
-    server_address.sin_port = htons(server_port);
-    server_address.sin_addr.s_addr = (server_ip == "localhost") ? inet_addr("127.0.0.1") : (server_ip == "INADDR_ANY" ? INADDR_ANY : inet_addr(server_ip.c_str()));
+    server_address.sin_port = htons(port);
+    server_address.sin_addr.s_addr = (ip == "localhost") ? inet_addr("127.0.0.1") : (ip == "INADDR_ANY" ? INADDR_ANY : inet_addr(ip.c_str()));
 
     if (server_address.sin_addr.s_addr == INADDR_NONE) {
         Logger::log(__FILENAME__, __FUNCTION__, "Error: Invalid IP address");
+        close(listen_fd);
         return -1;
     }
 
     // Bind the socket to the specified IP and port.
-    if (bind(server_socket_fd, (struct sockaddr *)&server_address, sizeof(server_address)) < 0) {
+    if (bind(listen_fd, (struct sockaddr *)&server_address, sizeof(server_address)) < 0) {
         Logger::log(__FILENAME__, __FUNCTION__, "Error: Failed to bind socket");
+        close(listen_fd);
         return -1;
     }
 
     // Start listening for incoming connections.
-    if (listen(server_socket_fd, max_allowed_games) < 0) {
+    if (listen(listen_fd, backlog) < 0) {
         Logger::log(__FILENAME__, __FUNCTION__, "Error: Listening failed");
+        close(listen_fd);
         return -1;
     }
+    return listen_fd;
+}
 
-    // Configure the GameAdmin with the maximum number of games.
+// Creates a Unix domain listener for clients on this host. With SOCK_SEQPACKET every read returns
+// exactly one send of the client, so a batch of commands is never split or merged on the way.
+int Server::openLocalListener(const std::string &path, const std::string &type, int backlog) {
+    struct sockaddr_un local_address = {};
+    if (path.length() >= sizeof(local_address.sun_path)) {
+        Logger::log(__FILENAME__, __FUNCTION__, "Error: Local socket path is too long: " + path);
+        return -1;
+    }
+
+    int listen_fd = socket(AF_UNIX, (type == "seqpacket") ? SOCK_SEQPACKET : SOCK_STREAM, 0);
+    if (listen_fd < 0) {
+        Logger::log(__FILENAME__, __FUNCTION__, "Error: Unable to create local socket");
+        return -1;
+    }
+
+    // A socket file left by a previous run or handed over server would block the bind.
+    local_address.sun_family = AF_UNIX;
+    strncpy(local_address.sun_path, path.c_str(), sizeof(local_address.sun_path) - 1);
+    unlink(path.c_str());
+    if (bind(listen_fd, (struct sockaddr *)&local_address, sizeof(local_address)) < 0 || listen(listen_fd, backlog) < 0) {
+        Logger::log(__FILENAME__, __FUNCTION__, "Error: Unable to listen on local socket " + path);
+        close(listen_fd);
+        return -1;
+    }
+    return listen_fd;
+}
+
+// Opens the configured local endpoint next to the TCP listener; TCP keeps working without it.
+void Server::openLocalEndpoint() {
+    const ServerConfig &config = Config::get();
+    if (config.local_socket.empty()) {
+        return;
+    }
+    local_socket_fd = openLocalListener(config.local_socket, config.local_socket_type, max_allowed_games);
+    if (local_socket_fd >= 0) {
+        Logger::log(__FILENAME__, __FUNCTION__, "Listening locally on " + config.local_socket + " (" + config.local_socket_type + ")");
+    } else {
+        Logger::log(__FILENAME__, __FUNCTION__, "Warning: Local clients will have to use TCP");
+    }
+}
+
+// Opens the WebSocket listener for browser clients on the configured port.
+void Server::openWebSocketEndpoint() {
+    const ServerConfig &config = Config::get();
+    if (config.websocket_port == 0 || websocket_socket_fd >= 0) {
+        return;
+    }
+    websocket_socket_fd = openListener(server_ip, config.websocket_port, max_allowed_games);
+    if (websocket_socket_fd >= 0) {
+        Logger::log(__FILENAME__, __FUNCTION__, "Accepting WebSocket clients on port " + std::to_string(config.websocket_port));
+    } else {
+        Logger::log(__FILENAME__, __FUNCTION__, "Warning: Browser clients will not be able to connect");
+    }
+}
+
+// Takes over the listening socket, connections and game state handed over by a previous process.
+int Server::adopt(int listen_fd, const std::map<int, int> &sockets, const std::string &state) {
+    Logger::log(__FILENAME__, __FUNCTION__, "Adopting server: IP=" + server_ip + ", Port=" + std::to_string(server_port) + ", Connections=" + std::to_string(sockets.size()));
+
+    // The game state comes first, then the protocol state of the WebSocket connections.
     GameAdmin::configure_max_games(max_allowed_games);
+    HandoffBuffer buffer(state);
+    std::string game_state;
+    if (!buffer.get_string(game_state) || !GameAdmin::restore_state(game_state, sockets) || !WebSocketGateway::restore_state(buffer, sockets) || !buffer.is_consumed()) {
+        Logger::log(__FILENAME__, __FUNCTION__, "Error: Unable to restore the handed over state");
+        HotRestart::confirm_takeover(false);
+        return -1;
+    }
+
+    // Every inherited connection gets its session back. The WebSocket listener travels with the connections.
+    server_socket_fd = listen_fd;
+    for (const auto &[old_socket, client_fd] : sockets) {
+        int listening = 0;
+        socklen_t option_length = sizeof(listening);
+        if (getsockopt(client_fd, SOL_SOCKET, SO_ACCEPTCONN, &listening, &option_length) == 0 && listening) {
+            websocket_socket_fd = client_fd;
+            continue;
+        }
+        inherited_sockets.push_back(client_fd);
+        RateLimiter::register_connection(client_fd, peerAddress(client_fd));
+        SessionAdmin::open(client_fd, runSession(client_fd));
+    }
+
+    // Let the predecessor exit, then become replaceable in turn. A predecessor that gave up waiting
+    // serves on, so this process must not. The local endpoint is not handed over; binding it again
+    // takes the path from the predecessor.
+    if (!HotRestart::confirm_takeover(true)) {
+        Logger::log(__FILENAME__, __FUNCTION__, "Error: The predecessor stopped waiting for the takeover");
+        return -1;
+    }
+    openLocalEndpoint();
+    openWebSocketEndpoint();
+    HotRestart::listen_for_successor(server_port);
     Logger::log(__FILENAME__, __FUNCTION__, "Server is ready to accept connections");
     return 0;
 }
 
+// Serves as one shard behind the router: clients arrive over the router channel instead of a listener.
+int Server::attachRouter(int channel_fd) {
+    Logger::log(__FILENAME__, __FUNCTION__, "Attaching to the router: Shard=" + std::to_string(ShardDirectory::get_local_shard()) + ", Max Games=" + std::to_string(max_allowed_games));
+
+    // The router channel is watched next to the client sockets, which only the select loop can do.
+    GameAdmin::configure_max_games(max_allowed_games);
+    if (!Config::get().local_socket.empty()) {
+        Logger::log(__FILENAME__, __FUNCTION__, "Warning: Shards do not listen on the local socket");
+    }
+    router_channel = channel_fd;
+    io_backend = "select";
+    SessionAdmin::spawn(watchShardClaims());
+    Logger::log(__FILENAME__, __FUNCTION__, "Server is ready to accept connections");
+    return 0;
+}
+
+// Hands the listening socket, all connections and the game state to a successor process.
+bool Server::handOver() {
+    std::vector<int> sockets = GameAdmin::connected_sockets();
+    std::string game_state;
+    GameAdmin::save_state(game_state);
+    HandoffBuffer buffer;
+    buffer.put_string(game_state);
+    WebSocketGateway::save_state(buffer);
+    const std::string &state = buffer.get_data();
+    ProfileStore::flush();
+    TrafficRecorder::flush();
+
+    // The WebSocket listener goes along with the connections.
+    std::vector<int> handed_over = sockets;
+    if (websocket_socket_fd >= 0) {
+        handed_over.push_back(websocket_socket_fd);
+    }
+    if (HotRestart::hand_over(server_socket_fd, handed_over, state)) {
+        TrafficRecorder::close();
+        if (local_socket_fd >= 0) {
+            close(local_socket_fd);
+        }
+        Logger::log(__FILENAME__, __FUNCTION__, "Server handed over, exiting");
+        return true;
+    }
+
+    // The successor failed; keep serving the same connections.
+    if (UringBackend::is_active()) {
+        UringBackend::resume(sockets);
+    }
+    return false;
+}
+
 // Waits for incoming client connections and processes their requests.
 void Server::waitForConnections() {
     Logger::log(__FILENAME__, __FUNCTION__, "Waiting for incoming connections");
 
+    // Prefer the io_uring backend and fall back to select where the kernel lacks support.
+    if (io_backend == "uring" && UringBackend::initialize(server_socket_fd)) {
+        if (local_socket_fd >= 0) {
+            UringBackend::add_listener(local_socket_fd);
+        }
+        if (websocket_socket_fd >= 0) {
+            UringBackend::add_listener(websocket_socket_fd);
+        }
+        for (int client_fd : inherited_sockets) {
+            UringBackend::adopt_connection(client_fd);
+        }
+        waitForUringEvents();
+    } else {
+        Logger::log(__FILENAME__, __FUNCTION__, "Using the select backend");
+        waitForSelectEvents();
+    }
+}
+
+// Runs the io_uring loop: one io_uring_enter submits queued sends and collects a batch of completions.
+void Server::waitForUringEvents() {
+    std::vector<UringEvent> events;
+
+    while (true) {
+        // On a takeover request stop all I/O first and hand over once it has settled.
+        if (HotRestart::is_requested()) {
+            if (!UringBackend::is_quiescing()) {
+                UringBackend::quiesce();
+            } else if (UringBackend::is_quiet() && handOver()) {
+                return;
+            }
+        }
+
+        // Sleep no longer than the next session timer.
+        UringBackend::wait_events(events, SessionAdmin::next_timer_timeout());
+        StallWatchdog::begin_iteration();
+
+        for (const UringEvent &event : events) {
+            // Skip completions of connections closed earlier in this batch.
+            if (!UringBackend::is_current(event)) {
+                UringBackend::recycle(event);
+                continue;
+            }
+
+            if (event.type == UringEvent::ACCEPTED) {
+                // Resolve the peer address once; multishot accept does not report it.
+                if (event.listen_fd == websocket_socket_fd) {
+                    WebSocketGateway::open(event.fd, false);
+                }
+                registerClient(event.fd, peerAddress(event.fd).c_str());
+            } else if (event.type == UringEvent::RECEIVED) {
+                // Data is parsed straight from the provided buffer, which is handed back afterwards.
+                TRACE_POINT2(recv__done, event.fd, event.length);
+                receiveData(event.fd, event.data, event.length);
+                UringBackend::recycle(event);
+            } else {
+                TrafficRecorder::record_close(event.fd);
+                terminate_client_connection(event.fd);
+            }
+        }
+
+        SessionAdmin::run_due_timers();
+        StallWatchdog::end_iteration();
+    }
+}
+
+// Runs the select loop over all connected sockets.
+void Server::waitForSelectEvents() {
     FD_ZERO(&active_sockets);
-    FD_SET(server_socket_fd, &active_sockets);
+    for (int listen_fd : {server_socket_fd, local_socket_fd, websocket_socket_fd, router_channel}) {
+        if (listen_fd >= 0) {
+            watchSocket(listen_fd);
+        }
+    }
+
+    // Connections inherited from an io_uring predecessor may be numbered beyond what select can watch.
+    for (int client_fd : inherited_sockets) {
+        if (!watchSocket(client_fd)) {
+            TrafficRecorder::record_close(client_fd);
+            terminate_client_connection(client_fd);
+        }
+    }
 
     while (true) {
+        // Reads and writes are synchronous here, so a takeover can happen right away.
+        if (HotRestart::is_requested() && handOver()) {
+            return;
+        }
+
         // Prepare the ready sockets set for select.
         ready_sockets = active_sockets;
-        select(FD_SETSIZE, &ready_sockets, nullptr, nullptr, nullptr);
+
+        // Sleep no longer than the next session timer.
+        int timeout_ms = SessionAdmin::next_timer_timeout();
+        struct timeval timeout = {timeout_ms / 1000, (timeout_ms % 1000) * 1000};
+        int ready = select(FD_SETSIZE, &ready_sockets, nullptr, nullptr, timeout_ms >= 0 ? &timeout : nullptr);
+        if (ready <= 0) {
+            FD_ZERO(&ready_sockets);
+        }
+        StallWatchdog::begin_iteration();
 
         // Iterate through all possible file descriptors to handle events.
         for (int fd = 0; fd < FD_SETSIZE; ++fd) {
@@ -80,12 +336,24 @@ void Server::waitForConnections() {
                 if (fd == server_socket_fd) {
                     // Accept a new client connection.
                     acceptClientConnection();
+                } else if (fd == local_socket_fd) {
+                    // Accept a client on this host.
+                    acceptLocalConnection();
+                } else if (fd == websocket_socket_fd) {
+                    // Accept a browser client; it has to upgrade before anything else.
+                    acceptWebSocketConnection();
+                } else if (fd == router_channel) {
+                    // Take over a client the router passed to this shard.
+                    receiveRoutedClient();
                 } else {
                     // Process an existing client request.
                     processClientRequest(fd);
                 }
             }
         }
+
+        SessionAdmin::run_due_timers();
+        StallWatchdog::end_iteration();
     }
 }
 
@@ -94,16 +362,157 @@ void Server::acceptClientConnection() {
     socklen_t client_len = sizeof(client_address);
     client_socket_fd = accept(server_socket_fd, (struct sockaddr *)&client_address, &client_len);
 
-    if (client_socket_fd >= 0) {
-        FD_SET(client_socket_fd, &active_sockets);
-        char *client_ip = inet_ntoa(client_address.sin_addr);
-        GameAdmin::add_new_unregistered_player(client_ip, client_socket_fd);
-        Logger::log(__FILENAME__, __FUNCTION__, "New client connected: IP=" + std::string(client_ip));
+    if (client_socket_fd >= 0 && !watchSocket(client_socket_fd)) {
+        close(client_socket_fd);
+    } else if (client_socket_fd >= 0) {
+        registerClient(client_socket_fd, inet_ntoa(client_address.sin_addr));
     } else {
         Logger::log(__FILENAME__, __FUNCTION__, "Error: Unable to accept connection");
     }
 }
 
+// Accepts a browser client on the WebSocket listener.
+void Server::acceptWebSocketConnection() {
+    socklen_t client_len = sizeof(client_address);
+    client_socket_fd = accept(websocket_socket_fd, (struct sockaddr *)&client_address, &client_len);
+
+    if (client_socket_fd >= 0 && !watchSocket(client_socket_fd)) {
+        close(client_socket_fd);
+    } else if (client_socket_fd >= 0) {
+        WebSocketGateway::open(client_socket_fd, false);
+        registerClient(client_socket_fd, inet_ntoa(client_address.sin_addr));
+    } else {
+        Logger::log(__FILENAME__, __FUNCTION__, "Error: Unable to accept WebSocket connection");
+    }
+}
+
+// Accepts a client on the local socket; local clients are rate limited per connection only.
+void Server::acceptLocalConnection() {
+    client_socket_fd = accept(local_socket_fd, nullptr, nullptr);
+
+    if (client_socket_fd >= 0 && !watchSocket(client_socket_fd)) {
+        close(client_socket_fd);
+    } else if (client_socket_fd >= 0) {
+        registerClient(client_socket_fd, RateLimiter::LOCAL_ADDRESS);
+    } else {
+        Logger::log(__FILENAME__, __FUNCTION__, "Error: Unable to accept local connection");
+    }
+}
+
+// Adds a socket to the select set; select cannot watch descriptors from FD_SETSIZE on.
+bool Server::watchSocket(int fd) {
+    if (fd >= FD_SETSIZE) {
+        Logger::log(__FILENAME__, __FUNCTION__, "Error: Socket " + std::to_string(fd) + " is beyond the select limit of " + std::to_string(FD_SETSIZE));
+        return false;
+    }
+    FD_SET(fd, &active_sockets);
+    return true;
+}
+
+// Registers a freshly accepted client as an unregistered player and starts its session.
+void Server::registerClient(int client_fd, const char *client_ip) {
+    TrafficRecorder::record_open(client_fd, client_ip);
+
+    // Turn the connection away before any state is created when accepts come too fast.
+    if (!RateLimiter::admit_connection(client_ip)) {
+        closeConnection(client_fd);
+        return;
+    }
+
+    RateLimiter::register_connection(client_fd, client_ip);
+    GameAdmin::add_new_unregistered_player(client_ip, client_fd);
+    Logger::log(__FILENAME__, __FUNCTION__, "New client connected: IP=" + std::string(client_ip));
+    SessionAdmin::open(client_fd, runSession(client_fd));
+}
+
+// Registers a client passed by the router along with the bytes it already read from it.
+void Server::receiveRoutedClient() {
+    std::string payload;
+    std::vector<int> fds;
+    if (!HotRestart::receive_message(router_channel, payload, fds)) {
+        // Connected clients stay; only new ones and migrations stop.
+        Logger::log(__FILENAME__, __FUNCTION__, "Router channel closed");
+        FD_CLR(router_channel, &active_sockets);
+        close(router_channel);
+        router_channel = -1;
+        return;
+    }
+
+    HandoffBuffer message(payload);
+    int32_t kind = 0;
+    std::string data;
+    if (fds.size() != 1 || !message.get_int(kind) || !message.get_string(data)) {
+        Logger::log(__FILENAME__, __FUNCTION__, "Error: Malformed message from the router");
+        for (int fd : fds) {
+            close(fd);
+        }
+        return;
+    }
+
+    int client_fd = fds[0];
+    if (!watchSocket(client_fd)) {
+        close(client_fd);
+        return;
+    }
+    registerClient(client_fd, peerAddress(client_fd).c_str());
+    if (!SessionAdmin::has_session(client_fd)) {
+        return;
+    }
+
+    if (kind == ShardRouter::MIGRATED) {
+        GameAdmin::adopt_migrated_player(client_fd, data);
+    } else if (!data.empty()) {
+        receiveFrame(client_fd, data);
+    }
+}
+
+// Hands the players other shards claimed from the shared match queue over to them.
+SessionTask Server::watchShardClaims() {
+    std::vector<std::string> names;
+    std::vector<int> targets;
+    while (router_channel >= 0) {
+        co_await SessionAdmin::sleep_for_milliseconds(ShardDirectory::CLAIM_POLL_MS);
+        ShardDirectory::collect_claimed(names, targets);
+        for (size_t i = 0; i < names.size(); ++i) {
+            // Only a connected player still waiting here can go; the claimer keeps waiting otherwise.
+            Player *player = GameAdmin::find_registered_player_by_name(names[i]);
+            if (player && player->get_state() == "WAITING" && player->get_connection_status() == 0 && player->get_socket() > 0) {
+                migrateClient(player, targets[i]);
+            }
+        }
+    }
+}
+
+// Sends a player's connection to another shard through the router and forgets the player here.
+void Server::migrateClient(Player *player, int shard) {
+    int client_fd = player->get_socket();
+    HandoffBuffer message;
+    message.put_int(ShardRouter::MIGRATE);
+    message.put_int(shard);
+    message.put_string(player->get_name());
+    if (!HotRestart::send_message(router_channel, message.get_data(), &client_fd, 1)) {
+        Logger::log(__FILENAME__, __FUNCTION__, "Error: Unable to migrate player " + player->get_name());
+        return;
+    }
+
+    Logger::log(__FILENAME__, __FUNCTION__, "Player " + player->get_name() + " migrated to shard " + std::to_string(shard));
+    GameAdmin::release_migrated_player(player);
+    closeConnection(client_fd);
+}
+
+// Session coroutine of one connection: every frame read from the socket is handled in turn
+// until the connection is closed.
+SessionTask Server::runSession(int client_fd) {
+    while (true) {
+        std::optional<std::string> message = co_await SessionAdmin::read_frame();
+        if (!message) {
+            break;
+        }
+        handleIncomingData(client_fd, *message);
+    }
+    Logger::log(__FILENAME__, __FUNCTION__, "Session ended: FD=" + std::to_string(client_fd));
+}
+
 // Handles client requests based on their file descriptor.
 void Server::processClientRequest(int client_fd) {
     int bytes_ready;
@@ -114,32 +523,106 @@ void Server::processClientRequest(int client_fd) {
         manageIncomingData(client_fd);
     } else if (bytes_ready == 0) {
         // Terminate the connection if the client closed the socket.
+        TrafficRecorder::record_close(client_fd);
         terminate_client_connection(client_fd);
     } else {
         // Close the connection if an error occurred.
+        TrafficRecorder::record_close(client_fd);
         closeConnection(client_fd);
     }
 }
 
 // Processes incoming data from a client and handles invalid messages.
 void Server::manageIncomingData(int client_fd) {
-    char buffer[1024] = {0};
-    recv(client_fd, buffer, sizeof(buffer), 0);
-    std::string message(buffer);
+    // One buffer of the configured size serves every read.
+    static std::vector<char> buffer;
+    buffer.resize(Config::get().receive_buffer_bytes);
+    TRACE_POINT1(recv__start, client_fd);
+    ssize_t length = recv(client_fd, buffer.data(), buffer.size(), 0);
+    TRACE_POINT2(recv__done, client_fd, length);
+    receiveData(client_fd, buffer.data(), std::max<ssize_t>(length, 0));
+}
+
+// Unwraps WebSocket frames, which then take the path of a raw TCP read one message at a time.
+void Server::receiveData(int client_fd, const char *bytes, size_t length) {
+    if (!WebSocketGateway::is_tracked(client_fd)) {
+        receiveFrame(client_fd, std::string_view(bytes, length));
+        return;
+    }
+
+    // The gateway unmasks in place and keeps partial frames, so it works on its own copy of the read.
+    std::string data(bytes, length);
+    std::vector<std::string_view> messages;
+    std::string reply;
+    bool keep = WebSocketGateway::receive(client_fd, data, messages, reply);
+    if (!reply.empty()) {
+        sendRaw(client_fd, reply);
+    }
+    for (std::string_view message : messages) {
+        if (!SessionAdmin::has_session(client_fd)) {
+            return;
+        }
+        receiveFrame(client_fd, message);
+    }
+    if (!keep && SessionAdmin::has_session(client_fd)) {
+        TrafficRecorder::record_close(client_fd);
+        terminate_client_connection(client_fd);
+    }
+}
+
+// Applies the rate limits to a read before it reaches the session and the parser.
+void Server::receiveFrame(int client_fd, std::string_view message) {
+    // Record before the limits, so a replay takes the same decisions.
+    TrafficRecorder::record_frame(client_fd, message);
 
+    switch (RateLimiter::admit_frame(client_fd, message)) {
+        case RateLimiter::ADMIT:
+            SessionAdmin::deliver(client_fd, message);
+            break;
+        case RateLimiter::DROP:
+            break;
+        case RateLimiter::DISCONNECT:
+            terminate_client_connection(client_fd);
+            break;
+    }
+}
+
+// Hands a received message to the player's responder and handles invalid messages.
+void Server::handleIncomingData(int client_fd, const std::string &message) {
     Player *player = GameAdmin::find_registered_player_by_socket(client_fd);
     if (!player) {
         player = GameAdmin::find_unregistered_player_by_socket(client_fd);
     }
 
+    StallWatchdog::set_context(client_fd, player->get_game_id());
     Responder::process_input(player, message);
 
     // Terminate the connection if the player exceeds the maximum invalid message count.
-    if (player->get_invalid_msg_count() >= MAX_INVALID_MESSAGES) {
+    if (player->get_invalid_msg_count() >= Config::get().max_invalid_messages) {
         terminate_client_connection(client_fd);
     }
 }
 
+// Feeds one recorded event through the same path a live connection takes; used by the traffic replay.
+void Server::replayEvent(const TrafficEvent &event) {
+    switch (event.kind) {
+        case TrafficEvent::OPEN:
+            registerClient(event.connection, event.data.c_str());
+            break;
+        case TrafficEvent::FRAME:
+            // The server may have dropped the connection already, like a live socket it ignores late data.
+            if (SessionAdmin::has_session(event.connection)) {
+                receiveFrame(event.connection, event.data);
+            }
+            break;
+        case TrafficEvent::CLOSE:
+            if (SessionAdmin::has_session(event.connection)) {
+                terminate_client_connection(event.connection);
+            }
+            break;
+    }
+}
+
 // Terminates the connection for a given client.
 void Server::terminate_client_connection(int client_fd) {
     Player *player = GameAdmin::find_registered_player_by_socket(client_fd);
@@ -153,7 +636,8 @@ void Server::terminate_client_connection(int client_fd) {
                     ", Socket: " + std::to_string(client_fd) +
                     ", State: " + player->get_state() +
                     ", Active: " + std::to_string(player->is_active) +
-                    ", Ping: " + std::to_string(player->ping));
+                    ", Ping: " + std::to_string(player->ping) +
+                    ", RTT: " + std::to_string(player->get_rtt()) + " us");
     } else {
         Logger::log(__FILENAME__, __FUNCTION__, 
                     "No player found for Socket: " + std::to_string(client_fd));
@@ -185,12 +669,76 @@ void Server::terminate_client_connection(int client_fd) {
     closeConnection(client_fd);
     if (player && player->get_state().compare("NEW") == 0) {
         GameAdmin::unlogged_players.erase(client_fd);
+        Reaper::retire_player(player);
     }
 }
 
 // Closes the connection for a specific client file descriptor.
 void Server::closeConnection(int client_fd) {
     Logger::log(__FILENAME__, __FUNCTION__, "Closing client connection: FD=" + std::to_string(client_fd));
+    WebSocketGateway::release(client_fd);
+    if (offline) {
+        SessionAdmin::close(client_fd);
+        RateLimiter::release_connection(client_fd);
+        return;
+    }
+    if (UringBackend::is_active()) {
+        UringBackend::release_connection(client_fd);
+    }
+    SessionAdmin::close(client_fd);
+    RateLimiter::release_connection(client_fd);
+    batched_sends.erase(client_fd);
     close(client_fd);
-    FD_CLR(client_fd, &active_sockets);
+    if (client_fd < FD_SETSIZE) {
+        FD_CLR(client_fd, &active_sockets);
+    }
+}
+
+// Returns the remote IP address of a connected socket, or the shared local address for a Unix domain socket.
+std::string Server::peerAddress(int client_fd) {
+    struct sockaddr_storage peer;
+    socklen_t peer_len = sizeof(peer);
+    if (getpeername(client_fd, (struct sockaddr *)&peer, &peer_len) < 0) {
+        return "0.0.0.0";
+    }
+    if (peer.ss_family == AF_UNIX) {
+        return RateLimiter::LOCAL_ADDRESS;
+    }
+    return inet_ntoa(reinterpret_cast<struct sockaddr_in *>(&peer)->sin_addr);
+}
+
+// Sends a message to a client; a WebSocket client gets it as one text frame.
+void Server::sendToClient(int client_fd, const std::string &data) {
+    if (WebSocketGateway::is_upgraded(client_fd)) {
+        sendRaw(client_fd, WebSocketGateway::frame(data));
+    } else {
+        sendRaw(client_fd, data);
+    }
+}
+
+// Sends raw data to a client through the active I/O backend.
+void Server::sendRaw(int client_fd, const std::string &data) {
+    TRACE_POINT2(send__start, client_fd, data.length());
+    if (offline) {
+        discarded_bytes += data.length();
+    } else if (UringBackend::is_active()) {
+        UringBackend::queue_send(client_fd, data.data(), data.length());
+    } else if (send_batch_depth > 0) {
+        batched_sends[client_fd] += data;
+    } else {
+        send(client_fd, data.data(), data.length(), MSG_NOSIGNAL);
+    }
+    TRACE_POINT1(send__done, client_fd);
+}
+
+// Sends everything queued since beginSendBatch with one send per client. The io_uring backend
+// coalesces sends per socket by itself, so only the select backend ever queues here.
+void Server::flushSendBatch() {
+    if (--send_batch_depth > 0) {
+        return;
+    }
+    for (const auto &[client_fd, data] : batched_sends) {
+        send(client_fd, data.data(), data.length(), MSG_NOSIGNAL);
+    }
+    batched_sends.clear();
 }
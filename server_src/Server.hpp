@@ -3,9 +3,20 @@
 
 #include <string>
 #include <netinet/in.h>
+#include <sys/un.h>
 #include "Logger.hpp"
 #include "GameAdmin.hpp"
 #include "Responder.hpp"
+#include "UringBackend.hpp"
+#include "Session.hpp"
+#include "HotRestart.hpp"
+#include "RateLimiter.hpp"
+#include "Reaper.hpp"
+#include "TrafficRecorder.hpp"
+#include "StallWatchdog.hpp"
+#include "ShardRouter.hpp"
+#include "Trace.hpp"
+#include "WebSocketGateway.hpp"
 
 class Server {
 private:
@@ -13,20 +24,57 @@ private:
     int server_port;
     int max_allowed_games;
     int server_socket_fd;
+    int local_socket_fd;
+    int websocket_socket_fd;
     int client_socket_fd;
+    std::string io_backend;
+    std::vector<int> inherited_sockets;
     static fd_set active_sockets, ready_sockets;
     static struct sockaddr_in peer_address, client_address, server_address;
+    static bool offline;
+    static int router_channel;
+    static int send_batch_depth;
+    static std::map<int, std::string> batched_sends;
+    static uint64_t discarded_bytes;
 
     void acceptClientConnection();
+    void acceptLocalConnection();
+    void openLocalEndpoint();
+    void acceptWebSocketConnection();
+    void openWebSocketEndpoint();
+    void receiveData(int client_fd, const char *bytes, size_t length);
     void processClientRequest(int client_fd);
     void manageIncomingData(int client_fd);
+    void receiveFrame(int client_fd, std::string_view message);
+    void handleIncomingData(int client_fd, const std::string &message);
+    bool watchSocket(int fd);
+    void registerClient(int client_fd, const char *client_ip);
+    SessionTask runSession(int client_fd);
     void terminate_client_connection(int client_fd);
+    void waitForSelectEvents();
+    void waitForUringEvents();
+    bool handOver();
+    void receiveRoutedClient();
+    static SessionTask watchShardClaims();
+    static void migrateClient(Player *player, int shard);
 
 public:
-    Server(const std::string &ip, int port, int max_games);
+    Server(const std::string &ip, int port, int max_games, const std::string &backend = "uring");
     int initialize();
+    int adopt(int listen_fd, const std::map<int, int> &sockets, const std::string &state);
+    int attachRouter(int channel_fd);
+    static int openListener(const std::string &ip, int port, int backlog);
+    static int openLocalListener(const std::string &path, const std::string &type, int backlog);
     void waitForConnections();
+    void replayEvent(const TrafficEvent &event);
+    static void goOffline() { offline = true; };
+    static uint64_t getDiscardedBytes() { return discarded_bytes; };
     static void closeConnection(int client_fd);
+    static void sendToClient(int client_fd, const std::string &data);
+    static void sendRaw(int client_fd, const std::string &data);
+    static void beginSendBatch() { send_batch_depth++; };
+    static void flushSendBatch();
+    static std::string peerAddress(int client_fd);
 };
 
 #endif // SERVER_HPP
\ No newline at end of file
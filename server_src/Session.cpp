@@ -0,0 +1,170 @@
+#include "Session.hpp"
+#include <new>
+
+FramePool::FreeBlock *FramePool::free_lists[FramePool::CLASS_COUNT];
+size_t FramePool::live_frames = 0;
+
+std::map<int, Session *> SessionAdmin::sessions;
+std::multimap<std::chrono::steady_clock::time_point, std::coroutine_handle<> > SessionAdmin::timers;
+
+void *FramePool::allocate(size_t size) {
+    live_frames++;
+
+    // Frames beyond the largest size class come straight from the heap.
+    size_t size_class = (size + CLASS_SIZE - 1) / CLASS_SIZE;
+    if (size_class >= CLASS_COUNT) {
+        return ::operator new(size);
+    }
+
+    // Reuse a released block of the same class when there is one.
+    FreeBlock *block = free_lists[size_class];
+    if (block) {
+        free_lists[size_class] = block->next;
+        return block;
+    }
+    return ::operator new(size_class * CLASS_SIZE);
+}
+
+void FramePool::release(void *frame, size_t size) {
+    live_frames--;
+
+    size_t size_class = (size + CLASS_SIZE - 1) / CLASS_SIZE;
+    if (size_class >= CLASS_COUNT) {
+        ::operator delete(frame);
+        return;
+    }
+
+    // Keep the block on its class free list for the next session.
+    FreeBlock *block = static_cast<FreeBlock *>(frame);
+    block->next = free_lists[size_class];
+    free_lists[size_class] = block;
+}
+
+void SessionTask::promise_type::return_void() {
+    // Let the session owner know the frame is gone once the current resume returns.
+    if (session) {
+        session->finished = true;
+    }
+}
+
+bool FrameAwaiter::await_suspend(std::coroutine_handle<SessionTask::promise_type> handle) {
+    // Only suspend when there is nothing to hand back right away.
+    session = handle.promise().session;
+    if (!session->inbox.empty() || session->closed) {
+        return false;
+    }
+    session->waiting = handle;
+    return true;
+}
+
+std::optional<std::string> FrameAwaiter::await_resume() {
+    // Queued frames are still delivered before the close is reported.
+    if (session->inbox.empty()) {
+        return std::nullopt;
+    }
+    std::string frame = std::move(session->inbox.front());
+    session->inbox.pop_front();
+    return frame;
+}
+
+void TimerAwaiter::await_suspend(std::coroutine_handle<> handle) {
+    SessionAdmin::timers.emplace(deadline, handle);
+}
+
+void SessionAdmin::open(int socket, SessionTask task) {
+    // A session still registered on a reused socket number is closed first.
+    if (sessions.count(socket)) {
+        close(socket);
+    }
+
+    Session *session = new Session{socket, false, false, false, std::deque<std::string>(), std::coroutine_handle<>()};
+    sessions[socket] = session;
+    task.get_handle().promise().session = session;
+    session->waiting = task.get_handle();
+
+    // Run the coroutine up to its first read.
+    Logger::log(__FILENAME__, __FUNCTION__, "Session opened: Socket=" + std::to_string(socket) + ", Frames=" + std::to_string(FramePool::get_live_frames()));
+    resume(session);
+}
+
+void SessionAdmin::spawn(SessionTask task) {
+    // Detached coroutines only wait on timers; they start right away and free themselves.
+    task.get_handle().resume();
+}
+
+void SessionAdmin::resume(Session *session) {
+    std::coroutine_handle<> handle = session->waiting;
+    session->waiting = std::coroutine_handle<>();
+
+    session->running = true;
+    handle.resume();
+    session->running = false;
+
+    // The coroutine returned; the session state goes with it.
+    if (session->finished) {
+        Logger::log(__FILENAME__, __FUNCTION__, "Session finished: Socket=" + std::to_string(session->socket));
+        delete session;
+    }
+}
+
+void SessionAdmin::deliver(int socket, std::string_view frame) {
+    auto it = sessions.find(socket);
+    if (it == sessions.end()) {
+        Logger::log(__FILENAME__, __FUNCTION__, "Error: No session for socket " + std::to_string(socket));
+        return;
+    }
+
+    // Queue the frame and wake the coroutine if it is parked on a read.
+    Session *session = it->second;
+    session->inbox.emplace_back(frame);
+    if (!session->running && session->waiting) {
+        resume(session);
+    }
+}
+
+void SessionAdmin::close(int socket) {
+    auto it = sessions.find(socket);
+    if (it == sessions.end()) {
+        return;
+    }
+
+    // Detach the session from the socket number and let the coroutine run to its end.
+    Session *session = it->second;
+    sessions.erase(it);
+    session->closed = true;
+    if (!session->running && session->waiting) {
+        resume(session);
+    }
+}
+
+int SessionAdmin::next_timer_timeout() {
+    if (timers.empty()) {
+        return -1;
+    }
+
+    // Round up so the loop never wakes just before the deadline.
+    auto remaining = timers.begin()->first - Clock::now();
+    auto milliseconds = std::chrono::ceil<std::chrono::milliseconds>(remaining).count();
+    return milliseconds > 0 ? static_cast<int>(milliseconds) : 0;
+}
+
+bool SessionAdmin::next_timer_deadline(std::chrono::steady_clock::time_point &deadline) {
+    if (timers.empty()) {
+        return false;
+    }
+    deadline = timers.begin()->first;
+    return true;
+}
+
+void SessionAdmin::run_due_timers() {
+    // Resume every coroutine whose deadline has passed; new timers wait for the next round.
+    auto now = Clock::now();
+    std::vector<std::coroutine_handle<> > due;
+    while (!timers.empty() && timers.begin()->first <= now) {
+        due.push_back(timers.begin()->second);
+        timers.erase(timers.begin());
+    }
+    for (std::coroutine_handle<> handle : due) {
+        handle.resume();
+    }
+}
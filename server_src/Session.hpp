@@ -0,0 +1,130 @@
+#ifndef Session_hpp
+#define Session_hpp
+
+#include <stddef.h>
+#include <chrono>
+#include <coroutine>
+#include <deque>
+#include <exception>
+#include <map>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "Clock.hpp"
+#include "Logger.hpp"
+
+// Fixed-size block pool for coroutine frames. Frames are rounded up to a size class and
+// recycled through per-class free lists, so starting a session costs no malloc once warm.
+class FramePool
+{
+public:
+    static const size_t CLASS_SIZE = 64;
+    static const size_t CLASS_COUNT = 32;
+
+    static void *allocate(size_t size);
+    static void release(void *block, size_t size);
+    static size_t get_live_frames() { return live_frames; };
+
+private:
+    struct FreeBlock
+    {
+        FreeBlock *next;
+    };
+
+    static FreeBlock *free_lists[CLASS_COUNT];
+    static size_t live_frames;
+};
+
+struct Session;
+
+// Return type of every session coroutine. The coroutine starts suspended and is handed to
+// SessionAdmin, which resumes it; the frame frees itself when the coroutine finishes.
+class SessionTask
+{
+public:
+    struct promise_type
+    {
+        Session *session = nullptr;
+
+        SessionTask get_return_object() { return SessionTask(std::coroutine_handle<promise_type>::from_promise(*this)); };
+        std::suspend_always initial_suspend() noexcept { return {}; };
+        std::suspend_never final_suspend() noexcept { return {}; };
+        void return_void();
+        void unhandled_exception() { std::terminate(); };
+
+        static void *operator new(size_t size) { return FramePool::allocate(size); };
+        static void operator delete(void *frame, size_t size) { FramePool::release(frame, size); };
+    };
+
+    explicit SessionTask(std::coroutine_handle<promise_type> coroutine) : handle(coroutine) {};
+    std::coroutine_handle<promise_type> get_handle() const { return handle; };
+
+private:
+    std::coroutine_handle<promise_type> handle;
+};
+
+// State of one connection's session coroutine, fed by the event loop.
+struct Session
+{
+    int socket;
+    bool closed;
+    bool running;
+    bool finished;
+    std::deque<std::string> inbox;
+    std::coroutine_handle<> waiting;
+};
+
+// co_await SessionAdmin::read_frame(): the next frame received on the session's socket,
+// or nothing once the connection has been closed.
+struct FrameAwaiter
+{
+    Session *session = nullptr;
+
+    bool await_ready() const noexcept { return false; };
+    bool await_suspend(std::coroutine_handle<SessionTask::promise_type> handle);
+    std::optional<std::string> await_resume();
+};
+
+// co_await SessionAdmin::sleep_for(seconds): resumes from the event loop once the time is up.
+struct TimerAwaiter
+{
+    std::chrono::steady_clock::time_point deadline;
+
+    bool await_ready() const noexcept { return deadline <= Clock::now(); };
+    void await_suspend(std::coroutine_handle<> handle);
+    void await_resume() const noexcept {};
+};
+
+// Drives all session coroutines from the server's event loop thread: frames and closes are
+// delivered per socket, and timers are fired between two waits of the loop.
+class SessionAdmin
+{
+public:
+    static void open(int socket, SessionTask task);
+    static void spawn(SessionTask task);
+    static void deliver(int socket, std::string_view frame);
+    static void close(int socket);
+
+    static FrameAwaiter read_frame() { return FrameAwaiter(); };
+    static TimerAwaiter sleep_for(int seconds) { return TimerAwaiter{Clock::now() + std::chrono::seconds(seconds)}; };
+    static TimerAwaiter sleep_for_milliseconds(int milliseconds) { return TimerAwaiter{Clock::now() + std::chrono::milliseconds(milliseconds)}; };
+    static TimerAwaiter sleep_until(std::chrono::steady_clock::time_point deadline) { return TimerAwaiter{deadline}; };
+
+    static int next_timer_timeout();
+    static bool next_timer_deadline(std::chrono::steady_clock::time_point &deadline);
+    static void run_due_timers();
+    static size_t get_session_count() { return sessions.size(); };
+    static bool has_session(int socket) { return sessions.count(socket) > 0; };
+
+private:
+    friend struct TimerAwaiter;
+
+    static std::map<int, Session *> sessions;
+    static std::multimap<std::chrono::steady_clock::time_point, std::coroutine_handle<> > timers;
+
+    static void resume(Session *session);
+};
+
+#endif /* Session_hpp */
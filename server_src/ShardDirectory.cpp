@@ -0,0 +1,234 @@
+#include "ShardDirectory.hpp"
+#include <cerrno>
+#include <sys/mman.h>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+int ShardDirectory::WAIT_TTL_SECONDS = 60;
+int ShardDirectory::CLAIM_POLL_MS = 50;
+
+ShardSharedState *ShardDirectory::shared = nullptr;
+int ShardDirectory::local_shard = -1;
+
+bool ShardDirectory::create(int shard_count) {
+    // Anonymous shared memory is inherited by every worker forked afterwards and comes zeroed.
+    void *memory = mmap(nullptr, sizeof(ShardSharedState), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (memory == MAP_FAILED) {
+        Logger::log(__FILENAME__, __FUNCTION__, "Error: Unable to map the shard directory");
+        return false;
+    }
+    shared = static_cast<ShardSharedState *>(memory);
+    shared->shard_count = shard_count;
+
+    pthread_mutexattr_t attributes;
+    pthread_mutexattr_init(&attributes);
+    pthread_mutexattr_setpshared(&attributes, PTHREAD_PROCESS_SHARED);
+    pthread_mutexattr_setrobust(&attributes, PTHREAD_MUTEX_ROBUST);
+    int error = pthread_mutex_init(&shared->lock, &attributes);
+    pthread_mutexattr_destroy(&attributes);
+    if (error != 0) {
+        Logger::log(__FILENAME__, __FUNCTION__, "Error: Unable to create the shard directory lock: " + std::string(strerror(error)));
+        munmap(memory, sizeof(ShardSharedState));
+        shared = nullptr;
+        return false;
+    }
+    Logger::log(__FILENAME__, __FUNCTION__, "Shard directory created: Shards=" + std::to_string(shard_count) + ", Size=" + std::to_string(sizeof(ShardSharedState)) + " bytes");
+    return true;
+}
+
+void ShardDirectory::lock() {
+    // A worker died inside a critical section. Every update is a few slot writes that leave the
+    // tables usable, so the lock is marked consistent and taken over.
+    if (pthread_mutex_lock(&shared->lock) == EOWNERDEAD) {
+        Logger::log(__FILENAME__, __FUNCTION__, "Warning: A shard died holding the directory lock, recovering it");
+        pthread_mutex_consistent(&shared->lock);
+    }
+}
+
+void ShardDirectory::unlock() {
+    pthread_mutex_unlock(&shared->lock);
+}
+
+int64_t ShardDirectory::now_ms() {
+    // The monotonic clock is the same in every process of the machine.
+    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void ShardDirectory::copy_name(char *target, const std::string &name) {
+    memset(target, 0, sizeof(ShardQueueSlot::name));
+    memcpy(target, name.data(), std::min(name.length(), sizeof(ShardQueueSlot::name) - 1));
+}
+
+uint64_t ShardDirectory::hash(const std::string &key) {
+    // FNV-1a, finished with a 64-bit mix so that similar keys spread over the whole ring.
+    uint64_t value = 14695981039346656037ULL;
+    for (unsigned char c : key) {
+        value = (value ^ c) * 1099511628211ULL;
+    }
+    value ^= value >> 33;
+    value *= 0xff51afd7ed558ccdULL;
+    value ^= value >> 33;
+    value *= 0xc4ceb9fe1a85ec53ULL;
+    value ^= value >> 33;
+    return value;
+}
+
+ShardPlacement *ShardDirectory::find_placement_slot(const std::string &name) {
+    for (int i = 0; i < PLACEMENT_SLOTS; ++i) {
+        ShardPlacement &placement = shared->placements[i];
+        if (placement.used && name == placement.name) {
+            return &placement;
+        }
+    }
+    return nullptr;
+}
+
+int ShardDirectory::find_placement(const std::string &name) {
+    if (!shared) {
+        return -1;
+    }
+    lock();
+    ShardPlacement *placement = find_placement_slot(name);
+    int shard = placement ? placement->shard : -1;
+    unlock();
+    return shard;
+}
+
+void ShardDirectory::place(const std::string &name, int shard) {
+    if (!shared) {
+        return;
+    }
+    lock();
+    ShardPlacement *placement = find_placement_slot(name);
+    for (int i = 0; !placement && i < PLACEMENT_SLOTS; ++i) {
+        if (!shared->placements[i].used) {
+            placement = &shared->placements[i];
+            placement->used = 1;
+            copy_name(placement->name, name);
+        }
+    }
+    if (placement) {
+        placement->shard = shard;
+    }
+    unlock();
+
+    if (!placement) {
+        Logger::log(__FILENAME__, __FUNCTION__, "Warning: Placement table is full, " + name + " will be routed by hash");
+    }
+}
+
+void ShardDirectory::unplace(const std::string &name, int shard) {
+    if (!shared) {
+        return;
+    }
+    // Only the shard holding the player may drop its placement.
+    lock();
+    ShardPlacement *placement = find_placement_slot(name);
+    if (placement && placement->shard == shard) {
+        memset(placement, 0, sizeof(ShardPlacement));
+    }
+    unlock();
+}
+
+void ShardDirectory::publish_waiting(const std::string &name) {
+    if (!shared) {
+        return;
+    }
+    lock();
+    ShardQueueSlot *slot = nullptr;
+    for (int i = 0; i < QUEUE_SLOTS; ++i) {
+        ShardQueueSlot &candidate = shared->queue[i];
+        if (candidate.state != FREE && candidate.shard == local_shard && name == candidate.name) {
+            slot = &candidate;
+            break;
+        }
+        if (!slot && candidate.state == FREE) {
+            slot = &candidate;
+        }
+    }
+    if (slot) {
+        slot->state = WAITING;
+        slot->shard = local_shard;
+        slot->claimer = -1;
+        slot->published_ms = now_ms();
+        copy_name(slot->name, name);
+    }
+    unlock();
+
+    if (!slot) {
+        Logger::log(__FILENAME__, __FUNCTION__, "Warning: Shared match queue is full, " + name + " waits locally only");
+    }
+}
+
+void ShardDirectory::withdraw_waiting(const std::string &name) {
+    if (!shared) {
+        return;
+    }
+    lock();
+    for (int i = 0; i < QUEUE_SLOTS; ++i) {
+        ShardQueueSlot &slot = shared->queue[i];
+        if (slot.state != FREE && slot.shard == local_shard && name == slot.name) {
+            slot.state = FREE;
+        }
+    }
+    unlock();
+}
+
+bool ShardDirectory::claim_waiting(std::string &name, int &shard) {
+    if (!shared) {
+        return false;
+    }
+
+    // Take the longest waiting player of another shard; their shard hands them over to this one.
+    lock();
+    int64_t now = now_ms();
+    ShardQueueSlot *oldest = nullptr;
+    for (int i = 0; i < QUEUE_SLOTS; ++i) {
+        ShardQueueSlot &slot = shared->queue[i];
+        if (slot.state != WAITING || slot.shard == local_shard) {
+            continue;
+        }
+        if (now - slot.published_ms > WAIT_TTL_SECONDS * 1000LL) {
+            slot.state = FREE;
+        } else if (!oldest || slot.published_ms < oldest->published_ms) {
+            oldest = &slot;
+        }
+    }
+    if (oldest) {
+        oldest->state = CLAIMED;
+        oldest->claimer = local_shard;
+        name = oldest->name;
+        shard = oldest->shard;
+    }
+    unlock();
+    return oldest != nullptr;
+}
+
+void ShardDirectory::collect_claimed(std::vector<std::string> &names, std::vector<int> &targets) {
+    names.clear();
+    targets.clear();
+    if (!shared) {
+        return;
+    }
+    lock();
+    for (int i = 0; i < QUEUE_SLOTS; ++i) {
+        ShardQueueSlot &slot = shared->queue[i];
+        if (slot.state == CLAIMED && slot.shard == local_shard) {
+            names.push_back(slot.name);
+            targets.push_back(slot.claimer);
+            slot.state = FREE;
+        }
+    }
+    unlock();
+}
+
+uint64_t ShardDirectory::count_migration() {
+    if (!shared) {
+        return 0;
+    }
+    lock();
+    uint64_t migrations = ++shared->migrations;
+    unlock();
+    return migrations;
+}
@@ -0,0 +1,89 @@
+#ifndef ShardDirectory_hpp
+#define ShardDirectory_hpp
+
+#include <stdint.h>
+#include <pthread.h>
+#include <string>
+#include <vector>
+
+#include "Logger.hpp"
+
+// One waiting player published for matchmaking across shards.
+struct ShardQueueSlot
+{
+    uint32_t state;
+    int32_t shard;
+    int32_t claimer;
+    int32_t reserved;
+    int64_t published_ms;
+    char name[16];
+};
+
+// A player whose game lives on another shard than the one their name hashes to.
+struct ShardPlacement
+{
+    uint32_t used;
+    int32_t shard;
+    char name[16];
+};
+
+// State shared by the router and its workers in one anonymous shared mapping made before the
+// workers are forked. It is small and touched only on searches, logins and migrations, so a single
+// process-shared mutex guards all of it. The mutex is robust: a worker that dies holding it hands
+// it to the next locker instead of stopping every other process.
+struct ShardSharedState
+{
+    pthread_mutex_t lock;
+    uint32_t shard_count;
+    uint64_t migrations;
+    ShardQueueSlot queue[1024];
+    ShardPlacement placements[4096];
+};
+
+// Cross-process parts of a sharded deployment: the matchmaking queue through which a waiting player
+// is claimed by another shard, and the placements the router checks before hashing a name.
+class ShardDirectory
+{
+public:
+    static const int QUEUE_SLOTS = 1024;
+    static const int PLACEMENT_SLOTS = 4096;
+    static int WAIT_TTL_SECONDS;
+    static int CLAIM_POLL_MS;
+
+    static bool create(int shard_count);
+    static bool is_enabled() { return shared != nullptr; };
+    static void set_local_shard(int shard) { local_shard = shard; };
+    static int get_local_shard() { return local_shard; };
+    static int get_shard_count() { return shared ? static_cast<int>(shared->shard_count) : 1; };
+
+    static int find_placement(const std::string &name);
+    static void place(const std::string &name, int shard);
+    static void unplace(const std::string &name, int shard);
+
+    static void publish_waiting(const std::string &name);
+    static void withdraw_waiting(const std::string &name);
+    static bool claim_waiting(std::string &name, int &shard);
+    static void collect_claimed(std::vector<std::string> &names, std::vector<int> &targets);
+    static uint64_t count_migration();
+
+    static uint64_t hash(const std::string &key);
+
+private:
+    enum SlotState
+    {
+        FREE = 0,
+        WAITING = 1,
+        CLAIMED = 2
+    };
+
+    static ShardSharedState *shared;
+    static int local_shard;
+
+    static void lock();
+    static void unlock();
+    static int64_t now_ms();
+    static void copy_name(char *target, const std::string &name);
+    static ShardPlacement *find_placement_slot(const std::string &name);
+};
+
+#endif /* ShardDirectory_hpp */
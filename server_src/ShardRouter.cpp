@@ -0,0 +1,267 @@
+#include "ShardRouter.hpp"
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+
+int ShardRouter::HANDSHAKE_TIMEOUT_MS = 5000;
+size_t ShardRouter::MAX_HANDSHAKE_BYTES = 512;
+
+std::vector<int> ShardRouter::channels;
+std::vector<pid_t> ShardRouter::workers;
+std::vector<std::pair<uint64_t, int> > ShardRouter::ring;
+std::map<int, ShardRouter::Handshake> ShardRouter::handshakes;
+
+int ShardRouter::spawn_workers(int shard_count, int listen_fd, int &channel) {
+    if (!ShardDirectory::create(shard_count)) {
+        return -2;
+    }
+
+    for (int shard = 0; shard < shard_count; ++shard) {
+        int pair[2];
+        pid_t pid = -1;
+        if (socketpair(AF_UNIX, SOCK_SEQPACKET, 0, pair) == 0) {
+            pid = fork();
+        }
+
+        if (pid == 0) {
+            // The worker keeps only its own end of its own channel.
+            close(listen_fd);
+            close(pair[0]);
+            for (int other : channels) {
+                close(other);
+            }
+            channels.clear();
+            workers.clear();
+            ShardDirectory::set_local_shard(shard);
+            channel = pair[1];
+            Logger::log(__FILENAME__, __FUNCTION__, "Worker started: Shard=" + std::to_string(shard) + ", PID=" + std::to_string(getpid()));
+            return shard;
+        }
+
+        if (pid < 0) {
+            // Without every shard the ring would not match the configuration; stop the ones already running.
+            Logger::log(__FILENAME__, __FUNCTION__, "Error: Unable to start worker " + std::to_string(shard));
+            for (pid_t worker : workers) {
+                kill(worker, SIGTERM);
+            }
+            return -2;
+        }
+
+        close(pair[1]);
+        channels.push_back(pair[0]);
+        workers.push_back(pid);
+    }
+
+    build_ring();
+    return -1;
+}
+
+void ShardRouter::build_ring() {
+    // Every live shard owns VIRTUAL_NODES points; a dead shard's names move to its ring neighbours only.
+    ring.clear();
+    for (size_t shard = 0; shard < channels.size(); ++shard) {
+        if (channels[shard] < 0) {
+            continue;
+        }
+        for (int node = 0; node < VIRTUAL_NODES; ++node) {
+            ring.emplace_back(ShardDirectory::hash("shard-" + std::to_string(shard) + "#" + std::to_string(node)), shard);
+        }
+    }
+    std::sort(ring.begin(), ring.end());
+}
+
+int ShardRouter::ring_shard(const std::string &key) {
+    // The last worker may be gone before run() notices the empty ring.
+    if (ring.empty()) {
+        return -1;
+    }
+    auto point = std::lower_bound(ring.begin(), ring.end(), std::make_pair(ShardDirectory::hash(key), 0));
+    return (point == ring.end()) ? ring.front().second : point->second;
+}
+
+int ShardRouter::pick_shard(const std::string &name) {
+    // A player moved by matchmaking stays with the shard that holds their game.
+    int shard = ShardDirectory::find_placement(name);
+    if (shard >= 0 && shard < static_cast<int>(channels.size()) && channels[shard] >= 0) {
+        return shard;
+    }
+    return ring_shard(name);
+}
+
+int ShardRouter::run(int listen_fd) {
+    Logger::log(__FILENAME__, __FUNCTION__, "Routing connections to " + std::to_string(channels.size()) + " shards");
+    fcntl(listen_fd, F_SETFL, fcntl(listen_fd, F_GETFL) | O_NONBLOCK);
+
+    std::vector<pollfd> descriptors;
+    while (!ring.empty()) {
+        descriptors.clear();
+        descriptors.push_back(pollfd{listen_fd, POLLIN, 0});
+        for (int channel : channels) {
+            descriptors.push_back(pollfd{channel, POLLIN, 0});
+        }
+        for (const auto &[client_fd, handshake] : handshakes) {
+            descriptors.push_back(pollfd{client_fd, POLLIN, 0});
+        }
+
+        // Wake up in time for the handshake deadlines.
+        if (poll(descriptors.data(), descriptors.size(), 100) < 0 && errno != EINTR) {
+            Logger::log(__FILENAME__, __FUNCTION__, "Error: poll failed");
+            return EXIT_FAILURE;
+        }
+
+        if (descriptors[0].revents & POLLIN) {
+            accept_clients(listen_fd);
+        }
+
+        // Every worker reloads its own configuration.
+        if (Config::take_reload_request()) {
+            Logger::log(__FILENAME__, __FUNCTION__, "Forwarding configuration reload to " + std::to_string(workers.size()) + " shards");
+            for (pid_t worker : workers) {
+                kill(worker, SIGHUP);
+            }
+        }
+        for (size_t shard = 0; shard < channels.size(); ++shard) {
+            if (descriptors[shard + 1].revents) {
+                receive_from_worker(shard);
+            }
+        }
+        for (size_t i = channels.size() + 1; i < descriptors.size(); ++i) {
+            if (descriptors[i].revents) {
+                read_handshake(descriptors[i].fd);
+            }
+        }
+
+        // Clients that never name themselves are spread by address.
+        auto now = std::chrono::steady_clock::now();
+        for (auto it = handshakes.begin(); it != handshakes.end();) {
+            int client_fd = it->first;
+            Handshake handshake = (it++)->second;
+            if (handshake.deadline <= now) {
+                handshakes.erase(client_fd);
+                forward(client_fd, ring_shard(handshake.address), CONNECTION, handshake.data);
+            }
+        }
+    }
+
+    Logger::log(__FILENAME__, __FUNCTION__, "Error: No shards left, the router stops");
+    return EXIT_FAILURE;
+}
+
+void ShardRouter::accept_clients(int listen_fd) {
+    while (true) {
+        sockaddr_in address;
+        socklen_t length = sizeof(address);
+        int client_fd = accept(listen_fd, reinterpret_cast<sockaddr *>(&address), &length);
+        if (client_fd < 0) {
+            return;
+        }
+        fcntl(client_fd, F_SETFL, fcntl(client_fd, F_GETFL) | O_NONBLOCK);
+        handshakes[client_fd] = Handshake{inet_ntoa(address.sin_addr), "", std::chrono::steady_clock::now() + std::chrono::milliseconds(HANDSHAKE_TIMEOUT_MS)};
+    }
+}
+
+void ShardRouter::read_handshake(int client_fd) {
+    Handshake &handshake = handshakes[client_fd];
+    char buffer[512];
+    ssize_t length = recv(client_fd, buffer, sizeof(buffer), 0);
+    if (length < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) {
+        return;
+    }
+    if (length <= 0) {
+        // Gone before naming itself; no worker ever heard of it.
+        handshakes.erase(client_fd);
+        close(client_fd);
+        return;
+    }
+    handshake.data.append(buffer, length);
+
+    // Everything read so far goes along, so the worker parses the handshake itself.
+    std::string name;
+    if (find_name(handshake.data, name)) {
+        std::string data = handshake.data;
+        handshakes.erase(client_fd);
+        forward(client_fd, pick_shard(name), CONNECTION, data);
+    } else if (handshake.data.length() >= MAX_HANDSHAKE_BYTES) {
+        Handshake unnamed = handshake;
+        handshakes.erase(client_fd);
+        forward(client_fd, ring_shard(unnamed.address), CONNECTION, unnamed.data);
+    }
+}
+
+bool ShardRouter::find_name(const std::string &data, std::string &name) {
+    // Looks for a complete "NAME;<name>;...|" message among the messages read so far.
+    size_t start = 0;
+    size_t end;
+    while ((end = data.find('|', start)) != std::string::npos) {
+        if (data.compare(start, 5, "NAME;") == 0) {
+            size_t separator = data.find(';', start + 5);
+            name = data.substr(start + 5, std::min(separator, end) - start - 5);
+            return true;
+        }
+        start = end + 1;
+    }
+    return false;
+}
+
+void ShardRouter::forward(int client_fd, int shard, MessageKind kind, const std::string &data) {
+    if (shard < 0) {
+        Logger::log(__FILENAME__, __FUNCTION__, "Error: No shard left for the connection");
+        close(client_fd);
+        return;
+    }
+
+    // The worker reads and writes the socket blocking, like the ones it accepts itself.
+    fcntl(client_fd, F_SETFL, fcntl(client_fd, F_GETFL) & ~O_NONBLOCK);
+
+    HandoffBuffer message;
+    message.put_int(kind);
+    message.put_string(data);
+    if (!HotRestart::send_message(channels[shard], message.get_data(), &client_fd, 1)) {
+        Logger::log(__FILENAME__, __FUNCTION__, "Error: Unable to pass a connection to shard " + std::to_string(shard));
+    }
+    close(client_fd);
+}
+
+void ShardRouter::receive_from_worker(int shard) {
+    std::string payload;
+    std::vector<int> fds;
+    if (!HotRestart::receive_message(channels[shard], payload, fds)) {
+        drop_worker(shard);
+        return;
+    }
+
+    HandoffBuffer message(payload);
+    int32_t kind = 0;
+    int32_t target = -1;
+    std::string name;
+    if (fds.size() != 1 || !message.get_int(kind) || kind != MIGRATE || !message.get_int(target) || !message.get_string(name)) {
+        Logger::log(__FILENAME__, __FUNCTION__, "Error: Malformed message from shard " + std::to_string(shard));
+        for (int fd : fds) {
+            close(fd);
+        }
+        return;
+    }
+
+    // A claiming shard that died in the meantime loses the player to the ring.
+    if (target < 0 || target >= static_cast<int>(channels.size()) || channels[target] < 0) {
+        target = ring_shard(name);
+    }
+    ShardDirectory::place(name, target);
+    Logger::log(__FILENAME__, __FUNCTION__, "Migrating player " + name + " from shard " + std::to_string(shard) + " to shard " + std::to_string(target) +
+                ", Migrations=" + std::to_string(ShardDirectory::count_migration()));
+    forward(fds[0], target, MIGRATED, name);
+}
+
+void ShardRouter::drop_worker(int shard) {
+    Logger::log(__FILENAME__, __FUNCTION__, "Shard " + std::to_string(shard) + " is gone, its names move to the remaining shards");
+    close(channels[shard]);
+    channels[shard] = -1;
+    waitpid(workers[shard], nullptr, WNOHANG);
+    build_ring();
+}
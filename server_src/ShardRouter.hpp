@@ -0,0 +1,62 @@
+#ifndef ShardRouter_hpp
+#define ShardRouter_hpp
+
+#include <stdint.h>
+#include <sys/types.h>
+#include <chrono>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "HotRestart.hpp"
+#include "ShardDirectory.hpp"
+#include "Config.hpp"
+#include "Logger.hpp"
+
+// Front process of a sharded deployment. It accepts every connection, reads only up to the NAME
+// handshake and passes the socket (SCM_RIGHTS) to one of the forked worker servers, picked by a
+// consistent hash ring over the player name, so a reconnecting player lands on the shard holding
+// their game. Workers use the same channel to move a player to the shard that matched them.
+class ShardRouter
+{
+public:
+    enum MessageKind
+    {
+        CONNECTION = 1, // router -> worker: a new client and the bytes read so far
+        MIGRATE = 2,    // worker -> router: move this client to another shard
+        MIGRATED = 3    // router -> worker: a client moved here, named in the message
+    };
+
+    static const int MAX_SHARDS = 64;
+    static const int VIRTUAL_NODES = 64;
+    static int HANDSHAKE_TIMEOUT_MS;
+    static size_t MAX_HANDSHAKE_BYTES;
+
+    static int spawn_workers(int shard_count, int listen_fd, int &channel);
+    static int run(int listen_fd);
+
+private:
+    struct Handshake
+    {
+        std::string address;
+        std::string data;
+        std::chrono::steady_clock::time_point deadline;
+    };
+
+    static std::vector<int> channels;
+    static std::vector<pid_t> workers;
+    static std::vector<std::pair<uint64_t, int> > ring;
+    static std::map<int, Handshake> handshakes;
+
+    static void build_ring();
+    static int ring_shard(const std::string &key);
+    static int pick_shard(const std::string &name);
+    static void accept_clients(int listen_fd);
+    static void read_handshake(int client_fd);
+    static bool find_name(const std::string &data, std::string &name);
+    static void forward(int client_fd, int shard, MessageKind kind, const std::string &data);
+    static void receive_from_worker(int shard);
+    static void drop_worker(int shard);
+};
+
+#endif /* ShardRouter_hpp */
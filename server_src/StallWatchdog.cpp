@@ -0,0 +1,96 @@
+#include "StallWatchdog.hpp"
+#include <algorithm>
+#include <execinfo.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string>
+#include <thread>
+
+int StallWatchdog::THRESHOLD_MS = 100;
+
+bool StallWatchdog::running = false;
+pthread_t StallWatchdog::loop_thread;
+std::atomic<int64_t> StallWatchdog::iteration_started(0);
+std::atomic<uint64_t> StallWatchdog::iterations(0);
+std::atomic<int> StallWatchdog::context_socket(-1);
+std::atomic<int> StallWatchdog::context_game(-1);
+void *StallWatchdog::stack_sample[StallWatchdog::STACK_DEPTH];
+std::atomic<int> StallWatchdog::stack_depth(0);
+
+void StallWatchdog::start(int threshold_ms) {
+    THRESHOLD_MS = threshold_ms;
+    loop_thread = pthread_self();
+
+    // The first backtrace loads the unwinder, which must not happen inside the signal handler.
+    void *warm_up[1];
+    backtrace(warm_up, 1);
+
+    struct sigaction action = {};
+    action.sa_handler = capture_stack;
+    action.sa_flags = SA_RESTART;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGUSR2, &action, nullptr);
+
+    running = true;
+    std::thread(watch).detach();
+    Logger::log(__FILENAME__, __FUNCTION__, "Stall watchdog started: Threshold=" + std::to_string(THRESHOLD_MS) + " ms");
+}
+
+void StallWatchdog::end_iteration() {
+    int64_t started = iteration_started.exchange(0, std::memory_order_acq_rel);
+    iterations.fetch_add(1, std::memory_order_release);
+    if (!running || started == 0) {
+        return;
+    }
+
+    auto elapsed = std::chrono::steady_clock::duration(std::chrono::steady_clock::now().time_since_epoch().count() - started);
+    auto elapsed_ms = std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count();
+    if (elapsed_ms >= THRESHOLD_MS) {
+        Logger::log(__FILENAME__, __FUNCTION__, "Event loop iteration took " + std::to_string(elapsed_ms) + " ms: Socket=" +
+                    std::to_string(context_socket.load(std::memory_order_relaxed)) + ", Game=" + std::to_string(context_game.load(std::memory_order_relaxed)));
+    }
+}
+
+void StallWatchdog::capture_stack(int) {
+    // Runs on the loop thread; backtrace only walks the stack once the unwinder is loaded.
+    stack_depth.store(backtrace(stack_sample, STACK_DEPTH), std::memory_order_release);
+}
+
+void StallWatchdog::watch() {
+    uint64_t reported = UINT64_MAX;
+    auto poll = std::chrono::milliseconds(std::max(1, THRESHOLD_MS / 4));
+
+    while (true) {
+        std::this_thread::sleep_for(poll);
+
+        // Sample each stalled iteration once.
+        int64_t started = iteration_started.load(std::memory_order_acquire);
+        uint64_t iteration = iterations.load(std::memory_order_acquire);
+        if (started == 0 || iteration == reported) {
+            continue;
+        }
+        auto elapsed = std::chrono::steady_clock::duration(std::chrono::steady_clock::now().time_since_epoch().count() - started);
+        if (elapsed < std::chrono::milliseconds(THRESHOLD_MS)) {
+            continue;
+        }
+        reported = iteration;
+
+        stack_depth.store(0, std::memory_order_relaxed);
+        pthread_kill(loop_thread, SIGUSR2);
+        for (int wait = 0; wait < 100 && stack_depth.load(std::memory_order_acquire) == 0; ++wait) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+
+        int depth = stack_depth.load(std::memory_order_acquire);
+        Logger::log(__FILENAME__, __FUNCTION__, "Event loop stalled for " + std::to_string(std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count()) +
+                    " ms: Socket=" + std::to_string(context_socket.load(std::memory_order_relaxed)) + ", Game=" + std::to_string(context_game.load(std::memory_order_relaxed)) +
+                    ", Frames=" + std::to_string(depth));
+
+        // Static functions appear as binary+offset; addr2line -f -C -e ./server resolves those.
+        char **symbols = (depth > 0) ? backtrace_symbols(stack_sample, depth) : nullptr;
+        for (int frame = 2; symbols && frame < depth; ++frame) {
+            Logger::log(__FILENAME__, __FUNCTION__, "  #" + std::to_string(frame - 2) + " " + symbols[frame]);
+        }
+        free(symbols);
+    }
+}
@@ -0,0 +1,49 @@
+#ifndef StallWatchdog_hpp
+#define StallWatchdog_hpp
+
+#include <stdint.h>
+#include <atomic>
+#include <chrono>
+#include <pthread.h>
+
+#include "Logger.hpp"
+
+// Detects event loop iterations that run longer than a threshold. The loop stamps the start and
+// end of every iteration; a background thread notices an iteration that is still running past
+// the threshold and samples the loop thread's stack with a signal, so the blocking call shows up
+// while it blocks. The loop logs the full length of every slow iteration once it is over, with
+// the connection and game it was serving.
+class StallWatchdog
+{
+public:
+    static const int STACK_DEPTH = 48;
+    static int THRESHOLD_MS;
+
+    static void start(int threshold_ms);
+
+    static void begin_iteration() {
+        context_socket.store(-1, std::memory_order_relaxed);
+        context_game.store(-1, std::memory_order_relaxed);
+        iteration_started.store(std::chrono::steady_clock::now().time_since_epoch().count(), std::memory_order_release);
+    };
+    static void end_iteration();
+    static void set_context(int socket, int game_id) {
+        context_socket.store(socket, std::memory_order_relaxed);
+        context_game.store(game_id, std::memory_order_relaxed);
+    };
+
+private:
+    static bool running;
+    static pthread_t loop_thread;
+    static std::atomic<int64_t> iteration_started;
+    static std::atomic<uint64_t> iterations;
+    static std::atomic<int> context_socket;
+    static std::atomic<int> context_game;
+    static void *stack_sample[STACK_DEPTH];
+    static std::atomic<int> stack_depth;
+
+    static void watch();
+    static void capture_stack(int signal_number);
+};
+
+#endif /* StallWatchdog_hpp */
@@ -0,0 +1,98 @@
+#include "Telemetry.hpp"
+#include "GameAdmin.hpp"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cstring>
+#include <ctime>
+
+int Telemetry::PUBLISH_INTERVAL_MS = 200;
+
+TelemetrySegment *Telemetry::segment = nullptr;
+TelemetrySnapshot Telemetry::local = {};
+
+bool Telemetry::open(const std::string &name, int port, int shard) {
+    int fd = shm_open(name.c_str(), O_CREAT | O_RDWR, 0644);
+    if (fd < 0 || ftruncate(fd, sizeof(TelemetrySegment)) < 0) {
+        Logger::log(__FILENAME__, __FUNCTION__, "Error: Unable to create the telemetry segment " + name);
+        if (fd >= 0) {
+            close(fd);
+        }
+        return false;
+    }
+    void *memory = mmap(nullptr, sizeof(TelemetrySegment), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (memory == MAP_FAILED) {
+        Logger::log(__FILENAME__, __FUNCTION__, "Error: Unable to map the telemetry segment " + name);
+        return false;
+    }
+    segment = static_cast<TelemetrySegment *>(memory);
+
+    // A segment left by a predecessor keeps its sequence, so readers mapping it carry on.
+    if (memcmp(segment->magic, MAGIC, sizeof(MAGIC)) != 0 || segment->version != VERSION) {
+        memset(memory, 0, sizeof(TelemetrySegment));
+    }
+    uint64_t sequence = segment->sequence.load(std::memory_order_relaxed);
+    segment->sequence.store(sequence + (sequence & 1), std::memory_order_relaxed);
+
+    memcpy(segment->magic, MAGIC, sizeof(MAGIC));
+    segment->version = VERSION;
+    segment->size = sizeof(TelemetrySegment);
+    segment->pid = getpid();
+    segment->port = port;
+    segment->shard = shard;
+    segment->publish_interval_ms = PUBLISH_INTERVAL_MS;
+    segment->started_at = time(nullptr);
+    Logger::log(__FILENAME__, __FUNCTION__, "Telemetry published in " + name + ", Size=" + std::to_string(sizeof(TelemetrySegment)) + " bytes");
+    return true;
+}
+
+void Telemetry::start() {
+    if (segment) {
+        SessionAdmin::spawn(run());
+    }
+}
+
+SessionTask Telemetry::run() {
+    while (true) {
+        publish();
+        co_await SessionAdmin::sleep_for_milliseconds(PUBLISH_INTERVAL_MS);
+    }
+}
+
+void Telemetry::record_message(Opcode opcode, std::chrono::steady_clock::duration latency) {
+    // Bucket k holds latencies below 2^k microseconds, bucket 0 those below one.
+    uint64_t micros = std::chrono::duration_cast<std::chrono::microseconds>(latency).count();
+    int bucket = std::min(static_cast<int>(std::bit_width(micros)), TelemetrySnapshot::LATENCY_BUCKETS - 1);
+    local.messages[opcode]++;
+    local.latency[bucket]++;
+}
+
+void Telemetry::publish() {
+    // The gauges are read only here, once per interval.
+    local.published_us = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    local.publish_count++;
+    local.connections = SessionAdmin::get_session_count();
+    local.players = Player::get_live_count();
+    local.games = GameAdmin::get_active_games().size();
+    local.queue_length = GameAdmin::get_queue_length();
+    local.admission_length = GameAdmin::get_admission_length();
+    std::fill(local.players_by_state, local.players_by_state + TelemetrySnapshot::STATE_COUNT, 0);
+    local.players_by_state[0] = GameAdmin::unlogged_players.size();
+    for (const auto &[name, player] : GameAdmin::logged_players) {
+        const std::string &state = player->get_state();
+        for (int index = 1; index < TelemetrySnapshot::STATE_COUNT; ++index) {
+            if (state == state_name(index)) {
+                local.players_by_state[index]++;
+                break;
+            }
+        }
+    }
+
+    uint64_t sequence = segment->sequence.load(std::memory_order_relaxed);
+    segment->sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    memcpy(&segment->snapshot, &local, sizeof(local));
+    segment->sequence.store(sequence + 2, std::memory_order_release);
+}
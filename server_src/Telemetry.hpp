@@ -0,0 +1,99 @@
+#ifndef Telemetry_hpp
+#define Telemetry_hpp
+
+#include <stdint.h>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <string>
+
+#include "Session.hpp"
+#include "Logger.hpp"
+
+// Counters and gauges of one server process as published to the shared segment.
+struct TelemetrySnapshot
+{
+    static const int STATE_COUNT = 5;
+    static const int OPCODE_COUNT = 17;
+    static const int LATENCY_BUCKETS = 24;
+
+    uint64_t published_us;
+    uint64_t publish_count;
+    uint32_t connections;
+    uint32_t players;
+    uint32_t games;
+    uint32_t queue_length;
+    uint32_t players_by_state[STATE_COUNT];
+    uint32_t admission_length;
+    uint64_t messages[OPCODE_COUNT];
+    uint64_t latency[LATENCY_BUCKETS];
+};
+
+// Layout of the POSIX shared memory segment. The header is written once at startup; the snapshot
+// is guarded by a seqlock: the writer makes the sequence odd, copies the snapshot and makes it even
+// again, and readers retry whenever the sequence was odd or changed while they copied.
+struct TelemetrySegment
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t size;
+    int32_t pid;
+    int32_t port;
+    int32_t shard;
+    uint32_t publish_interval_ms;
+    int64_t started_at;
+    alignas(64) std::atomic<uint64_t> sequence;
+    TelemetrySnapshot snapshot;
+};
+
+// Live server statistics for external tools. The event loop counts into a private snapshot and
+// copies it to the shared segment a few times a second, so readers such as telemetry_top never
+// talk to the server and cannot slow it down; a reader only maps the segment and copies it.
+class Telemetry
+{
+public:
+    enum Opcode
+    {
+        NAME, WAITING_FOR_GAME, TURN, REMATCH, GAME_OVER, EXIT, REPLAY, LEADERBOARD,
+        BOOK, TOURNAMENT, LOBBY_LIST, GAMES_LIST, PING, ACK, TAKEBACK, PROFILE, OTHER
+    };
+
+    static const uint32_t VERSION = 3;
+    static const char MAGIC[8];
+    static int PUBLISH_INTERVAL_MS;
+
+    static std::string segment_name(int port, int shard);
+    static bool open(const std::string &name, int port, int shard);
+    static void start();
+
+    static Opcode opcode_of(const std::string &type);
+    static const char *opcode_name(int opcode);
+    static const char *state_name(int state);
+
+    static void count_message(Opcode opcode) { local.messages[opcode]++; };
+    static void record_message(Opcode opcode, std::chrono::steady_clock::duration latency);
+
+    static const TelemetrySegment *map(const std::string &name);
+    static bool read(const TelemetrySegment *segment, TelemetrySnapshot &snapshot);
+
+private:
+    static TelemetrySegment *segment;
+    static TelemetrySnapshot local;
+
+    static void publish();
+    static SessionTask run();
+};
+
+// Times the dispatch of one message and records it when the scope ends.
+class TelemetryTimer
+{
+public:
+    explicit TelemetryTimer(const std::string &type) : opcode(Telemetry::opcode_of(type)), started(std::chrono::steady_clock::now()) {};
+    ~TelemetryTimer() { Telemetry::record_message(opcode, std::chrono::steady_clock::now() - started); };
+
+private:
+    Telemetry::Opcode opcode;
+    std::chrono::steady_clock::time_point started;
+};
+
+#endif /* Telemetry_hpp */
@@ -0,0 +1,70 @@
+#include "Telemetry.hpp"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <cstring>
+
+// The layout side of Telemetry: segment names, opcode and state names, and mapping and copying a
+// published segment. It uses nothing of the server, so readers such as telemetry_top link only this.
+
+const char Telemetry::MAGIC[8] = {'U', 'P', 'S', 'T', 'E', 'L', 'E', 'M'};
+static const char *OPCODE_NAMES[TelemetrySnapshot::OPCODE_COUNT] = {
+    "NAME", "WAITING_FOR_GAME", "TURN", "REMATCH", "GAME_OVER", "EXIT", "REPLAY", "LEADERBOARD",
+    "BOOK", "TOURNAMENT", "LOBBY_LIST", "GAMES_LIST", "PING", "ACK", "TAKEBACK", "PROFILE", "OTHER"};
+static const char *STATE_NAMES[TelemetrySnapshot::STATE_COUNT] = {"NEW", "LOBBY", "WAITING", "IN_GAME", "RESULT"};
+
+std::string Telemetry::segment_name(int port, int shard) {
+    return "/ups-telemetry-" + std::to_string(port) + (shard >= 0 ? "-" + std::to_string(shard) : "");
+}
+
+Telemetry::Opcode Telemetry::opcode_of(const std::string &type) {
+    for (int opcode = 0; opcode < OTHER; ++opcode) {
+        if (type == OPCODE_NAMES[opcode]) {
+            return static_cast<Opcode>(opcode);
+        }
+    }
+    return OTHER;
+}
+
+const char *Telemetry::opcode_name(int opcode) {
+    return (opcode >= 0 && opcode < TelemetrySnapshot::OPCODE_COUNT) ? OPCODE_NAMES[opcode] : "?";
+}
+
+const char *Telemetry::state_name(int state) {
+    return (state >= 0 && state < TelemetrySnapshot::STATE_COUNT) ? STATE_NAMES[state] : "?";
+}
+
+const TelemetrySegment *Telemetry::map(const std::string &name) {
+    int fd = shm_open(name.c_str(), O_RDONLY, 0);
+    if (fd < 0) {
+        return nullptr;
+    }
+    void *memory = mmap(nullptr, sizeof(TelemetrySegment), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (memory == MAP_FAILED) {
+        return nullptr;
+    }
+
+    const TelemetrySegment *mapped = static_cast<const TelemetrySegment *>(memory);
+    if (memcmp(mapped->magic, MAGIC, sizeof(MAGIC)) != 0 || mapped->version != VERSION) {
+        munmap(memory, sizeof(TelemetrySegment));
+        return nullptr;
+    }
+    return mapped;
+}
+
+bool Telemetry::read(const TelemetrySegment *mapped, TelemetrySnapshot &snapshot) {
+    // Copy until a copy was taken between two equal, even sequence numbers.
+    for (int attempt = 0; attempt < 1000; ++attempt) {
+        uint64_t before = mapped->sequence.load(std::memory_order_acquire);
+        if (before & 1) {
+            continue;
+        }
+        memcpy(&snapshot, &mapped->snapshot, sizeof(snapshot));
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (mapped->sequence.load(std::memory_order_relaxed) == before) {
+            return true;
+        }
+    }
+    return false;
+}
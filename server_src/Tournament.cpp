@@ -0,0 +1,498 @@
+#include "Tournament.hpp"
+#include "GameAdmin.hpp"
+#include "Responder.hpp"
+#include <algorithm>
+
+int TournamentAdmin::TOURNAMENT_SIZE = 8;
+bool TournamentAdmin::COUNT_AGAINST_MAX_GAMES = true;
+TimeControl TournamentAdmin::TIME_CONTROL = {180000, 2000, 30000};
+
+int TournamentAdmin::tournament_id_counter = 1;
+std::map<int, Tournament *> TournamentAdmin::tournaments;
+std::map<int, Tournament *> TournamentAdmin::open_registrations;
+std::map<int, TournamentAdmin::Pairing> TournamentAdmin::running_games;
+std::deque<TournamentAdmin::Pairing> TournamentAdmin::pending_pairings;
+
+Tournament::Tournament(int tournament_id, Format format, int size)
+    : tournament_id(tournament_id), format(format), size(size), round(0), unresolved_pairings(0) {
+    Logger::log(__FILENAME__, __FUNCTION__, "Tournament created: ID " + std::to_string(tournament_id) + ", Format=" + format_name(format) + ", Size=" + std::to_string(size));
+}
+
+bool Tournament::parse_format(const std::string &name, Format &format) {
+    // Map the protocol name of a format to its value.
+    if (name == "ELIMINATION") {
+        format = SINGLE_ELIMINATION;
+    } else if (name == "SWISS") {
+        format = SWISS;
+    } else if (name == "ROUND_ROBIN") {
+        format = ROUND_ROBIN;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+std::string Tournament::format_name(Format format) {
+    switch (format) {
+        case SINGLE_ELIMINATION:
+            return "ELIMINATION";
+        case SWISS:
+            return "SWISS";
+        default:
+            return "ROUND_ROBIN";
+    }
+}
+
+int Tournament::add_player(Player *player) {
+    // Seed players in registration order.
+    Participant participant;
+    participant.player = player;
+    participant.name = player->get_name();
+    participant.points = 0;
+    participant.eliminated = false;
+    participant.withdrawn = false;
+    participant.had_bye = false;
+    participants.push_back(participant);
+    return static_cast<int>(participants.size()) - 1;
+}
+
+int Tournament::find_participant(const Player *player) const {
+    for (size_t i = 0; i < participants.size(); ++i) {
+        if (participants[i].player == player) {
+            return static_cast<int>(i);
+        }
+    }
+    return -1;
+}
+
+bool Tournament::is_playing(int index) const {
+    return !participants[index].withdrawn && !participants[index].eliminated;
+}
+
+void Tournament::withdraw(int index) {
+    // Withdrawn players keep their points but are never paired again.
+    participants[index].withdrawn = true;
+    participants[index].player = nullptr;
+}
+
+int Tournament::get_playing_count() const {
+    int playing = 0;
+    for (size_t i = 0; i < participants.size(); ++i) {
+        if (is_playing(static_cast<int>(i))) {
+            playing++;
+        }
+    }
+    return playing;
+}
+
+bool Tournament::is_finished() const {
+    if (!is_round_finished()) {
+        return false;
+    }
+
+    // Nothing left to play once fewer than two players remain.
+    if (get_playing_count() < 2) {
+        return true;
+    }
+
+    // Swiss plays log2(size) rounds, round robin lets everybody meet everybody once.
+    if (format == SWISS) {
+        int rounds = 0;
+        while ((1 << rounds) < static_cast<int>(participants.size())) {
+            rounds++;
+        }
+        return round >= rounds;
+    }
+    if (format == ROUND_ROBIN) {
+        int slots = static_cast<int>(participants.size()) + static_cast<int>(participants.size()) % 2;
+        return round >= slots - 1;
+    }
+    return false;
+}
+
+void Tournament::award_bye(int index) {
+    // A bye counts as a win.
+    participants[index].points += WIN_POINTS;
+    participants[index].had_bye = true;
+}
+
+std::vector<std::pair<int, int> > Tournament::next_round() {
+    // Compute the pairings of the next round from the current standings only.
+    round++;
+    std::vector<std::pair<int, int> > pairings;
+    switch (format) {
+        case SINGLE_ELIMINATION:
+            pairings = pair_elimination();
+            break;
+        case SWISS:
+            pairings = pair_swiss();
+            break;
+        case ROUND_ROBIN:
+            pairings = pair_round_robin();
+            break;
+    }
+    unresolved_pairings = static_cast<int>(pairings.size());
+
+    Logger::log(__FILENAME__, __FUNCTION__, "Tournament " + std::to_string(tournament_id) + " round " + std::to_string(round) + ": " + std::to_string(pairings.size()) + " pairings");
+    return pairings;
+}
+
+std::vector<std::pair<int, int> > Tournament::pair_elimination() {
+    // Survivors stay in seed order; the best seed gets the bye when the count is odd.
+    std::vector<int> survivors;
+    for (size_t i = 0; i < participants.size(); ++i) {
+        if (is_playing(static_cast<int>(i))) {
+            survivors.push_back(static_cast<int>(i));
+        }
+    }
+
+    std::vector<std::pair<int, int> > pairings;
+    size_t start = 0;
+    if (survivors.size() % 2 == 1) {
+        award_bye(survivors[0]);
+        start = 1;
+    }
+    for (size_t i = start; i + 1 < survivors.size(); i += 2) {
+        pairings.push_back(std::make_pair(survivors[i], survivors[i + 1]));
+    }
+    return pairings;
+}
+
+std::vector<std::pair<int, int> > Tournament::pair_swiss() {
+    // Rank players by points, keeping seed order between equal scores.
+    std::vector<int> ranking;
+    for (size_t i = 0; i < participants.size(); ++i) {
+        if (is_playing(static_cast<int>(i))) {
+            ranking.push_back(static_cast<int>(i));
+        }
+    }
+    std::stable_sort(ranking.begin(), ranking.end(), [this](int a, int b) {
+        return participants[a].points > participants[b].points;
+    });
+
+    // The lowest ranked player without a bye sits out when the count is odd.
+    if (ranking.size() % 2 == 1) {
+        std::vector<int>::iterator bye = ranking.end() - 1;
+        for (std::vector<int>::iterator it = ranking.end(); it != ranking.begin();) {
+            --it;
+            if (!participants[*it].had_bye) {
+                bye = it;
+                break;
+            }
+        }
+        award_bye(*bye);
+        ranking.erase(bye);
+    }
+
+    // Pair each player with the next one in the ranking they have not met yet.
+    std::vector<std::pair<int, int> > pairings;
+    std::vector<bool> paired(ranking.size(), false);
+    for (size_t i = 0; i < ranking.size(); ++i) {
+        if (paired[i]) {
+            continue;
+        }
+        size_t partner = ranking.size();
+        for (size_t j = i + 1; j < ranking.size(); ++j) {
+            if (!paired[j]) {
+                if (partner == ranking.size()) {
+                    partner = j;
+                }
+                if (participants[ranking[i]].opponents.count(ranking[j]) == 0) {
+                    partner = j;
+                    break;
+                }
+            }
+        }
+        if (partner < ranking.size()) {
+            paired[i] = true;
+            paired[partner] = true;
+            pairings.push_back(std::make_pair(ranking[i], ranking[partner]));
+        }
+    }
+    return pairings;
+}
+
+std::vector<std::pair<int, int> > Tournament::pair_round_robin() {
+    // Circle method: the first seat is fixed and the others rotate by one every round.
+    int count = static_cast<int>(participants.size());
+    int seats = count + count % 2;
+    int rotation = round - 1;
+
+    std::vector<std::pair<int, int> > pairings;
+    for (int i = 0; i < seats / 2; ++i) {
+        int first = (i == 0) ? 0 : ((i - 1 + rotation) % (seats - 1)) + 1;
+        int second = ((seats - 2 - i + rotation) % (seats - 1)) + 1;
+
+        // An empty seat or a withdrawn opponent is a bye for the other player.
+        bool first_plays = first < count && is_playing(first);
+        bool second_plays = second < count && is_playing(second);
+        if (first_plays && second_plays) {
+            pairings.push_back(std::make_pair(first, second));
+        } else if (first_plays) {
+            award_bye(first);
+        } else if (second_plays) {
+            award_bye(second);
+        }
+    }
+    return pairings;
+}
+
+void Tournament::record_result(int first, int second, int winner) {
+    participants[first].opponents.insert(second);
+    participants[second].opponents.insert(first);
+
+    // A tie cannot eliminate anybody, so the better seed advances in a bracket.
+    if (winner < 0 && format == SINGLE_ELIMINATION) {
+        winner = std::min(first, second);
+    }
+
+    if (winner < 0) {
+        participants[first].points += TIE_POINTS;
+        participants[second].points += TIE_POINTS;
+    } else {
+        participants[winner].points += WIN_POINTS;
+        if (format == SINGLE_ELIMINATION) {
+            participants[winner == first ? second : first].eliminated = true;
+        }
+    }
+    unresolved_pairings--;
+}
+
+std::vector<int> Tournament::get_standings() const {
+    // Bracket survivors first, then by points, then by seed.
+    std::vector<int> standings;
+    for (size_t i = 0; i < participants.size(); ++i) {
+        standings.push_back(static_cast<int>(i));
+    }
+    std::stable_sort(standings.begin(), standings.end(), [this](int a, int b) {
+        if (participants[a].eliminated != participants[b].eliminated) {
+            return !participants[a].eliminated;
+        }
+        return participants[a].points > participants[b].points;
+    });
+    return standings;
+}
+
+Tournament *TournamentAdmin::find_tournament_of(const Player *player, int &index) {
+    // Search every registration and running tournament for the player.
+    for (std::map<int, Tournament *>::iterator it = tournaments.begin(); it != tournaments.end(); ++it) {
+        index = it->second->find_participant(player);
+        if (index >= 0) {
+            return it->second;
+        }
+    }
+    return nullptr;
+}
+
+void TournamentAdmin::register_player(Player *player, const std::string &format_name) {
+    // Log the registration attempt.
+    Logger::log(__FILENAME__, __FUNCTION__, "Player " + player->get_name() + " registering for a " + format_name + " tournament");
+
+    Tournament::Format format;
+    int index;
+    if (!Tournament::parse_format(format_name, format)) {
+        Logger::log(__FILENAME__, __FUNCTION__, "Error: Unknown tournament format " + format_name);
+        return;
+    }
+    if (find_tournament_of(player, index)) {
+        Logger::log(__FILENAME__, __FUNCTION__, "Error: Player " + player->get_name() + " is already registered in a tournament");
+        return;
+    }
+
+    // Join the open registration of the format, opening a new one if needed.
+    Tournament *tournament = open_registrations[format];
+    if (!tournament) {
+        tournament = new Tournament(tournament_id_counter++, format, TOURNAMENT_SIZE);
+        tournaments[tournament->get_id()] = tournament;
+        open_registrations[format] = tournament;
+    }
+    tournament->add_player(player);
+
+    player->set_state("WAITING");
+    Responder::update_player_state(player, "TOURNAMENT_JOINED;" + std::to_string(tournament->get_id()) + ";" + std::to_string(tournament->get_participants().size()) + ";" + std::to_string(tournament->get_size()));
+
+    // Start as soon as the field is complete.
+    if (tournament->is_full()) {
+        open_registrations.erase(format);
+        start_round(tournament);
+    }
+}
+
+void TournamentAdmin::withdraw_player(Player *player) {
+    int index;
+    Tournament *tournament = find_tournament_of(player, index);
+    if (!tournament) {
+        return;
+    }
+
+    Logger::log(__FILENAME__, __FUNCTION__, "Player " + player->get_name() + " withdraws from tournament " + std::to_string(tournament->get_id()));
+    tournament->withdraw(index);
+
+    // An empty registration is dropped; a running round may now be complete.
+    if (!tournament->is_started()) {
+        bool anyone_left = false;
+        for (size_t i = 0; i < tournament->get_participants().size(); ++i) {
+            anyone_left = anyone_left || !tournament->get_participants()[i].withdrawn;
+        }
+        if (!anyone_left) {
+            open_registrations.erase(tournament->get_format());
+            tournaments.erase(tournament->get_id());
+            delete tournament;
+        }
+    } else if (tournament->is_round_finished()) {
+        start_round(tournament);
+    }
+}
+
+void TournamentAdmin::start_round(Tournament *tournament) {
+    if (tournament->is_finished()) {
+        finish_tournament(tournament);
+        return;
+    }
+
+    // Pair the whole round at once and queue every game for bulk creation.
+    std::vector<std::pair<int, int> > pairings = tournament->next_round();
+    std::vector<bool> paired(tournament->get_participants().size(), false);
+    for (size_t i = 0; i < pairings.size(); ++i) {
+        Pairing pairing = {tournament, pairings[i].first, pairings[i].second};
+        pending_pairings.push_back(pairing);
+        paired[pairings[i].first] = true;
+        paired[pairings[i].second] = true;
+    }
+
+    // Tell every remaining player that the round started, and who sits it out.
+    for (size_t i = 0; i < paired.size(); ++i) {
+        Tournament::Participant &participant = tournament->get_participant(static_cast<int>(i));
+        if (!participant.player || participant.eliminated) {
+            continue;
+        }
+        Responder::update_player_state(participant.player, "TOURNAMENT_ROUND;" + std::to_string(tournament->get_id()) + ";" + std::to_string(tournament->get_round()));
+        if (!paired[i]) {
+            Responder::update_player_status(participant.player, "Bye in round " + std::to_string(tournament->get_round()));
+        }
+    }
+
+    // A round made only of byes finishes immediately.
+    if (pairings.empty()) {
+        start_round(tournament);
+        return;
+    }
+    launch_pending_games();
+}
+
+void TournamentAdmin::launch_pending_games() {
+    // Take as many queued pairings as the game limit allows.
+    std::vector<Pairing> batch;
+    std::vector<Pairing> forfeits;
+    std::vector<std::pair<Player *, Player *> > players;
+    int slots = COUNT_AGAINST_MAX_GAMES ? GameAdmin::available_game_slots() : static_cast<int>(pending_pairings.size());
+
+    while (!pending_pairings.empty() && static_cast<int>(batch.size()) < slots) {
+        Pairing pairing = pending_pairings.front();
+        pending_pairings.pop_front();
+
+        // Pairings with a withdrawn player are decided without a game.
+        Player *first = pairing.tournament->get_participant(pairing.first).player;
+        Player *second = pairing.tournament->get_participant(pairing.second).player;
+        if (!first || !second) {
+            forfeits.push_back(pairing);
+            continue;
+        }
+        batch.push_back(pairing);
+        players.push_back(std::make_pair(first, second));
+    }
+
+    // Create all games of the batch in one pass.
+    if (!batch.empty()) {
+        std::vector<int> game_ids = GameAdmin::initialize_games(players, TIME_CONTROL);
+        for (size_t i = 0; i < game_ids.size(); ++i) {
+            running_games[game_ids[i]] = batch[i];
+        }
+        Logger::log(__FILENAME__, __FUNCTION__, "Started " + std::to_string(game_ids.size()) + " tournament games, " + std::to_string(pending_pairings.size()) + " still queued");
+    }
+
+    // Resolve forfeits last so a following round never runs inside this batch.
+    for (size_t i = 0; i < forfeits.size(); ++i) {
+        int winner = forfeits[i].tournament->get_participant(forfeits[i].first).player ? forfeits[i].first : forfeits[i].second;
+        resolve_pairing(forfeits[i], winner);
+    }
+}
+
+bool TournamentAdmin::is_tournament_game(int game_id) {
+    return running_games.find(game_id) != running_games.end();
+}
+
+int TournamentAdmin::bypassing_game_count() {
+    // Tournament games only occupy regular slots when they count against the limit.
+    return COUNT_AGAINST_MAX_GAMES ? 0 : static_cast<int>(running_games.size());
+}
+
+void TournamentAdmin::report_result(int game_id, Player *winner) {
+    std::map<int, Pairing>::iterator it = running_games.find(game_id);
+    if (it == running_games.end()) {
+        return;
+    }
+    Pairing pairing = it->second;
+    running_games.erase(it);
+
+    // Translate the winning player into the participant index (-1 for a tie).
+    int winner_index = winner ? pairing.tournament->find_participant(winner) : -1;
+    Logger::log(__FILENAME__, __FUNCTION__, "Tournament " + std::to_string(pairing.tournament->get_id()) + " game " + std::to_string(game_id) + " won by " + (winner ? winner->get_name() : "nobody"));
+    resolve_pairing(pairing, winner_index);
+}
+
+void TournamentAdmin::resolve_pairing(const Pairing &pairing, int winner) {
+    Tournament *tournament = pairing.tournament;
+    tournament->record_result(pairing.first, pairing.second, winner);
+
+    // Eliminated players leave at once, the others wait for the rest of the round; the last result is left to finish_tournament.
+    if (!tournament->is_finished()) {
+        for (int index : {pairing.first, pairing.second}) {
+            Tournament::Participant &participant = tournament->get_participant(index);
+            if (!participant.player) {
+                continue;
+            }
+            if (participant.eliminated) {
+                release_participant(tournament, index);
+            } else {
+                participant.player->set_state("WAITING");
+                Responder::update_player_state(participant.player, "TOURNAMENT_WAITING;" + std::to_string(tournament->get_id()) + ";" + std::to_string(tournament->get_round()));
+            }
+        }
+    }
+
+    // Move on once the last game of the round is in.
+    if (tournament->is_round_finished()) {
+        start_round(tournament);
+    }
+}
+
+void TournamentAdmin::release_participant(Tournament *tournament, int index) {
+    // Everybody knocked out in the same round shares the place below the round's survivors; the champion is not known yet.
+    Tournament::Participant &participant = tournament->get_participant(index);
+    int place = tournament->get_playing_count() - tournament->get_unresolved_pairings() + 1;
+    Logger::log(__FILENAME__, __FUNCTION__, "Player " + participant.name + " was eliminated from tournament " + std::to_string(tournament->get_id()) + " in place " + std::to_string(place));
+
+    // Drop the player from the lookup so they can register again; their result stays in the standings.
+    participant.player->set_state("LOBBY");
+    Responder::update_player_state(participant.player, "TOURNAMENT_OVER;" + std::to_string(tournament->get_id()) + ";;" + std::to_string(place));
+    participant.player = nullptr;
+}
+
+void TournamentAdmin::finish_tournament(Tournament *tournament) {
+    std::vector<int> standings = tournament->get_standings();
+    const std::string &champion = tournament->get_participant(standings[0]).name;
+    Logger::log(__FILENAME__, __FUNCTION__, "Tournament " + std::to_string(tournament->get_id()) + " finished, winner: " + champion);
+
+    // Send every remaining player their final place and return them to the lobby.
+    for (size_t place = 0; place < standings.size(); ++place) {
+        Player *player = tournament->get_participant(standings[place]).player;
+        if (player) {
+            player->set_state("LOBBY");
+            Responder::update_player_state(player, "TOURNAMENT_OVER;" + std::to_string(tournament->get_id()) + ";" + champion + ";" + std::to_string(place + 1));
+        }
+    }
+
+    tournaments.erase(tournament->get_id());
+    delete tournament;
+}
@@ -0,0 +1,116 @@
+#ifndef Tournament_hpp
+#define Tournament_hpp
+
+#include <deque>
+#include <map>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "Player.hpp"
+#include "Game.hpp"
+#include "Logger.hpp"
+
+class Tournament
+{
+public:
+    enum Format
+    {
+        SINGLE_ELIMINATION,
+        SWISS,
+        ROUND_ROBIN
+    };
+
+    struct Participant
+    {
+        Player *player;
+        std::string name;
+        int points;
+        bool eliminated;
+        bool withdrawn;
+        bool had_bye;
+        std::set<int> opponents;
+    };
+
+    static const int WIN_POINTS = 2;
+    static const int TIE_POINTS = 1;
+
+    Tournament(int tournament_id, Format format, int size);
+
+    int get_id() const { return tournament_id; };
+    Format get_format() const { return format; };
+    int get_round() const { return round; };
+    int get_size() const { return size; };
+    bool is_full() const { return static_cast<int>(participants.size()) >= size; };
+    bool is_started() const { return round > 0; };
+    bool is_round_finished() const { return unresolved_pairings == 0; };
+    int get_unresolved_pairings() const { return unresolved_pairings; };
+    bool is_finished() const;
+    int get_playing_count() const;
+
+    int add_player(Player *player);
+    int find_participant(const Player *player) const;
+    Participant &get_participant(int index) { return participants[index]; };
+    const std::vector<Participant> &get_participants() const { return participants; };
+
+    std::vector<std::pair<int, int> > next_round();
+    void record_result(int first, int second, int winner);
+    void withdraw(int index);
+    std::vector<int> get_standings() const;
+
+    static bool parse_format(const std::string &name, Format &format);
+    static std::string format_name(Format format);
+
+private:
+    int tournament_id;
+    Format format;
+    int size;
+    int round;
+    int unresolved_pairings;
+    std::vector<Participant> participants;
+
+    std::vector<std::pair<int, int> > pair_elimination();
+    std::vector<std::pair<int, int> > pair_swiss();
+    std::vector<std::pair<int, int> > pair_round_robin();
+    bool is_playing(int index) const;
+    void award_bye(int index);
+};
+
+// Runs tournaments on top of GameAdmin: registration, bulk game creation per round and result collection.
+class TournamentAdmin
+{
+public:
+    static int TOURNAMENT_SIZE;
+    static bool COUNT_AGAINST_MAX_GAMES;
+    static TimeControl TIME_CONTROL;
+
+    static void register_player(Player *player, const std::string &format_name);
+    static void withdraw_player(Player *player);
+    static bool is_tournament_game(int game_id);
+    static void report_result(int game_id, Player *winner);
+    static void launch_pending_games();
+    static int bypassing_game_count();
+
+private:
+    struct Pairing
+    {
+        Tournament *tournament;
+        int first;
+        int second;
+    };
+
+    static int tournament_id_counter;
+    static std::map<int, Tournament *> tournaments;
+    static std::map<int, Tournament *> open_registrations;
+    static std::map<int, Pairing> running_games;
+    static std::deque<Pairing> pending_pairings;
+
+    static Tournament *find_tournament_of(const Player *player, int &index);
+    static void start_round(Tournament *tournament);
+    static void resolve_pairing(const Pairing &pairing, int winner);
+    static void release_participant(Tournament *tournament, int index);
+    static void finish_tournament(Tournament *tournament);
+};
+
+#endif /* Tournament_hpp */
@@ -0,0 +1,30 @@
+#ifndef Trace_hpp
+#define Trace_hpp
+
+// Static tracepoints of the hot path under the "ups" provider. They are USDT probes, so perf,
+// bpftrace and systemtap can attach to them (perf buildid-cache --add ./server, then
+// perf record -e sdt_ups:execute_turn__start); until then each one is a single nop.
+// Without <sys/sdt.h> (systemtap-sdt-dev) or with -DUPS_NO_TRACEPOINTS they compile to nothing.
+#if !defined(UPS_NO_TRACEPOINTS) && defined(__has_include)
+#if __has_include(<sys/sdt.h>)
+#include <sys/sdt.h>
+#define UPS_TRACEPOINTS 1
+#endif
+#endif
+
+#ifdef UPS_TRACEPOINTS
+#define TRACE_POINT(name) DTRACE_PROBE(ups, name)
+#define TRACE_POINT1(name, a) DTRACE_PROBE1(ups, name, a)
+#define TRACE_POINT2(name, a, b) DTRACE_PROBE2(ups, name, a, b)
+#else
+#define TRACE_POINT(name) do {} while (0)
+#define TRACE_POINT1(name, a) do { (void)sizeof(a); } while (0)
+#define TRACE_POINT2(name, a, b) do { (void)sizeof(a); (void)sizeof(b); } while (0)
+#endif
+
+// Fires name__start here and name__done whenever the enclosing scope is left.
+#define TRACE_SCOPE(name) \
+    TRACE_POINT(name##__start); \
+    struct TraceScope_##name { ~TraceScope_##name() { TRACE_POINT(name##__done); } } trace_scope_##name
+
+#endif /* Trace_hpp */
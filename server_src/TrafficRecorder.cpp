@@ -0,0 +1,189 @@
+#include "TrafficRecorder.hpp"
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static const char TRACE_MAGIC[8] = {'U', 'P', 'S', 'T', 'R', 'A', 'C', 'E'};
+
+size_t TrafficRecorder::FLUSH_BYTES = 64 * 1024;
+int TrafficRecorder::FLUSH_INTERVAL = 1;
+
+int TrafficRecorder::trace_fd = -1;
+std::string TrafficRecorder::buffer;
+Clock::time_point TrafficRecorder::started;
+uint64_t TrafficRecorder::last_time_us = 0;
+uint64_t TrafficRecorder::event_count = 0;
+
+bool TrafficRecorder::open(const std::string &path, int max_games) {
+    close();
+
+    trace_fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (trace_fd < 0) {
+        Logger::log(__FILENAME__, __FUNCTION__, "Error: Unable to create traffic trace " + path);
+        return false;
+    }
+
+    TrafficTraceHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, TRACE_MAGIC, sizeof(TRACE_MAGIC));
+    header.version = FORMAT_VERSION;
+    header.max_games = static_cast<uint32_t>(max_games);
+    header.started_at = static_cast<int64_t>(time(nullptr));
+    buffer.assign(reinterpret_cast<const char *>(&header), sizeof(header));
+    buffer.reserve(FLUSH_BYTES * 2);
+
+    started = Clock::now();
+    last_time_us = 0;
+    event_count = 0;
+    SessionAdmin::spawn(run_flusher());
+    Logger::log(__FILENAME__, __FUNCTION__, "Recording inbound traffic to " + path);
+    return true;
+}
+
+void TrafficRecorder::close() {
+    if (trace_fd < 0) {
+        return;
+    }
+    flush();
+    if (trace_fd >= 0) {
+        ::close(trace_fd);
+        trace_fd = -1;
+        Logger::log(__FILENAME__, __FUNCTION__, "Traffic trace closed: Events=" + std::to_string(event_count));
+    }
+}
+
+void TrafficRecorder::append(TrafficEvent::Kind kind, int connection, const char *data, size_t length) {
+    // Times are stored as the distance to the previous event, which mostly fits into one or two bytes.
+    uint64_t time_us = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - started).count();
+    buffer.push_back(static_cast<char>(kind));
+    append_varint(time_us - last_time_us);
+    append_varint(static_cast<uint64_t>(connection));
+    append_varint(length);
+    buffer.append(data, length);
+    last_time_us = time_us;
+    event_count++;
+
+    if (buffer.size() >= FLUSH_BYTES) {
+        flush();
+    }
+}
+
+void TrafficRecorder::append_varint(uint64_t value) {
+    while (value >= 0x80) {
+        buffer.push_back(static_cast<char>((value & 0x7f) | 0x80));
+        value >>= 7;
+    }
+    buffer.push_back(static_cast<char>(value));
+}
+
+void TrafficRecorder::flush() {
+    size_t written = 0;
+    while (trace_fd >= 0 && written < buffer.size()) {
+        ssize_t result = write(trace_fd, buffer.data() + written, buffer.size() - written);
+        if (result < 0 && errno == EINTR) {
+            continue;
+        }
+        if (result <= 0) {
+            // A trace with a gap is useless for replay, so recording stops at the first failure.
+            Logger::log(__FILENAME__, __FUNCTION__, "Error: Unable to write the traffic trace, recording stopped");
+            ::close(trace_fd);
+            trace_fd = -1;
+            break;
+        }
+        written += static_cast<size_t>(result);
+    }
+    buffer.clear();
+}
+
+SessionTask TrafficRecorder::run_flusher() {
+    // A killed server loses at most the last interval of traffic.
+    while (trace_fd >= 0) {
+        co_await SessionAdmin::sleep_for(FLUSH_INTERVAL);
+        flush();
+    }
+}
+
+TrafficTrace::TrafficTrace() : data(nullptr), data_length(0), position(0), time_us(0) {
+}
+
+TrafficTrace::~TrafficTrace() {
+    close();
+}
+
+bool TrafficTrace::open(const std::string &path) {
+    close();
+
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat file_info;
+    if (fstat(fd, &file_info) < 0 || static_cast<size_t>(file_info.st_size) < sizeof(TrafficTraceHeader)) {
+        ::close(fd);
+        return false;
+    }
+    void *mapped = mmap(nullptr, file_info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (mapped == MAP_FAILED) {
+        return false;
+    }
+    data = static_cast<const char *>(mapped);
+    data_length = static_cast<size_t>(file_info.st_size);
+    madvise(mapped, data_length, MADV_SEQUENTIAL);
+
+    if (memcmp(get_header()->magic, TRACE_MAGIC, sizeof(TRACE_MAGIC)) != 0 || get_header()->version != TrafficRecorder::FORMAT_VERSION) {
+        close();
+        return false;
+    }
+    position = sizeof(TrafficTraceHeader);
+    time_us = 0;
+    return true;
+}
+
+void TrafficTrace::close() {
+    if (data) {
+        munmap(const_cast<char *>(data), data_length);
+    }
+    data = nullptr;
+    data_length = 0;
+    position = 0;
+}
+
+bool TrafficTrace::read_varint(uint64_t &value) {
+    value = 0;
+    for (int shift = 0; shift < 64 && position < data_length; shift += 7) {
+        uint8_t byte = static_cast<uint8_t>(data[position++]);
+        value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool TrafficTrace::next(TrafficEvent &event) {
+    // A trace cut off in the middle of an event (a killed server) ends before that event.
+    size_t start = position;
+    if (!data || position >= data_length) {
+        return false;
+    }
+    uint8_t kind = static_cast<uint8_t>(data[position++]);
+    uint64_t delta, connection, length;
+    if (kind < TrafficEvent::OPEN || kind > TrafficEvent::CLOSE || !read_varint(delta) || !read_varint(connection) ||
+        !read_varint(length) || length > data_length - position) {
+        position = start;
+        return false;
+    }
+
+    time_us += delta;
+    event.kind = static_cast<TrafficEvent::Kind>(kind);
+    event.connection = static_cast<int>(connection);
+    event.time_us = time_us;
+    event.data.assign(data + position, length);
+    position += length;
+    return true;
+}
@@ -0,0 +1,94 @@
+#ifndef TrafficRecorder_hpp
+#define TrafficRecorder_hpp
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+#include <string_view>
+
+#include "Session.hpp"
+#include "Logger.hpp"
+
+// Header at the beginning of a traffic trace; the encoded events follow it directly.
+struct TrafficTraceHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t max_games;
+    int64_t started_at;
+    uint8_t reserved[16];
+};
+
+// One inbound event of a connection. Connections are identified by their socket number, which is
+// what the server keys its players and sessions by. The data is the peer address of an OPEN and
+// the received bytes of a FRAME.
+struct TrafficEvent
+{
+    enum Kind
+    {
+        OPEN = 1,
+        FRAME = 2,
+        CLOSE = 3
+    };
+
+    Kind kind;
+    int connection;
+    uint64_t time_us;
+    std::string data;
+};
+
+// Sequential reader of a recorded trace, mapped from disk.
+class TrafficTrace
+{
+private:
+    const char *data;
+    size_t data_length;
+    size_t position;
+    uint64_t time_us;
+
+    bool read_varint(uint64_t &value);
+
+public:
+    TrafficTrace();
+    ~TrafficTrace();
+
+    bool open(const std::string &path);
+    void close();
+
+    const TrafficTraceHeader *get_header() const { return reinterpret_cast<const TrafficTraceHeader *>(data); };
+    bool next(TrafficEvent &event);
+    bool is_complete() const { return position == data_length; };
+};
+
+// Records every inbound event of the server to a compact binary trace. An event is its kind, the
+// time since the previous event in microseconds, the connection and the data, all but the kind
+// as varints. Events are buffered and written in blocks, at the latest once a second.
+class TrafficRecorder
+{
+public:
+    static const uint32_t FORMAT_VERSION = 1;
+    static size_t FLUSH_BYTES;
+    static int FLUSH_INTERVAL;
+
+    static bool open(const std::string &path, int max_games);
+    static void close();
+    static bool is_recording() { return trace_fd >= 0; };
+
+    static void record_open(int connection, const std::string &peer_address) { if (trace_fd >= 0) append(TrafficEvent::OPEN, connection, peer_address.data(), peer_address.length()); };
+    static void record_frame(int connection, std::string_view frame) { if (trace_fd >= 0) append(TrafficEvent::FRAME, connection, frame.data(), frame.length()); };
+    static void record_close(int connection) { if (trace_fd >= 0) append(TrafficEvent::CLOSE, connection, nullptr, 0); };
+    static void flush();
+
+private:
+    static int trace_fd;
+    static std::string buffer;
+    static Clock::time_point started;
+    static uint64_t last_time_us;
+    static uint64_t event_count;
+
+    static void append(TrafficEvent::Kind kind, int connection, const char *data, size_t length);
+    static void append_varint(uint64_t value);
+    static SessionTask run_flusher();
+};
+
+#endif /* TrafficRecorder_hpp */
@@ -0,0 +1,445 @@
+#include "UringBackend.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+static const uint16_t BUFFER_GROUP = 1;
+
+unsigned UringBackend::BUFFER_SIZE = 1024;
+
+int UringBackend::ring_fd = -1;
+std::vector<int> UringBackend::listen_sockets;
+std::thread::id UringBackend::loop_thread;
+std::mutex UringBackend::submit_mutex;
+
+unsigned *UringBackend::sq_head;
+unsigned *UringBackend::sq_tail;
+unsigned *UringBackend::sq_mask;
+unsigned *UringBackend::sq_array;
+io_uring_sqe *UringBackend::sqes;
+unsigned *UringBackend::cq_head;
+unsigned *UringBackend::cq_tail;
+unsigned *UringBackend::cq_mask;
+io_uring_cqe *UringBackend::cqes;
+unsigned UringBackend::unsubmitted = 0;
+
+io_uring_buf *UringBackend::buffer_ring;
+char *UringBackend::buffer_memory;
+unsigned short UringBackend::buffer_tail = 0;
+
+bool UringBackend::quiescing = false;
+std::set<uint64_t> UringBackend::armed;
+std::vector<uint32_t> UringBackend::generations;
+std::vector<bool> UringBackend::single_shot;
+std::map<int, std::string> UringBackend::outgoing;
+std::map<uint64_t, std::string> UringBackend::pending_sends;
+
+// Undoes a partial setup: every mapping made so far, the buffer memory and the ring itself.
+static void release_setup(int fd, void *rings, size_t ring_size, void *sqe_memory, size_t sqe_size, void *buffer_ring, size_t buffer_ring_size, char *buffer_memory) {
+    if (rings != MAP_FAILED) {
+        munmap(rings, ring_size);
+    }
+    if (sqe_memory != MAP_FAILED) {
+        munmap(sqe_memory, sqe_size);
+    }
+    if (buffer_ring != MAP_FAILED) {
+        munmap(buffer_ring, buffer_ring_size);
+    }
+    delete[] buffer_memory;
+    close(fd);
+}
+
+bool UringBackend::initialize(int listen_fd) {
+    // Create the ring; the kernel fills in the offsets of the shared queues.
+    io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    params.flags = IORING_SETUP_CQSIZE;
+    params.cq_entries = RING_ENTRIES * 4;
+
+    int fd = static_cast<int>(syscall(__NR_io_uring_setup, RING_ENTRIES, &params));
+    if (fd < 0) {
+        Logger::log(__FILENAME__, __FUNCTION__, "io_uring is not available: " + std::string(strerror(errno)));
+        return false;
+    }
+    if (!(params.features & IORING_FEAT_SINGLE_MMAP) || !(params.features & IORING_FEAT_NODROP)) {
+        Logger::log(__FILENAME__, __FUNCTION__, "io_uring kernel support is too old");
+        release_setup(fd, MAP_FAILED, 0, MAP_FAILED, 0, MAP_FAILED, 0, nullptr);
+        return false;
+    }
+
+    // Map the submission and completion rings (one mapping) and the SQE array.
+    size_t ring_size = std::max(params.sq_off.array + params.sq_entries * sizeof(unsigned), params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe));
+    void *rings = mmap(nullptr, ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+    size_t sqe_size = params.sq_entries * sizeof(io_uring_sqe);
+    void *sqe_memory = mmap(nullptr, sqe_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+    if (rings == MAP_FAILED || sqe_memory == MAP_FAILED) {
+        Logger::log(__FILENAME__, __FUNCTION__, "Error: Unable to map io_uring queues");
+        release_setup(fd, rings, ring_size, sqe_memory, sqe_size, MAP_FAILED, 0, nullptr);
+        return false;
+    }
+
+    char *base = static_cast<char *>(rings);
+    sq_head = reinterpret_cast<unsigned *>(base + params.sq_off.head);
+    sq_tail = reinterpret_cast<unsigned *>(base + params.sq_off.tail);
+    sq_mask = reinterpret_cast<unsigned *>(base + params.sq_off.ring_mask);
+    sq_array = reinterpret_cast<unsigned *>(base + params.sq_off.array);
+    cq_head = reinterpret_cast<unsigned *>(base + params.cq_off.head);
+    cq_tail = reinterpret_cast<unsigned *>(base + params.cq_off.tail);
+    cq_mask = reinterpret_cast<unsigned *>(base + params.cq_off.ring_mask);
+    cqes = reinterpret_cast<io_uring_cqe *>(base + params.cq_off.cqes);
+    sqes = static_cast<io_uring_sqe *>(sqe_memory);
+
+    // Register the provided buffer ring that multishot receives pick their buffers from.
+    size_t buffer_ring_size = BUFFER_COUNT * sizeof(io_uring_buf);
+    buffer_ring = static_cast<io_uring_buf *>(mmap(nullptr, buffer_ring_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+    buffer_memory = new char[BUFFER_COUNT * BUFFER_SIZE];
+
+    io_uring_buf_reg registration;
+    memset(&registration, 0, sizeof(registration));
+    registration.ring_addr = reinterpret_cast<uint64_t>(buffer_ring);
+    registration.ring_entries = BUFFER_COUNT;
+    registration.bgid = BUFFER_GROUP;
+    if (buffer_ring == MAP_FAILED || syscall(__NR_io_uring_register, fd, IORING_REGISTER_PBUF_RING, &registration, 1) < 0) {
+        Logger::log(__FILENAME__, __FUNCTION__, "io_uring provided buffer rings are not supported: " + std::string(strerror(errno)));
+        release_setup(fd, rings, ring_size, sqe_memory, sqe_size, buffer_ring, buffer_ring_size, buffer_memory);
+        buffer_ring = nullptr;
+        buffer_memory = nullptr;
+        return false;
+    }
+
+    ring_fd = fd;
+    listen_sockets.push_back(listen_fd);
+    loop_thread = std::this_thread::get_id();
+    for (unsigned i = 0; i < BUFFER_COUNT; ++i) {
+        add_buffer(i);
+    }
+
+    // Keep a multishot accept armed on the listening socket from now on.
+    std::lock_guard<std::mutex> lock(submit_mutex);
+    arm_accept(listen_fd);
+    submit_locked();
+
+    Logger::log(__FILENAME__, __FUNCTION__, "io_uring backend ready: Entries=" + std::to_string(params.sq_entries) + ", Buffers=" + std::to_string(BUFFER_COUNT) + "x" + std::to_string(BUFFER_SIZE));
+    return true;
+}
+
+uint64_t UringBackend::pack(Kind kind, uint32_t generation, int fd) {
+    // user_data layout: kind (8 bits) | generation (24 bits) | fd (32 bits).
+    return (static_cast<uint64_t>(kind) << 56) | (static_cast<uint64_t>(generation & 0xFFFFFF) << 32) | static_cast<uint32_t>(fd);
+}
+
+uint32_t UringBackend::generation_of(int fd) {
+    // Generations tell completions of a closed socket apart from a new one reusing its number.
+    if (fd >= static_cast<int>(generations.size())) {
+        generations.resize(fd + 1, 0);
+        single_shot.resize(fd + 1, false);
+    }
+    return generations[fd] & 0xFFFFFF;
+}
+
+void UringBackend::add_buffer(int buffer_id) {
+    // Hand a receive buffer (back) to the kernel and publish the new ring tail.
+    io_uring_buf &entry = buffer_ring[buffer_tail & (BUFFER_COUNT - 1)];
+    entry.addr = reinterpret_cast<uint64_t>(buffer_memory + buffer_id * BUFFER_SIZE);
+    entry.len = BUFFER_SIZE;
+    entry.bid = static_cast<uint16_t>(buffer_id);
+    buffer_tail++;
+    __atomic_store_n(&buffer_ring[0].resv, buffer_tail, __ATOMIC_RELEASE);
+}
+
+io_uring_sqe *UringBackend::get_sqe() {
+    // Flush the queue first when it is full.
+    unsigned head = __atomic_load_n(sq_head, __ATOMIC_ACQUIRE);
+    unsigned tail = *sq_tail;
+    if (tail - head >= RING_ENTRIES) {
+        submit_locked();
+        head = __atomic_load_n(sq_head, __ATOMIC_ACQUIRE);
+    }
+
+    unsigned index = tail & *sq_mask;
+    io_uring_sqe *sqe = &sqes[index];
+    memset(sqe, 0, sizeof(io_uring_sqe));
+    sq_array[index] = index;
+    __atomic_store_n(sq_tail, tail + 1, __ATOMIC_RELEASE);
+    unsubmitted++;
+    return sqe;
+}
+
+int UringBackend::submit(unsigned to_submit, unsigned min_complete, unsigned flags, void *argument, size_t argument_size) {
+    return static_cast<int>(syscall(__NR_io_uring_enter, ring_fd, to_submit, min_complete, flags, argument, argument_size));
+}
+
+void UringBackend::submit_locked() {
+    // Submit everything queued so far.
+    if (unsubmitted > 0) {
+        submit(unsubmitted, 0, 0, nullptr, 0);
+        unsubmitted = 0;
+    }
+}
+
+void UringBackend::add_listener(int listen_fd) {
+    // Further listeners, such as the local socket, feed the same accept completions.
+    std::lock_guard<std::mutex> lock(submit_mutex);
+    listen_sockets.push_back(listen_fd);
+    arm_accept(listen_fd);
+    submit_locked();
+}
+
+void UringBackend::arm_accept(int listen_fd) {
+    if (quiescing) {
+        return;
+    }
+
+    io_uring_sqe *sqe = get_sqe();
+    sqe->opcode = IORING_OP_ACCEPT;
+    sqe->fd = listen_fd;
+    sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+    sqe->user_data = pack(KIND_ACCEPT, 0, listen_fd);
+    armed.insert(sqe->user_data);
+}
+
+void UringBackend::arm_recv(int fd) {
+    // One multishot receive per connection keeps delivering into provided buffers.
+    if (quiescing) {
+        return;
+    }
+    uint32_t generation = generation_of(fd);
+    io_uring_sqe *sqe = get_sqe();
+    sqe->opcode = IORING_OP_RECV;
+    sqe->fd = fd;
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = BUFFER_GROUP;
+    sqe->ioprio = single_shot[fd] ? 0 : IORING_RECV_MULTISHOT;
+    sqe->user_data = pack(KIND_RECV, generation, fd);
+    armed.insert(sqe->user_data);
+}
+
+void UringBackend::queue_send(int fd, const char *data, size_t length) {
+    std::lock_guard<std::mutex> lock(submit_mutex);
+
+    // Collect the payload behind whatever is already waiting for this socket.
+    outgoing[fd].append(data, length);
+
+    // Threads other than the loop cannot rely on the next wait, so they submit at once.
+    if (std::this_thread::get_id() != loop_thread) {
+        issue_send(fd);
+        submit_locked();
+    }
+}
+
+void UringBackend::issue_send(int fd) {
+    std::map<int, std::string>::iterator waiting = outgoing.find(fd);
+    if (waiting == outgoing.end()) {
+        return;
+    }
+
+    // Only one send per socket is in flight; the rest waits so bytes leave in order.
+    uint64_t key = pack(KIND_SEND, generation_of(fd), fd);
+    if (pending_sends.count(key)) {
+        return;
+    }
+
+    // Everything collected for the socket goes out as one send, kept alive until it completes.
+    std::string &payload = pending_sends[key];
+    payload.swap(waiting->second);
+    outgoing.erase(waiting);
+
+    io_uring_sqe *sqe = get_sqe();
+    sqe->opcode = IORING_OP_SEND;
+    sqe->fd = fd;
+    sqe->addr = reinterpret_cast<uint64_t>(payload.data());
+    sqe->len = static_cast<uint32_t>(payload.size());
+    sqe->msg_flags = MSG_NOSIGNAL | MSG_WAITALL;
+    sqe->user_data = key;
+}
+
+void UringBackend::issue_sends() {
+    // Issue one coalesced send for every socket that has data waiting.
+    std::vector<int> sockets;
+    for (std::map<int, std::string>::const_iterator it = outgoing.begin(); it != outgoing.end(); ++it) {
+        sockets.push_back(it->first);
+    }
+    for (int fd : sockets) {
+        issue_send(fd);
+    }
+}
+
+void UringBackend::release_connection(int fd) {
+    std::lock_guard<std::mutex> lock(submit_mutex);
+
+    // Flush what the socket still owes; data stuck behind an unfinished send is dropped.
+    issue_send(fd);
+    outgoing.erase(fd);
+
+    // Cancel the armed receive and retire the socket's generation.
+    io_uring_sqe *sqe = get_sqe();
+    sqe->opcode = IORING_OP_ASYNC_CANCEL;
+    sqe->addr = pack(KIND_RECV, generation_of(fd), fd);
+    sqe->user_data = pack(KIND_CANCEL, 0, fd);
+    generations[fd]++;
+    single_shot[fd] = false;
+
+    // Queued sends must reach the kernel before the descriptor is closed.
+    submit_locked();
+}
+
+void UringBackend::adopt_connection(int fd) {
+    std::lock_guard<std::mutex> lock(submit_mutex);
+
+    // Start receiving on a socket inherited from a previous process.
+    arm_recv(fd);
+}
+
+void UringBackend::quiesce() {
+    std::lock_guard<std::mutex> lock(submit_mutex);
+
+    // Stop accepting and receiving; nothing is re-armed until resume.
+    quiescing = true;
+    for (uint64_t user_data : armed) {
+        io_uring_sqe *sqe = get_sqe();
+        sqe->opcode = IORING_OP_ASYNC_CANCEL;
+        sqe->addr = user_data;
+        sqe->user_data = pack(KIND_CANCEL, 0, static_cast<int>(user_data & 0xFFFFFFFF));
+    }
+    submit_locked();
+    Logger::log(__FILENAME__, __FUNCTION__, "Quiescing " + std::to_string(armed.size()) + " armed requests");
+}
+
+bool UringBackend::is_quiet() {
+    std::lock_guard<std::mutex> lock(submit_mutex);
+
+    // Quiet once every request has ended and every reply has left.
+    return armed.empty() && pending_sends.empty() && outgoing.empty();
+}
+
+void UringBackend::resume(const std::vector<int> &sockets) {
+    std::lock_guard<std::mutex> lock(submit_mutex);
+
+    // Arm the accepts and every connection's receive again.
+    quiescing = false;
+    for (int listen_fd : listen_sockets) {
+        arm_accept(listen_fd);
+    }
+    for (int fd : sockets) {
+        arm_recv(fd);
+    }
+    submit_locked();
+    Logger::log(__FILENAME__, __FUNCTION__, "Resumed " + std::to_string(sockets.size()) + " connections");
+}
+
+bool UringBackend::is_current(const UringEvent &event) {
+    std::lock_guard<std::mutex> lock(submit_mutex);
+    return event.type == UringEvent::ACCEPTED || event.generation == generation_of(event.fd);
+}
+
+void UringBackend::recycle(const UringEvent &event) {
+    if (event.buffer_id >= 0) {
+        add_buffer(event.buffer_id);
+    }
+}
+
+int UringBackend::wait_events(std::vector<UringEvent> &events, int timeout_ms) {
+    events.clear();
+
+    // Submit the queued batch and wait for completions in the same system call.
+    unsigned to_submit;
+    {
+        std::lock_guard<std::mutex> lock(submit_mutex);
+        issue_sends();
+        to_submit = unsubmitted;
+        unsubmitted = 0;
+    }
+
+    if (__atomic_load_n(cq_tail, __ATOMIC_ACQUIRE) == *cq_head) {
+        if (timeout_ms >= 0) {
+            __kernel_timespec timeout;
+            timeout.tv_sec = timeout_ms / 1000;
+            timeout.tv_nsec = (timeout_ms % 1000) * 1000000L;
+            io_uring_getevents_arg argument;
+            memset(&argument, 0, sizeof(argument));
+            argument.ts = reinterpret_cast<uint64_t>(&timeout);
+            submit(to_submit, 1, IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG, &argument, sizeof(argument));
+        } else {
+            submit(to_submit, 1, IORING_ENTER_GETEVENTS, nullptr, 0);
+        }
+    } else if (to_submit > 0) {
+        submit(to_submit, 0, 0, nullptr, 0);
+    }
+
+    // Harvest all completions without further system calls.
+    std::lock_guard<std::mutex> lock(submit_mutex);
+    unsigned head = *cq_head;
+    unsigned tail = __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE);
+    for (; head != tail; ++head) {
+        const io_uring_cqe &cqe = cqes[head & *cq_mask];
+        Kind kind = static_cast<Kind>(cqe.user_data >> 56);
+        int fd = static_cast<int>(cqe.user_data & 0xFFFFFFFF);
+        uint32_t generation = static_cast<uint32_t>((cqe.user_data >> 32) & 0xFFFFFF);
+        bool more = (cqe.flags & IORING_CQE_F_MORE) != 0;
+
+        // A request without more completions to come is no longer armed.
+        if ((kind == KIND_ACCEPT || kind == KIND_RECV) && !more) {
+            armed.erase(cqe.user_data);
+        }
+
+        if (kind == KIND_ACCEPT) {
+            // A new connection; its receive is armed before the server even sees it.
+            if (cqe.res >= 0) {
+                arm_recv(cqe.res);
+                UringEvent event = {UringEvent::ACCEPTED, cqe.res, generation_of(cqe.res), nullptr, 0, -1, fd};
+                events.push_back(event);
+            } else {
+                Logger::log(__FILENAME__, __FUNCTION__, "Error: Accept failed: " + std::string(strerror(-cqe.res)));
+            }
+            if (!more) {
+                arm_accept(fd);
+            }
+        } else if (kind == KIND_RECV) {
+            int buffer_id = (cqe.flags & IORING_CQE_F_BUFFER) ? static_cast<int>(cqe.flags >> IORING_CQE_BUFFER_SHIFT) : -1;
+            bool current = generation == generation_of(fd);
+
+            if (!current) {
+                // Late completion of a connection that was already released.
+                if (buffer_id >= 0) {
+                    add_buffer(buffer_id);
+                }
+            } else if (cqe.res > 0) {
+                UringEvent event = {UringEvent::RECEIVED, fd, generation, buffer_memory + buffer_id * BUFFER_SIZE, cqe.res, buffer_id};
+                events.push_back(event);
+                if (!more) {
+                    arm_recv(fd);
+                }
+            } else if (cqe.res == -ENOBUFS) {
+                // All buffers were in flight; the request ended and is simply armed again.
+                arm_recv(fd);
+            } else if (cqe.res == -EINVAL && !single_shot[fd]) {
+                // Kernels without multishot receive fall back to re-arming after every read.
+                Logger::log(__FILENAME__, __FUNCTION__, "Multishot receive unsupported, using single-shot receives");
+                single_shot[fd] = true;
+                arm_recv(fd);
+            } else if (cqe.res != -ECANCELED) {
+                // End of stream or a socket error closes the connection.
+                UringEvent event = {UringEvent::CLOSED, fd, generation, nullptr, 0, -1};
+                events.push_back(event);
+            }
+        } else if (kind == KIND_SEND) {
+            std::map<uint64_t, std::string>::iterator sent = pending_sends.find(cqe.user_data);
+            if (sent == pending_sends.end()) {
+                continue;
+            }
+            if (cqe.res < 0 && cqe.res != -ECANCELED) {
+                Logger::log(__FILENAME__, __FUNCTION__, "Error: Send failed: " + std::string(strerror(-cqe.res)));
+            } else if (generation == generation_of(fd) && cqe.res >= 0 && static_cast<size_t>(cqe.res) < sent->second.size()) {
+                // A short send puts the unsent tail back in front of newer data.
+                outgoing[fd].insert(0, sent->second, cqe.res, std::string::npos);
+            }
+            pending_sends.erase(sent);
+        }
+    }
+    __atomic_store_n(cq_head, head, __ATOMIC_RELEASE);
+    return static_cast<int>(events.size());
+}
@@ -0,0 +1,110 @@
+#ifndef UringBackend_hpp
+#define UringBackend_hpp
+
+#include <stdint.h>
+#include <stddef.h>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+#include <linux/io_uring.h>
+
+#include "Logger.hpp"
+
+// One completed operation handed back to the server loop.
+struct UringEvent
+{
+    enum Type
+    {
+        ACCEPTED,
+        RECEIVED,
+        CLOSED
+    };
+
+    Type type;
+    int fd;
+    uint32_t generation;
+    const char *data;
+    int length;
+    int buffer_id;
+    int listen_fd;
+};
+
+// io_uring backend for the server socket loop. Accepts and receives are multishot requests
+// that stay armed, received data lands in a registered provided-buffer ring, and sends queued
+// while a batch of completions is handled are coalesced per socket and go out with the next
+// io_uring_enter, with at most one send in flight per socket so replies keep their order.
+class UringBackend
+{
+public:
+    static const unsigned RING_ENTRIES = 256;
+    static const unsigned BUFFER_COUNT = 256;
+    static unsigned BUFFER_SIZE;
+
+    static bool initialize(int listen_fd);
+    static void add_listener(int listen_fd);
+    static bool is_active() { return ring_fd >= 0; };
+
+    static int wait_events(std::vector<UringEvent> &events, int timeout_ms);
+    static bool is_current(const UringEvent &event);
+    static void recycle(const UringEvent &event);
+    static void queue_send(int fd, const char *data, size_t length);
+    static void release_connection(int fd);
+    static void adopt_connection(int fd);
+
+    static void quiesce();
+    static bool is_quiescing() { return quiescing; };
+    static bool is_quiet();
+    static void resume(const std::vector<int> &sockets);
+
+private:
+    enum Kind
+    {
+        KIND_ACCEPT = 1,
+        KIND_RECV = 2,
+        KIND_SEND = 3,
+        KIND_CANCEL = 4
+    };
+
+    static int ring_fd;
+    static std::vector<int> listen_sockets;
+    static std::thread::id loop_thread;
+    static std::mutex submit_mutex;
+
+    static unsigned *sq_head;
+    static unsigned *sq_tail;
+    static unsigned *sq_mask;
+    static unsigned *sq_array;
+    static io_uring_sqe *sqes;
+    static unsigned *cq_head;
+    static unsigned *cq_tail;
+    static unsigned *cq_mask;
+    static io_uring_cqe *cqes;
+    static unsigned unsubmitted;
+
+    static io_uring_buf *buffer_ring;
+    static char *buffer_memory;
+    static unsigned short buffer_tail;
+
+    static bool quiescing;
+    static std::set<uint64_t> armed;
+    static std::vector<uint32_t> generations;
+    static std::vector<bool> single_shot;
+    static std::map<int, std::string> outgoing;
+    static std::map<uint64_t, std::string> pending_sends;
+
+    static io_uring_sqe *get_sqe();
+    static int submit(unsigned to_submit, unsigned min_complete, unsigned flags, void *argument, size_t argument_size);
+    static void submit_locked();
+    static void arm_accept(int listen_fd);
+    static void arm_recv(int fd);
+    static void add_buffer(int buffer_id);
+    static void issue_send(int fd);
+    static void issue_sends();
+    static uint32_t generation_of(int fd);
+    static uint64_t pack(Kind kind, uint32_t generation, int fd);
+};
+
+#endif /* UringBackend_hpp */
@@ -0,0 +1,364 @@
+#include "WebSocketGateway.hpp"
+#include <algorithm>
+#include <array>
+#include <cstring>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+size_t WebSocketGateway::MAX_HANDSHAKE_BYTES = 4096;
+size_t WebSocketGateway::MAX_MESSAGE_BYTES = 65536;
+
+std::unordered_map<int, WebSocketGateway::Connection> WebSocketGateway::connections;
+std::deque<std::string> WebSocketGateway::assembled;
+
+static const char *HANDSHAKE_GUID = "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+
+// SHA-1 of the handshake key; the protocol needs it for nothing else.
+static std::array<uint8_t, 20> sha1(const std::string &input) {
+    uint32_t h[5] = {0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0};
+    std::string message = input;
+    uint64_t bit_length = static_cast<uint64_t>(input.size()) * 8;
+    message += static_cast<char>(0x80);
+    while (message.size() % 64 != 56) {
+        message += '\0';
+    }
+    for (int shift = 56; shift >= 0; shift -= 8) {
+        message += static_cast<char>((bit_length >> shift) & 0xFF);
+    }
+
+    for (size_t chunk = 0; chunk < message.size(); chunk += 64) {
+        uint32_t w[80];
+        for (int i = 0; i < 16; ++i) {
+            const uint8_t *bytes = reinterpret_cast<const uint8_t *>(message.data() + chunk + i * 4);
+            w[i] = (bytes[0] << 24) | (bytes[1] << 16) | (bytes[2] << 8) | bytes[3];
+        }
+        for (int i = 16; i < 80; ++i) {
+            uint32_t value = w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16];
+            w[i] = (value << 1) | (value >> 31);
+        }
+
+        uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4];
+        for (int i = 0; i < 80; ++i) {
+            uint32_t f, k;
+            if (i < 20) {
+                f = (b & c) | (~b & d);
+                k = 0x5A827999;
+            } else if (i < 40) {
+                f = b ^ c ^ d;
+                k = 0x6ED9EBA1;
+            } else if (i < 60) {
+                f = (b & c) | (b & d) | (c & d);
+                k = 0x8F1BBCDC;
+            } else {
+                f = b ^ c ^ d;
+                k = 0xCA62C1D6;
+            }
+            uint32_t temp = ((a << 5) | (a >> 27)) + f + e + k + w[i];
+            e = d;
+            d = c;
+            c = (b << 30) | (b >> 2);
+            b = a;
+            a = temp;
+        }
+        h[0] += a;
+        h[1] += b;
+        h[2] += c;
+        h[3] += d;
+        h[4] += e;
+    }
+
+    std::array<uint8_t, 20> digest;
+    for (int i = 0; i < 20; ++i) {
+        digest[i] = (h[i / 4] >> (24 - 8 * (i % 4))) & 0xFF;
+    }
+    return digest;
+}
+
+static std::string base64(const uint8_t *data, size_t length) {
+    static const char *ALPHABET = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    std::string encoded;
+    for (size_t i = 0; i < length; i += 3) {
+        uint32_t group = data[i] << 16;
+        if (i + 1 < length) {
+            group |= data[i + 1] << 8;
+        }
+        if (i + 2 < length) {
+            group |= data[i + 2];
+        }
+        encoded += ALPHABET[(group >> 18) & 0x3F];
+        encoded += ALPHABET[(group >> 12) & 0x3F];
+        encoded += (i + 1 < length) ? ALPHABET[(group >> 6) & 0x3F] : '=';
+        encoded += (i + 2 < length) ? ALPHABET[group & 0x3F] : '=';
+    }
+    return encoded;
+}
+
+// Value of an HTTP header, matched case-insensitively, or an empty string.
+static std::string header_value(const std::string &request, const std::string &name) {
+    size_t line = request.find("\r\n");
+    while (line != std::string::npos && line + 2 < request.size()) {
+        size_t start = line + 2;
+        size_t end = request.find("\r\n", start);
+        size_t colon = request.find(':', start);
+        if (end == std::string::npos || colon == std::string::npos || colon > end) {
+            line = end;
+            continue;
+        }
+        if (colon - start == name.size() && std::equal(name.begin(), name.end(), request.begin() + start, [](char x, char y) { return tolower(x) == tolower(y); })) {
+            size_t value = request.find_first_not_of(" \t", colon + 1);
+            return (value < end) ? request.substr(value, end - value) : "";
+        }
+        line = end;
+    }
+    return "";
+}
+
+static bool contains_token(std::string value, const std::string &token) {
+    std::transform(value.begin(), value.end(), value.begin(), ::tolower);
+    return value.find(token) != std::string::npos;
+}
+
+void WebSocketGateway::open(int socket, bool upgraded) {
+    connections[socket] = Connection{upgraded, false, "", ""};
+}
+
+void WebSocketGateway::release(int socket) {
+    connections.erase(socket);
+}
+
+bool WebSocketGateway::is_upgraded(int socket) {
+    if (connections.empty()) {
+        return false;
+    }
+    auto connection = connections.find(socket);
+    return connection != connections.end() && connection->second.upgraded;
+}
+
+void WebSocketGateway::save_state(HandoffBuffer &buffer) {
+    // Every connection with its upgrade flag and the bytes of a handshake or frame not complete yet.
+    buffer.put_int(static_cast<int32_t>(connections.size()));
+    for (const auto &[socket, connection] : connections) {
+        buffer.put_int(socket);
+        buffer.put_int((connection.upgraded ? 1 : 0) | (connection.fragmented ? 2 : 0));
+        buffer.put_string(connection.pending);
+        buffer.put_string(connection.fragments);
+    }
+}
+
+bool WebSocketGateway::restore_state(HandoffBuffer &buffer, const std::map<int, int> &sockets) {
+    int32_t count;
+    if (!buffer.get_int(count)) {
+        return false;
+    }
+    for (int32_t i = 0; i < count; ++i) {
+        int32_t old_socket, flags;
+        std::string pending, fragments;
+        if (!buffer.get_int(old_socket) || !buffer.get_int(flags) || !buffer.get_string(pending) || !buffer.get_string(fragments)) {
+            return false;
+        }
+
+        // Connections that were not handed over are gone with the previous process.
+        auto socket = sockets.find(old_socket);
+        if (socket != sockets.end()) {
+            connections[socket->second] = Connection{(flags & 1) != 0, (flags & 2) != 0, pending, fragments};
+        }
+    }
+    return true;
+}
+
+std::string WebSocketGateway::accept_key(const std::string &key) {
+    std::array<uint8_t, 20> digest = sha1(key + HANDSHAKE_GUID);
+    return base64(digest.data(), digest.size());
+}
+
+bool WebSocketGateway::receive(int socket, std::string &data, std::vector<std::string_view> &messages, std::string &reply) {
+    messages.clear();
+    assembled.clear();
+    auto found = connections.find(socket);
+    if (found == connections.end()) {
+        return false;
+    }
+    Connection &connection = found->second;
+
+    // A frame split across reads continues in front of the new bytes; parsing always runs on data.
+    if (!connection.pending.empty()) {
+        connection.pending += data;
+        data.swap(connection.pending);
+        connection.pending.clear();
+    }
+
+    size_t offset = 0;
+    if (!connection.upgraded && !upgrade(connection, data, offset, reply)) {
+        return false;
+    }
+    return connection.upgraded ? parse_frames(connection, data, offset, messages, reply) : true;
+}
+
+bool WebSocketGateway::upgrade(Connection &connection, std::string &data, size_t &offset, std::string &reply) {
+    size_t end = data.find("\r\n\r\n");
+    if (end == std::string::npos) {
+        if (data.size() > MAX_HANDSHAKE_BYTES) {
+            reply = "HTTP/1.1 431 Request Header Fields Too Large\r\nConnection: close\r\n\r\n";
+            return false;
+        }
+        connection.pending = data;
+        return true;
+    }
+
+    std::string request = data.substr(0, end + 2);
+    std::string key = header_value(request, "Sec-WebSocket-Key");
+    if (request.compare(0, 4, "GET ") != 0 || !contains_token(header_value(request, "Upgrade"), "websocket") || key.empty() ||
+        header_value(request, "Sec-WebSocket-Version") != "13") {
+        Logger::log(__FILENAME__, __FUNCTION__, "Error: Invalid WebSocket upgrade request");
+        reply = "HTTP/1.1 400 Bad Request\r\nSec-WebSocket-Version: 13\r\nConnection: close\r\n\r\n";
+        return false;
+    }
+
+    reply = "HTTP/1.1 101 Switching Protocols\r\nUpgrade: websocket\r\nConnection: Upgrade\r\nSec-WebSocket-Accept: " + accept_key(key) + "\r\n\r\n";
+    connection.upgraded = true;
+    offset = end + 4;
+    return true;
+}
+
+bool WebSocketGateway::parse_frames(Connection &connection, std::string &data, size_t offset, std::vector<std::string_view> &messages, std::string &reply) {
+    while (offset < data.size()) {
+        // Header: FIN, RSV and opcode; MASK and a 7, 16 or 64 bit length; the 4 byte masking key.
+        const uint8_t *header = reinterpret_cast<const uint8_t *>(data.data() + offset);
+        size_t available = data.size() - offset;
+        if (available < 2) {
+            break;
+        }
+        bool fin = header[0] & 0x80;
+        int opcode = header[0] & 0x0F;
+        uint64_t length = header[1] & 0x7F;
+        size_t header_length = 2;
+        if ((header[0] & 0x70) || !(header[1] & 0x80)) {
+            Logger::log(__FILENAME__, __FUNCTION__, "Error: Unmasked or extended frame from a client");
+            reply += frame("\x03\xEA", CLOSE);
+            return false;
+        }
+        if (length == 126) {
+            header_length += 2;
+            if (available < header_length) {
+                break;
+            }
+            length = (header[2] << 8) | header[3];
+        } else if (length == 127) {
+            header_length += 8;
+            if (available < header_length) {
+                break;
+            }
+            length = 0;
+            for (int i = 2; i < 10; ++i) {
+                length = (length << 8) | header[i];
+            }
+        }
+        if (length > MAX_MESSAGE_BYTES || connection.fragments.size() + length > MAX_MESSAGE_BYTES) {
+            Logger::log(__FILENAME__, __FUNCTION__, "Error: WebSocket message over " + std::to_string(MAX_MESSAGE_BYTES) + " bytes");
+            reply += frame("\x03\xF1", CLOSE);
+            return false;
+        }
+        header_length += 4;
+        if (available < header_length + length) {
+            break;
+        }
+
+        uint8_t mask[4];
+        memcpy(mask, header + header_length - 4, 4);
+        char *payload = data.data() + offset + header_length;
+        unmask(payload, length, mask);
+        offset += header_length + length;
+
+        switch (opcode) {
+            case TEXT:
+            case BINARY:
+                if (connection.fragmented) {
+                    reply += frame("\x03\xEA", CLOSE);
+                    return false;
+                }
+                if (fin) {
+                    messages.emplace_back(payload, length);
+                } else {
+                    connection.fragmented = true;
+                    connection.fragments.assign(payload, length);
+                }
+                break;
+            case CONTINUATION:
+                // Only a message split into fragments is ever copied.
+                if (!connection.fragmented) {
+                    reply += frame("\x03\xEA", CLOSE);
+                    return false;
+                }
+                connection.fragments.append(payload, length);
+                if (fin) {
+                    assembled.push_back(std::move(connection.fragments));
+                    messages.emplace_back(assembled.back());
+                    connection.fragments.clear();
+                    connection.fragmented = false;
+                }
+                break;
+            case PING:
+                reply += frame(std::string(payload, length), PONG);
+                break;
+            case PONG:
+                break;
+            case CLOSE:
+                reply += frame(std::string(payload, std::min<uint64_t>(length, 2)), CLOSE);
+                return false;
+            default:
+                reply += frame("\x03\xEA", CLOSE);
+                return false;
+        }
+    }
+
+    // Keep an incomplete frame for the next read.
+    connection.pending.assign(data, offset, std::string::npos);
+    return true;
+}
+
+std::string WebSocketGateway::frame(const std::string &payload, Opcode opcode) {
+    // Server frames are never masked.
+    std::string framed;
+    framed.reserve(payload.size() + 10);
+    framed += static_cast<char>(0x80 | opcode);
+    if (payload.size() < 126) {
+        framed += static_cast<char>(payload.size());
+    } else if (payload.size() <= 0xFFFF) {
+        framed += static_cast<char>(126);
+        framed += static_cast<char>(payload.size() >> 8);
+        framed += static_cast<char>(payload.size() & 0xFF);
+    } else {
+        framed += static_cast<char>(127);
+        for (int shift = 56; shift >= 0; shift -= 8) {
+            framed += static_cast<char>((static_cast<uint64_t>(payload.size()) >> shift) & 0xFF);
+        }
+    }
+    framed += payload;
+    return framed;
+}
+
+void WebSocketGateway::unmask(char *data, size_t length, const uint8_t mask[4]) {
+    // XOR 16 bytes at a time with SSE2, then 8, then the tail; every block starts at a multiple of
+    // four, so the key lines up with the payload in each of them.
+    uint32_t key;
+    memcpy(&key, mask, sizeof(key));
+    size_t i = 0;
+#if defined(__SSE2__)
+    __m128i wide_key = _mm_set1_epi32(static_cast<int>(key));
+    for (; i + 16 <= length; i += 16) {
+        __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(data + i), _mm_xor_si128(block, wide_key));
+    }
+#endif
+    uint64_t long_key = (static_cast<uint64_t>(key) << 32) | key;
+    for (; i + 8 <= length; i += 8) {
+        uint64_t block;
+        memcpy(&block, data + i, sizeof(block));
+        block ^= long_key;
+        memcpy(data + i, &block, sizeof(block));
+    }
+    for (; i < length; ++i) {
+        data[i] ^= mask[i & 3];
+    }
+}
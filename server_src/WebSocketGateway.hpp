@@ -0,0 +1,65 @@
+#ifndef WebSocketGateway_hpp
+#define WebSocketGateway_hpp
+
+#include <stdint.h>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "Logger.hpp"
+#include "HotRestart.hpp"
+
+// Server side of the WebSocket protocol (RFC 6455) for browser clients. A connection accepted on
+// the WebSocket port starts with an HTTP upgrade; from then on every text or binary message carries
+// the same '|'-terminated commands a TCP client sends, and every reply goes out as one text frame.
+// Frames are parsed and unmasked inside the buffer that was read, so a complete message reaches the
+// command path as a view of the received bytes. A hot restart carries every connection's upgrade and
+// frame state over, so a handshake or frame split across the handover continues in the successor.
+class WebSocketGateway
+{
+public:
+    enum Opcode
+    {
+        CONTINUATION = 0x0,
+        TEXT = 0x1,
+        BINARY = 0x2,
+        CLOSE = 0x8,
+        PING = 0x9,
+        PONG = 0xA
+    };
+
+    static size_t MAX_HANDSHAKE_BYTES;
+    static size_t MAX_MESSAGE_BYTES;
+
+    static void open(int socket, bool upgraded);
+    static void release(int socket);
+    static bool is_tracked(int socket) { return !connections.empty() && connections.count(socket) > 0; };
+    static bool is_upgraded(int socket);
+
+    static bool receive(int socket, std::string &data, std::vector<std::string_view> &messages, std::string &reply);
+    static std::string frame(const std::string &payload, Opcode opcode = TEXT);
+    static void unmask(char *data, size_t length, const uint8_t mask[4]);
+    static std::string accept_key(const std::string &key);
+
+    static void save_state(HandoffBuffer &buffer);
+    static bool restore_state(HandoffBuffer &buffer, const std::map<int, int> &sockets);
+
+private:
+    struct Connection
+    {
+        bool upgraded;
+        bool fragmented;
+        std::string pending;
+        std::string fragments;
+    };
+
+    static std::unordered_map<int, Connection> connections;
+    static std::deque<std::string> assembled;
+
+    static bool upgrade(Connection &connection, std::string &data, size_t &offset, std::string &reply);
+    static bool parse_frames(Connection &connection, std::string &data, size_t offset, std::vector<std::string_view> &messages, std::string &reply);
+};
+
+#endif /* WebSocketGateway_hpp */
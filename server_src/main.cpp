@@ -1,6 +1,20 @@
 #include <iostream>
 #include "Server.hpp"
 #include "Logger.hpp"
+#include "ReplayArchive.hpp"
+#include "ProfileStore.hpp"
+#include "Leaderboard.hpp"
+#include "HotRestart.hpp"
+#include "RateLimiter.hpp"
+#include "Reaper.hpp"
+#include "OpeningBook.hpp"
+#include "TrafficRecorder.hpp"
+#include "StallWatchdog.hpp"
+#include "LobbyDirectory.hpp"
+#include "ShardRouter.hpp"
+#include "Telemetry.hpp"
+#include "Config.hpp"
+#include <ctime>
 
 void tutorial();
 
@@ -8,7 +22,13 @@ int main(int argc, const char *argv[]) {
     // Log the initialization of the server.
     Logger::log(__FILENAME__, __FUNCTION__, "Initializing server...");
 
-    if (argc == 4) {
+    // Trailing key=value arguments override the configuration file.
+    std::vector<std::string> overrides;
+    while (argc > 1 && Config::is_override(argv[argc - 1])) {
+        overrides.insert(overrides.begin(), argv[--argc]);
+    }
+
+    if (argc >= 4 && argc <= 6) {
         // Parse and validate command-line arguments.
         const std::string ip_address = argv[1];
         int port = 0;
@@ -37,9 +57,132 @@ int main(int argc, const char *argv[]) {
             return EXIT_FAILURE;
         }
 
-        // Initialize and run the server.
-        Server server(ip_address, port, max_games);
-        if (server.initialize() == 0) {
+        // In takeover mode the sockets and game state come from the running server first,
+        // so it stops writing the archive and profiles before they are opened here.
+        const std::string mode = (argc == 6) ? argv[5] : "";
+        const bool takeover = (mode == "takeover");
+        const bool sharded = (mode.rfind("router:", 0) == 0);
+        if (!mode.empty() && mode != "takeover" && mode != "record" && !sharded) {
+            Logger::log(__FILENAME__, __FUNCTION__, "Error: Mode must be takeover, record or router:<SHARDS>");
+            tutorial();
+            return EXIT_FAILURE;
+        }
+
+        // Pick the I/O backend; io_uring falls back to select when unsupported.
+        ServerConfig command_line = Config::defaults();
+        command_line.max_games = max_games;
+        command_line.io_backend = (argc >= 5) ? argv[4] : "uring";
+        if (command_line.io_backend != "uring" && command_line.io_backend != "select") {
+            Logger::log(__FILENAME__, __FUNCTION__, "Error: Backend must be uring or select");
+            tutorial();
+            return EXIT_FAILURE;
+        }
+        if (sharded) {
+            try {
+                command_line.shards = std::stoi(mode.substr(7));
+            } catch (const std::exception &e) {
+                command_line.shards = 0;
+            }
+            if (command_line.shards < 1 || command_line.shards > ShardRouter::MAX_SHARDS) {
+                Logger::log(__FILENAME__, __FUNCTION__, "Error: Shards must be in range <1; " + std::to_string(ShardRouter::MAX_SHARDS) + ">");
+                tutorial();
+                return EXIT_FAILURE;
+            }
+        }
+
+        // Layer server.conf (or config=<FILE>) and the overrides on top; SIGHUP re-reads them later.
+        if (!Config::load(command_line, overrides)) {
+            Logger::log(__FILENAME__, __FUNCTION__, "Error: Invalid configuration");
+            tutorial();
+            return EXIT_FAILURE;
+        }
+        Config::install_signal_handler();
+        const ServerConfig config = Config::get();
+        if (takeover && config.shards > 0) {
+            Logger::log(__FILENAME__, __FUNCTION__, "Error: Takeover is not supported with shards");
+            return EXIT_FAILURE;
+        }
+        const std::string io_backend = config.io_backend;
+        max_games = config.max_games;
+
+        // In router mode this process binds the port, forks one worker per shard and only routes
+        // connections from then on; each worker carries on below with its own stores and share of games.
+        int shard_count = std::max(config.shards, 1);
+        int shard = -1;
+        int router_channel = -1;
+        if (config.shards > 0) {
+            int listen_fd = Server::openListener(ip_address, port, max_games);
+            if (listen_fd < 0) {
+                Logger::log(__FILENAME__, __FUNCTION__, "Error: Failed to set up the router");
+                return EXIT_FAILURE;
+            }
+            shard = ShardRouter::spawn_workers(shard_count, listen_fd, router_channel);
+            if (shard == -1) {
+                return ShardRouter::run(listen_fd);
+            } else if (shard < 0) {
+                Logger::log(__FILENAME__, __FUNCTION__, "Error: Failed to start the shards");
+                return EXIT_FAILURE;
+            }
+        }
+        const std::string store_suffix = (config.shards > 0) ? "-" + std::to_string(shard) : "";
+        int inherited_listener = -1;
+        std::map<int, int> inherited_sockets;
+        std::string inherited_state;
+        if (takeover && !HotRestart::take_over(port, inherited_listener, inherited_sockets, inherited_state)) {
+            Logger::log(__FILENAME__, __FUNCTION__, "Error: Takeover failed");
+            return EXIT_FAILURE;
+        }
+
+        // Open the replay archive; the server keeps running without it if that fails.
+        if (!ReplayArchive::open("replays" + store_suffix)) {
+            Logger::log(__FILENAME__, __FUNCTION__, "Warning: Finished games will not be archived");
+        }
+
+        // Open the persistent player profiles and flush them in the background.
+        if (ProfileStore::open("profiles" + store_suffix + ".db")) {
+            ProfileStore::start_flusher(5);
+            Leaderboard::load_from_profiles();
+        } else {
+            Logger::log(__FILENAME__, __FUNCTION__, "Warning: Player profiles will not be persisted");
+        }
+
+        // Map the opening book built by book_builder; analysis requests answer empty without it.
+        if (!OpeningBook::open("opening.book")) {
+            Logger::log(__FILENAME__, __FUNCTION__, "Warning: Opening book requests will find no moves");
+        }
+
+        // Drop idle per-address rate limits and report dropped traffic once a minute.
+        RateLimiter::start_sweeper(60);
+
+        // Reclaim orphaned games and players a few at a time.
+        Reaper::start();
+
+        // Record all inbound traffic for traffic_replay; a fresh trace per run.
+        if (mode == "record" && !TrafficRecorder::open("traffic-" + std::to_string(port) + "-" + std::to_string(time(nullptr)) + ".trace", max_games)) {
+            Logger::log(__FILENAME__, __FUNCTION__, "Warning: Traffic will not be recorded");
+        }
+
+        // Push batched lobby and game directory changes to subscribers.
+        LobbyDirectory::start();
+
+        // Publish live counters for telemetry_top in shared memory, one segment per shard.
+        if (Telemetry::open(Telemetry::segment_name(port, shard), port, shard)) {
+            Telemetry::start();
+        } else {
+            Logger::log(__FILENAME__, __FUNCTION__, "Warning: Telemetry will not be published");
+        }
+
+        // Reload the configuration on SIGHUP.
+        Config::start();
+
+        // Report event loop iterations that block for stall_threshold_ms or more, with a stack sample.
+        StallWatchdog::start(config.stall_threshold_ms);
+
+        // Initialize and run the server; every shard gets an equal part of the games.
+        Server server(ip_address, port, (max_games + shard_count - 1) / shard_count, io_backend);
+        int status = takeover ? server.adopt(inherited_listener, inherited_sockets, inherited_state)
+                              : ((config.shards > 0) ? server.attachRouter(router_channel) : server.initialize());
+        if (status == 0) {
             server.waitForConnections();
         } else {
             Logger::log(__FILENAME__, __FUNCTION__, "Error: Failed to set up the server");
@@ -56,8 +199,19 @@ int main(int argc, const char *argv[]) {
 
 // Display usage instructions for the server program.
 void tutorial() {
-    std::cout << "Usage: ./server <IP_ADDR> <PORT> <MAX_GAMES>\n" << std::endl;
+    std::cout << "Usage: ./server <IP_ADDR> <PORT> <MAX_GAMES> [BACKEND] [MODE] [KEY=VALUE...]\n" << std::endl;
     std::cout << "  IP_ADDR    - The IP address of the server\n";
     std::cout << "  PORT       - The port number to bind the server\n";
-    std::cout << "  MAX_GAMES  - The maximum number of concurrent games\n" << std::endl;
+    std::cout << "  MAX_GAMES  - The maximum number of concurrent games\n";
+    std::cout << "  BACKEND    - I/O backend: uring (default, falls back to select) or select\n";
+    std::cout << "  MODE       - takeover: replace the server running on PORT without dropping connections\n";
+    std::cout << "               record: write all inbound traffic to traffic-<PORT>-<TIME>.trace\n";
+    std::cout << "               router:<SHARDS>: route players by name to SHARDS worker processes, each with\n";
+    std::cout << "               its own replays-<N> and profiles-<N>.db (workers use the select backend)\n";
+    std::cout << "  KEY=VALUE  - Override a setting of server.conf; config=<FILE> reads another file\n" << std::endl;
+    std::cout << "server.conf holds one \"key = value\" per line. Send SIGHUP to apply edits without a restart;\n";
+    std::cout << "io_backend, shards, win_length, stall_threshold_ms, receive_buffer_bytes and the local socket\n";
+    std::cout << "need a restart. local_socket=<PATH> also accepts clients on this host over a Unix domain socket,\n";
+    std::cout << "local_socket_type=seqpacket (default) or stream. websocket_port=<PORT> accepts browser clients\n";
+    std::cout << "speaking the same commands over WebSocket.\n" << std::endl;
 }
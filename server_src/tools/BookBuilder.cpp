@@ -0,0 +1,146 @@
+#include <algorithm>
+#include <iostream>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "Game.hpp"
+#include "Player.hpp"
+#include "ReplayArchive.hpp"
+#include "OpeningBook.hpp"
+
+// Results of one move from one canonical position, seen from the player who made it.
+struct MoveStats
+{
+    uint32_t games;
+    uint32_t score;
+
+    MoveStats() : games(0), score(0) {}
+};
+
+struct BuildStats
+{
+    uint64_t records;
+    uint64_t skipped;
+    uint64_t mismatches;
+    uint64_t positions;
+
+    BuildStats() : records(0), skipped(0), mismatches(0), positions(0) {}
+};
+
+static void scan_segment(const std::string &directory, uint32_t segment_number, size_t depth, std::map<std::pair<uint64_t, uint8_t>, MoveStats> &book, BuildStats &stats)
+{
+    ReplaySegment segment;
+    if (!segment.open(ReplayArchive::segment_path(directory, segment_number), ReplayArchive::index_path(directory, segment_number)))
+    {
+        std::cerr << "Unable to open segment " << segment_number << std::endl;
+        return;
+    }
+    segment.advise_sequential();
+
+    // Replay every game on the server's own board so only games with a confirmed result are used.
+    Player first_player("book", -1);
+    Player second_player("book", -1);
+    Game board(0, &first_player, &second_player);
+
+    for (uint64_t position = 0; position < segment.size(); ++position)
+    {
+        const ReplayRecord *record = segment.record(position);
+        if (!record)
+            break;
+        stats.records++;
+
+        if (record->result == ReplayArchive::RESULT_ABANDONED || record->board_size != Game::BOARD_SIZE || record->move_count == 0)
+        {
+            stats.skipped++;
+            continue;
+        }
+
+        board.reset_game_board();
+        board.active_turn = record->first_turn;
+        const uint8_t *moves = record->moves();
+        bool legal = true;
+        for (int i = 0; i < record->move_count && legal; ++i)
+        {
+            Player *mover = (board.active_turn == 1) ? &first_player : &second_player;
+            legal = board.execute_turn(moves[i] / Game::BOARD_SIZE, moves[i] % Game::BOARD_SIZE, mover) == 0;
+        }
+        int state = board.evaluate_game_state();
+        int expected = (record->result == ReplayArchive::RESULT_TIE) ? -1 : 1;
+        if (!legal || state != expected)
+        {
+            stats.mismatches++;
+            continue;
+        }
+
+        // The winner made the last move; 0 is a tie, otherwise the winning role (0 opener, 1 second).
+        int winner_role = (state == 1) ? (record->move_count - 1) % 2 : -1;
+
+        // Credit every early move to its canonical position.
+        BookPosition book_position;
+        for (size_t i = 0; i < depth && i < record->move_count; ++i)
+        {
+            int role = static_cast<int>(i % 2);
+            uint8_t canonical_move = static_cast<uint8_t>(book_position.canonical_move(moves[i]));
+            MoveStats &move = book[std::make_pair(book_position.get_key(), canonical_move)];
+            move.games++;
+            move.score += (winner_role == role) ? 2 : (winner_role < 0 ? 1 : 0);
+            book_position.play(moves[i]);
+            stats.positions++;
+        }
+    }
+}
+
+int main(int argc, const char *argv[])
+{
+    if (argc < 3)
+    {
+        std::cout << "Usage: ./book_builder <ARCHIVE_DIR> <BOOK_FILE> [DEPTH] [MIN_GAMES]\n" << std::endl;
+        std::cout << "  ARCHIVE_DIR  - Directory with replay segments written by the server\n";
+        std::cout << "  BOOK_FILE    - Opening book to write (the server maps opening.book)\n";
+        std::cout << "  DEPTH        - Number of opening moves taken from every game (default 8)\n";
+        std::cout << "  MIN_GAMES    - Moves played fewer times are left out (default 2)\n" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    const std::string directory = argv[1];
+    const std::string book_path = argv[2];
+    size_t depth = (argc > 3) ? std::stoul(argv[3]) : 8;
+    uint32_t min_games = (argc > 4) ? static_cast<uint32_t>(std::stoul(argv[4])) : 2;
+
+    // Positions are merged across segments, so the scan stays on one thread.
+    std::map<std::pair<uint64_t, uint8_t>, MoveStats> moves;
+    BuildStats stats;
+    std::vector<uint32_t> segments = ReplayArchive::list_segments(directory);
+    for (size_t i = 0; i < segments.size(); ++i)
+    {
+        scan_segment(directory, segments[i], depth, moves, stats);
+    }
+
+    // Keep the moves that were played often enough.
+    std::vector<OpeningBookEntry> book;
+    for (std::map<std::pair<uint64_t, uint8_t>, MoveStats>::const_iterator it = moves.begin(); it != moves.end(); ++it)
+    {
+        if (it->second.games < min_games)
+            continue;
+        OpeningBookEntry entry = {};
+        entry.key = it->first.first;
+        entry.move = it->first.second;
+        entry.games = it->second.games;
+        entry.score = it->second.score;
+        book.push_back(entry);
+    }
+
+    if (!OpeningBook::write(book_path, book))
+    {
+        std::cerr << "Unable to write " << book_path << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    std::cout << "Segments: " << segments.size() << ", Records: " << stats.records << ", Skipped: " << stats.skipped
+              << ", Mismatched results: " << stats.mismatches << std::endl;
+    std::cout << "Positions visited: " << stats.positions << ", Distinct moves: " << moves.size()
+              << ", Book entries: " << book.size() << " (" << book.size() * sizeof(OpeningBookEntry) / 1024 << " KiB)" << std::endl;
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,349 @@
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "Game.hpp"
+#include "Player.hpp"
+#include "ReplayArchive.hpp"
+
+// Outcome counters shared by openings, first moves and the whole archive.
+struct OutcomeStats
+{
+    uint64_t games;
+    uint64_t first_mover_wins;
+    uint64_t second_mover_wins;
+    uint64_t ties;
+
+    OutcomeStats() : games(0), first_mover_wins(0), second_mover_wins(0), ties(0) {}
+
+    void add(int outcome)
+    {
+        games++;
+        if (outcome == 1)
+            first_mover_wins++;
+        else if (outcome == 2)
+            second_mover_wins++;
+        else
+            ties++;
+    }
+
+    void merge(const OutcomeStats &other)
+    {
+        games += other.games;
+        first_mover_wins += other.first_mover_wins;
+        second_mover_wins += other.second_mover_wins;
+        ties += other.ties;
+    }
+};
+
+static const int CELL_COUNT = Game::BOARD_SIZE * Game::BOARD_SIZE;
+
+// Opening tree with one fixed child slot per cell, so counting an opening walks arrays instead of
+// building keys. Nodes live in one vector; index 0 is the root and never a child, so 0 means none.
+struct OpeningTree
+{
+    struct Node
+    {
+        OutcomeStats stats;
+        uint32_t children[CELL_COUNT];
+
+        Node() : children() {}
+    };
+
+    std::vector<Node> nodes;
+
+    OpeningTree() : nodes(1) {}
+
+    uint32_t child(uint32_t node, int cell)
+    {
+        if (nodes[node].children[cell] == 0)
+        {
+            nodes[node].children[cell] = static_cast<uint32_t>(nodes.size());
+            nodes.push_back(Node());
+        }
+        return nodes[node].children[cell];
+    }
+
+    void merge(const OpeningTree &other, uint32_t node = 0, uint32_t other_node = 0)
+    {
+        nodes[node].stats.merge(other.nodes[other_node].stats);
+        for (int cell = 0; cell < CELL_COUNT; ++cell)
+        {
+            if (other.nodes[other_node].children[cell] != 0)
+                merge(other, child(node, cell), other.nodes[other_node].children[cell]);
+        }
+    }
+};
+
+// Per-player totals over the whole archive.
+struct PlayerStats
+{
+    uint64_t games;
+    uint64_t wins;
+    uint64_t losses;
+    uint64_t ties;
+
+    PlayerStats() : games(0), wins(0), losses(0), ties(0) {}
+};
+
+// Everything one scanning thread collects for its segment.
+struct SegmentStats
+{
+    uint64_t records;
+    uint64_t abandoned;
+    uint64_t mismatches;
+    uint64_t total_moves;
+    OutcomeStats overall;
+    OutcomeStats first_moves[CELL_COUNT];
+    OpeningTree openings;
+    // Transparent comparison finds known players by view; only a new name allocates.
+    std::map<std::string, PlayerStats, std::less<> > players;
+
+    SegmentStats() : records(0), abandoned(0), mismatches(0), total_moves(0) {}
+};
+
+static void record_player(SegmentStats &stats, const char *name, int result)
+{
+    // Update one player's totals with a win (1), loss (-1) or tie (0).
+    std::string_view key(name, strnlen(name, 16));
+    auto it = stats.players.find(key);
+    if (it == stats.players.end())
+        it = stats.players.emplace(std::string(key), PlayerStats()).first;
+    PlayerStats &player = it->second;
+    player.games++;
+    if (result > 0)
+        player.wins++;
+    else if (result < 0)
+        player.losses++;
+    else
+        player.ties++;
+}
+
+static void scan_segment(const std::string &directory, uint32_t segment_number, size_t opening_depth, SegmentStats &stats)
+{
+    ReplaySegment segment;
+    if (!segment.open(ReplayArchive::segment_path(directory, segment_number), ReplayArchive::index_path(directory, segment_number)))
+    {
+        std::cerr << "Unable to open segment " << segment_number << std::endl;
+        return;
+    }
+    segment.advise_sequential();
+
+    // One board per thread, reset between records, so the replay uses the server's own rules.
+    Player first_player("replay", -1);
+    Player second_player("replay", -1);
+    Game board(0, &first_player, &second_player);
+
+    for (uint64_t position = 0; position < segment.size(); ++position)
+    {
+        const ReplayRecord *record = segment.record(position);
+        if (!record)
+            break;
+        stats.records++;
+
+        if (record->result == ReplayArchive::RESULT_ABANDONED || record->board_size != Game::BOARD_SIZE || record->move_count == 0)
+        {
+            stats.abandoned++;
+            continue;
+        }
+        const uint8_t *moves = record->moves();
+        if (std::any_of(moves, moves + record->move_count, [](uint8_t move) { return move >= CELL_COUNT; }))
+        {
+            stats.mismatches++;
+            continue;
+        }
+
+        // Replay the packed moves in place on the board.
+        board.reset_game_board();
+        board.active_turn = record->first_turn;
+        for (int i = 0; i < record->move_count; ++i)
+        {
+            Player *mover = (board.active_turn == 1) ? &first_player : &second_player;
+            board.execute_turn(moves[i] / Game::BOARD_SIZE, moves[i] % Game::BOARD_SIZE, mover);
+        }
+
+        // Evaluate the final position with the server logic and compare it with the stored result.
+        int state = board.evaluate_game_state();
+        int expected = (record->result == ReplayArchive::RESULT_TIE) ? -1 : 1;
+        if (state != expected)
+        {
+            stats.mismatches++;
+            continue;
+        }
+
+        // The winner always made the last move; express the outcome from the opener's point of view.
+        int outcome = 0;
+        if (state == 1)
+            outcome = (record->move_count % 2 == 1) ? 1 : 2;
+
+        stats.total_moves += record->move_count;
+        stats.overall.add(outcome);
+        stats.first_moves[moves[0]].add(outcome);
+        uint32_t node = 0;
+        for (size_t depth = 1; depth <= opening_depth && depth <= record->move_count; ++depth)
+        {
+            node = stats.openings.child(node, moves[depth - 1]);
+            stats.openings.nodes[node].stats.add(outcome);
+        }
+
+        int first_result = (record->result == ReplayArchive::RESULT_TIE) ? 0 : (record->result == ReplayArchive::RESULT_PLAYER_ONE_WIN ? 1 : -1);
+        record_player(stats, record->player_one, first_result);
+        record_player(stats, record->player_two, -first_result);
+    }
+}
+
+static std::string format_move(unsigned char move)
+{
+    return std::to_string(move / Game::BOARD_SIZE) + "," + std::to_string(move % Game::BOARD_SIZE);
+}
+
+static std::string format_rate(uint64_t part, uint64_t whole)
+{
+    char buffer[16];
+    snprintf(buffer, sizeof(buffer), "%.1f%%", whole ? 100.0 * part / whole : 0.0);
+    return buffer;
+}
+
+static void print_openings(const OpeningTree &openings, uint32_t parent, size_t depth, size_t top)
+{
+    // Collect the direct children of the node and print the most frequent ones.
+    std::vector<std::pair<uint64_t, int> > children;
+    for (int cell = 0; cell < CELL_COUNT; ++cell)
+    {
+        uint32_t child = openings.nodes[parent].children[cell];
+        if (child != 0)
+            children.push_back(std::make_pair(openings.nodes[child].stats.games, cell));
+    }
+    std::sort(children.rbegin(), children.rend());
+
+    for (size_t i = 0; i < children.size() && i < top; ++i)
+    {
+        uint32_t child = openings.nodes[parent].children[children[i].second];
+        const OutcomeStats &node = openings.nodes[child].stats;
+        std::cout << std::string(2 * depth + 2, ' ') << format_move(children[i].second)
+                  << "  games=" << node.games << " opener=" << format_rate(node.first_mover_wins, node.games)
+                  << " second=" << format_rate(node.second_mover_wins, node.games) << std::endl;
+        print_openings(openings, child, depth + 1, top);
+    }
+}
+
+static void print_usage()
+{
+    std::cout << "Usage: ./replay_stats <ARCHIVE_DIR> [OPENING_DEPTH] [TOP]\n" << std::endl;
+    std::cout << "  ARCHIVE_DIR    - Directory with replay segments written by the server\n";
+    std::cout << "  OPENING_DEPTH  - Number of moves in the opening tree (default 3)\n";
+    std::cout << "  TOP            - Number of lines shown per tree node and player table (default 5)\n" << std::endl;
+}
+
+int main(int argc, const char *argv[])
+{
+    if (argc < 2)
+    {
+        print_usage();
+        return EXIT_FAILURE;
+    }
+
+    const std::string directory = argv[1];
+    size_t opening_depth = 3;
+    size_t top = 5;
+    try
+    {
+        if (argc > 2)
+            opening_depth = std::stoul(argv[2]);
+        if (argc > 3)
+            top = std::stoul(argv[3]);
+    }
+    catch (const std::exception &e)
+    {
+        print_usage();
+        return EXIT_FAILURE;
+    }
+
+    // Scan every segment on its own thread.
+    std::vector<uint32_t> segments = ReplayArchive::list_segments(directory);
+    size_t segment_count = segments.size();
+    std::vector<SegmentStats> segment_stats(segment_count);
+    std::vector<std::thread> workers;
+
+    std::chrono::steady_clock::time_point started = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < segment_count; ++i)
+    {
+        workers.push_back(std::thread(scan_segment, directory, segments[i], opening_depth, std::ref(segment_stats[i])));
+    }
+    for (size_t i = 0; i < workers.size(); ++i)
+    {
+        workers[i].join();
+    }
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+
+    // Merge the per-segment results.
+    SegmentStats total;
+    for (size_t i = 0; i < segment_stats.size(); ++i)
+    {
+        const SegmentStats &part = segment_stats[i];
+        total.records += part.records;
+        total.abandoned += part.abandoned;
+        total.mismatches += part.mismatches;
+        total.total_moves += part.total_moves;
+        total.overall.merge(part.overall);
+        for (int cell = 0; cell < CELL_COUNT; ++cell)
+            total.first_moves[cell].merge(part.first_moves[cell]);
+        total.openings.merge(part.openings);
+        for (std::map<std::string, PlayerStats, std::less<> >::const_iterator it = part.players.begin(); it != part.players.end(); ++it)
+        {
+            PlayerStats &player = total.players[it->first];
+            player.games += it->second.games;
+            player.wins += it->second.wins;
+            player.losses += it->second.losses;
+            player.ties += it->second.ties;
+        }
+    }
+
+    std::cout << "Segments: " << segment_count << ", Records: " << total.records << ", Abandoned: " << total.abandoned
+              << ", Mismatched results: " << total.mismatches << std::endl;
+    std::cout << "Scan time: " << elapsed << " s (" << static_cast<uint64_t>(elapsed > 0 ? total.records / elapsed : 0) << " games/s)" << std::endl;
+    std::cout << "Average game length: " << (total.overall.games ? static_cast<double>(total.total_moves) / total.overall.games : 0.0) << " moves" << std::endl;
+    std::cout << "Opener wins: " << format_rate(total.overall.first_mover_wins, total.overall.games)
+              << ", Second player wins: " << format_rate(total.overall.second_mover_wins, total.overall.games)
+              << ", Ties: " << format_rate(total.overall.ties, total.overall.games) << std::endl;
+
+    // First-move win rates, most played first.
+    std::vector<std::pair<uint64_t, int> > first_moves;
+    for (int cell = 0; cell < CELL_COUNT; ++cell)
+    {
+        if (total.first_moves[cell].games > 0)
+            first_moves.push_back(std::make_pair(total.first_moves[cell].games, cell));
+    }
+    std::sort(first_moves.rbegin(), first_moves.rend());
+    std::cout << "\nFirst moves:" << std::endl;
+    for (size_t i = 0; i < first_moves.size() && i < top; ++i)
+    {
+        const OutcomeStats &move = total.first_moves[first_moves[i].second];
+        std::cout << "  " << format_move(first_moves[i].second) << "  games=" << move.games
+                  << " win rate=" << format_rate(move.first_mover_wins, move.games) << std::endl;
+    }
+
+    std::cout << "\nOpening tree:" << std::endl;
+    print_openings(total.openings, 0, 0, top);
+
+    // Players with the most games.
+    std::vector<std::pair<uint64_t, std::string> > players;
+    for (std::map<std::string, PlayerStats, std::less<> >::const_iterator it = total.players.begin(); it != total.players.end(); ++it)
+        players.push_back(std::make_pair(it->second.games, it->first));
+    std::sort(players.rbegin(), players.rend());
+    std::cout << "\nPlayers:" << std::endl;
+    for (size_t i = 0; i < players.size() && i < top; ++i)
+    {
+        const PlayerStats &player = total.players[players[i].second];
+        std::cout << "  " << players[i].second << "  games=" << player.games << " wins=" << player.wins
+                  << " losses=" << player.losses << " ties=" << player.ties << std::endl;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,139 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <ctime>
+#include <iostream>
+#include <string>
+#include <thread>
+
+#include "Telemetry.hpp"
+
+// Upper bound in microseconds of the latency bucket holding the given share of the messages.
+static uint64_t latency_percentile(const uint64_t *buckets, double share)
+{
+    uint64_t total = 0;
+    for (int i = 0; i < TelemetrySnapshot::LATENCY_BUCKETS; ++i)
+        total += buckets[i];
+    if (total == 0)
+        return 0;
+
+    uint64_t seen = 0;
+    for (int i = 0; i < TelemetrySnapshot::LATENCY_BUCKETS; ++i)
+    {
+        seen += buckets[i];
+        if (seen >= total * share)
+            return 1ULL << i;
+    }
+    return 1ULL << (TelemetrySnapshot::LATENCY_BUCKETS - 1);
+}
+
+// Prints one screen; rates and the latency histogram cover the time since the previous snapshot.
+static void render(const TelemetrySegment *segment, const TelemetrySnapshot &current, const TelemetrySnapshot &previous, bool clear)
+{
+    double seconds = (current.published_us - previous.published_us) / 1e6;
+    if (previous.publish_count == 0 || seconds <= 0)
+        seconds = 0;
+
+    if (clear)
+        std::printf("\033[H\033[2J");
+    std::printf("ups server  PID %d  Port %d  Shard %d  Up %lds  Snapshot #%llu\n\n", segment->pid, segment->port, segment->shard,
+                static_cast<long>(time(nullptr) - segment->started_at), static_cast<unsigned long long>(current.publish_count));
+    std::printf("Connections %-8u Players %-8u Games %-8u Queue %-8u Held %-8u\n", current.connections, current.players, current.games,
+                current.queue_length, current.admission_length);
+    for (int state = 0; state < TelemetrySnapshot::STATE_COUNT; ++state)
+        std::printf("%s %-6u ", Telemetry::state_name(state), current.players_by_state[state]);
+    std::printf("\n\n%-18s %12s %10s\n", "MESSAGE", "TOTAL", "RATE/s");
+
+    for (int opcode = 0; opcode < TelemetrySnapshot::OPCODE_COUNT; ++opcode)
+    {
+        uint64_t delta = (current.messages[opcode] >= previous.messages[opcode]) ? current.messages[opcode] - previous.messages[opcode] : 0;
+        if (current.messages[opcode] == 0)
+            continue;
+        std::printf("%-18s %12llu %10.1f\n", Telemetry::opcode_name(opcode), static_cast<unsigned long long>(current.messages[opcode]),
+                    seconds > 0 ? delta / seconds : 0.0);
+    }
+
+    // Without traffic in this interval show the histogram since startup.
+    uint64_t buckets[TelemetrySnapshot::LATENCY_BUCKETS];
+    uint64_t interval_total = 0;
+    for (int i = 0; i < TelemetrySnapshot::LATENCY_BUCKETS; ++i)
+    {
+        buckets[i] = (current.latency[i] >= previous.latency[i]) ? current.latency[i] - previous.latency[i] : 0;
+        interval_total += buckets[i];
+    }
+    const uint64_t *shown = interval_total ? buckets : current.latency;
+    uint64_t peak = 0;
+    for (int i = 0; i < TelemetrySnapshot::LATENCY_BUCKETS; ++i)
+        peak = std::max(peak, shown[i]);
+
+    std::printf("\nDispatch latency (%s)  p50 < %llu us  p99 < %llu us\n", interval_total ? "last interval" : "since start",
+                static_cast<unsigned long long>(latency_percentile(shown, 0.5)), static_cast<unsigned long long>(latency_percentile(shown, 0.99)));
+    for (int i = 0; i < TelemetrySnapshot::LATENCY_BUCKETS; ++i)
+    {
+        if (shown[i] == 0)
+            continue;
+        int width = static_cast<int>(40 * shown[i] / peak);
+        std::printf("  < %8llu us %10llu %s\n", 1ULL << i, static_cast<unsigned long long>(shown[i]), std::string(std::max(width, 1), '#').c_str());
+    }
+    std::fflush(stdout);
+}
+
+int main(int argc, const char *argv[])
+{
+    bool once = argc > 2 && std::string(argv[argc - 1]) == "once";
+    int positional = once ? argc - 1 : argc;
+    if (positional < 2 || positional > 3)
+    {
+        std::cout << "Usage: ./telemetry_top <PORT> [SHARD] [once]\n" << std::endl;
+        std::cout << "  PORT   - Port of the running server\n";
+        std::cout << "  SHARD  - Shard number when the server runs in router:<SHARDS> mode\n";
+        std::cout << "  once   - Print a single snapshot instead of refreshing every second\n" << std::endl;
+        std::cout << "The dashboard maps the server's shared memory telemetry segment read-only; the server\n";
+        std::cout << "never notices it.\n" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    int port = 0;
+    int shard = -1;
+    try
+    {
+        port = std::stoi(argv[1]);
+        if (positional == 3)
+            shard = std::stoi(argv[2]);
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << "Invalid port or shard" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    std::string name = Telemetry::segment_name(port, shard);
+    const TelemetrySegment *segment = Telemetry::map(name);
+    if (!segment)
+    {
+        std::cerr << "No telemetry segment " << name << " (is the server running?)" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    // A single snapshot still needs two for the rates; take them two publish intervals apart.
+    TelemetrySnapshot previous = {};
+    TelemetrySnapshot current = {};
+    if (once)
+    {
+        Telemetry::read(segment, previous);
+        std::this_thread::sleep_for(std::chrono::milliseconds(segment->publish_interval_ms * 2));
+    }
+    while (true)
+    {
+        if (!Telemetry::read(segment, current))
+        {
+            std::cerr << "Unable to take a consistent snapshot" << std::endl;
+            return EXIT_FAILURE;
+        }
+        render(segment, current, previous, !once);
+        if (once)
+            return EXIT_SUCCESS;
+        previous = current;
+        std::this_thread::sleep_for(std::chrono::seconds(1));
+    }
+}
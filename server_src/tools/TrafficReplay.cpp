@@ -0,0 +1,112 @@
+#include <chrono>
+#include <iostream>
+#include <string>
+
+#include "Server.hpp"
+#include "Config.hpp"
+#include "GameAdmin.hpp"
+#include "Session.hpp"
+#include "RateLimiter.hpp"
+#include "Reaper.hpp"
+#include "OpeningBook.hpp"
+#include "TrafficRecorder.hpp"
+
+struct ReplayStats
+{
+    uint64_t events[TrafficEvent::CLOSE + 1];
+    uint64_t frame_bytes;
+    uint64_t timer_rounds;
+
+    ReplayStats() : events(), frame_bytes(0), timer_rounds(0) {}
+};
+
+// Fires the session timers due before the given time in order, each at its own deadline, so
+// heartbeats and game clocks run exactly as they did between the recorded events.
+static void run_timers_until(Clock::time_point time, ReplayStats &stats)
+{
+    Clock::time_point deadline;
+    while (SessionAdmin::next_timer_deadline(deadline) && deadline <= time)
+    {
+        Clock::advance_to(deadline);
+        SessionAdmin::run_due_timers();
+        stats.timer_rounds++;
+    }
+    Clock::advance_to(time);
+}
+
+int main(int argc, const char *argv[])
+{
+    if (argc < 2 || (argc > 2 && std::string(argv[2]) != "log"))
+    {
+        std::cout << "Usage: ./traffic_replay <TRACE_FILE> [log]\n" << std::endl;
+        std::cout << "  TRACE_FILE  - Trace written by ./server <IP_ADDR> <PORT> <MAX_GAMES> <BACKEND> record\n";
+        std::cout << "  log         - Keep the server log on the standard output (off by default)\n" << std::endl;
+        std::cout << "The trace is fed through the game server on a virtual clock without sockets, replies are\n";
+        std::cout << "discarded, and profiles and the replay archive are left untouched.\n" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    TrafficTrace trace;
+    if (!trace.open(argv[1]))
+    {
+        std::cerr << "Unable to open trace " << argv[1] << std::endl;
+        return EXIT_FAILURE;
+    }
+    int max_games = static_cast<int>(trace.get_header()->max_games);
+
+    // The server log costs as much as the pipeline itself; the formatting still happens without it.
+    std::streambuf *output = std::cout.rdbuf();
+    if (argc == 2)
+    {
+        std::cout.rdbuf(nullptr);
+    }
+
+    // Set up the server like main does, minus the sockets and the persistent stores; the trace's
+    // game limit wins over server.conf so the replay admits what the recording did.
+    if (!Config::load(Config::defaults(), {"max_games=" + std::to_string(max_games)}))
+    {
+        std::cout.rdbuf(output);
+        std::cerr << "Unable to load the server configuration" << std::endl;
+        return EXIT_FAILURE;
+    }
+    Clock::time_point start = std::chrono::steady_clock::now();
+    Clock::use_virtual_time(start);
+    Server::goOffline();
+    GameAdmin::configure_max_games(max_games);
+    OpeningBook::open("opening.book");
+    RateLimiter::start_sweeper(60);
+    Reaper::start();
+    LobbyDirectory::start();
+    Server server("replay", 0, max_games, "select");
+
+    ReplayStats stats;
+    TrafficEvent event;
+    auto wall_start = std::chrono::steady_clock::now();
+    while (trace.next(event))
+    {
+        run_timers_until(start + std::chrono::microseconds(event.time_us), stats);
+        server.replayEvent(event);
+        stats.events[event.kind]++;
+        stats.frame_bytes += (event.kind == TrafficEvent::FRAME) ? event.data.length() : 0;
+    }
+    auto wall_time = std::chrono::duration<double>(std::chrono::steady_clock::now() - wall_start).count();
+    auto traffic_time = std::chrono::duration<double>(Clock::now() - start).count();
+
+    std::cout.rdbuf(output);
+    uint64_t total = stats.events[TrafficEvent::OPEN] + stats.events[TrafficEvent::FRAME] + stats.events[TrafficEvent::CLOSE];
+    std::cout << "Events: " << total << " (" << stats.events[TrafficEvent::OPEN] << " opens, " << stats.events[TrafficEvent::FRAME]
+              << " frames, " << stats.events[TrafficEvent::CLOSE] << " closes), Frame bytes: " << stats.frame_bytes
+              << ", Timer rounds: " << stats.timer_rounds << std::endl;
+    if (!trace.is_complete())
+    {
+        std::cout << "Warning: the trace ends with a truncated event" << std::endl;
+    }
+    std::cout << "Recorded time: " << traffic_time << " s, Replay time: " << wall_time << " s ("
+              << (wall_time > 0 ? traffic_time / wall_time : 0) << "x)" << std::endl;
+    std::cout << "Throughput: " << (wall_time > 0 ? total / wall_time : 0) << " events/s, "
+              << (wall_time > 0 ? stats.events[TrafficEvent::FRAME] / wall_time : 0) << " frames/s, Reply bytes: "
+              << Server::getDiscardedBytes() << std::endl;
+    std::cout << "Live at the end: " << Game::get_live_count() << " games, " << Player::get_live_count() << " players, "
+              << SessionAdmin::get_session_count() << " sessions" << std::endl;
+    return EXIT_SUCCESS;
+}